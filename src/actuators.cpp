@@ -0,0 +1,211 @@
+#include "actuators.h"
+#include "app_task.h"
+#include "attribute_batcher.h"
+#include "relay_bank.h"
+#include "sensor_task.h"
+#include "timed_actuation.h"
+#ifdef CONFIG_APP_FLASH_LOG
+#include "flash_log.h"
+#endif
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/pwm.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+namespace
+{
+const struct gpio_dt_spec rel1 = GPIO_DT_SPEC_GET(DT_ALIAS(relay1), gpios);
+const struct gpio_dt_spec rel2 = GPIO_DT_SPEC_GET(DT_ALIAS(relay2), gpios);
+const struct gpio_dt_spec rel3 = GPIO_DT_SPEC_GET(DT_ALIAS(relay3), gpios);
+const struct gpio_dt_spec rel4 = GPIO_DT_SPEC_GET(DT_ALIAS(relay4), gpios);
+
+const struct pwm_dt_spec servo = PWM_DT_SPEC_GET(DT_ALIAS(servo));
+
+/* The relay boards switch On with a low input */
+constexpr uint32_t kRelayActiveLevel = 0;
+/* Feeder servo pulse while dispensing */
+constexpr uint32_t kFeederPulseNs = 1050000;
+constexpr uint32_t kFeederTimeoutMs = 2000;
+
+RelayBank sRelayBank;
+
+/* The relays are only staged, the bank writes them all at Commit */
+int RelayActivate(const ActuatorDescriptor &actuator)
+{
+        return sRelayBank.Stage(*actuator.Gpio, actuator.ActiveLevel);
+}
+
+int RelayDeactivate(const ActuatorDescriptor &actuator)
+{
+        return sRelayBank.Stage(*actuator.Gpio, !actuator.ActiveLevel);
+}
+
+int ServoActivate(const ActuatorDescriptor &actuator)
+{
+        return pwm_set_pulse_dt(actuator.Pwm, actuator.ActiveLevel);
+}
+
+int ServoDeactivate(const ActuatorDescriptor &actuator)
+{
+        return pwm_set_pulse_dt(actuator.Pwm, 0);
+}
+
+/* Indexed by endpoint - Actuators::kFirstActuatorEndpoint */
+constexpr ActuatorDescriptor kActuators[] = {
+        { "hot lamp", 2, &rel1, nullptr, kRelayActiveLevel, RelayActivate, RelayDeactivate, 0,
+          SensorBit(SensorId::HotSpot) },
+        { "uvb lamp", 3, &rel2, nullptr, kRelayActiveLevel, RelayActivate, RelayDeactivate, 0,
+          SensorBit(SensorId::HotSpot) },
+        { "heater", 4, &rel3, nullptr, kRelayActiveLevel, RelayActivate, RelayDeactivate, 0,
+          SensorBit(SensorId::WaterTemp) },
+        { "filter", 5, &rel4, nullptr, kRelayActiveLevel, RelayActivate, RelayDeactivate, 0, 0 },
+        { "feeder", 6, nullptr, &servo, kFeederPulseNs, ServoActivate, ServoDeactivate, kFeederTimeoutMs, 0 },
+};
+
+constexpr bool IsIndexedByEndpoint(size_t index)
+{
+        return index == ARRAY_SIZE(kActuators) ||
+               (kActuators[index].Endpoint == Actuators::kFirstActuatorEndpoint + index &&
+                IsIndexedByEndpoint(index + 1));
+}
+static_assert(IsIndexedByEndpoint(0), "kActuators must be sorted by consecutive endpoints");
+static_assert(ARRAY_SIZE(kActuators) <= Actuators::kMaxActuators, "too many actuators");
+
+/* Last staged state of every actuator, all Off at Init */
+bool sStates[ARRAY_SIZE(kActuators)];
+
+/* Bit per actuator forced Off, set from any thread */
+atomic_t sForcedOff;
+} /* namespace */
+
+int Actuators::Init()
+{
+        for (size_t i = 0; i < ARRAY_SIZE(kActuators); i++) {
+                const ActuatorDescriptor &actuator = kActuators[i];
+
+                if (actuator.Gpio) {
+                        if (!gpio_is_ready_dt(actuator.Gpio)) {
+                                LOG_ERR("%s gpio is not ready", actuator.Name);
+                                return -ENODEV;
+                        }
+                        /* Start with the actuator Off */
+                        gpio_pin_configure_dt(actuator.Gpio, actuator.ActiveLevel ? GPIO_OUTPUT_INACTIVE :
+                                                                                    GPIO_OUTPUT_ACTIVE);
+                        if (sRelayBank.Add(*actuator.Gpio, !actuator.ActiveLevel)) {
+                                LOG_ERR("%s gpio is not on the relay bank port", actuator.Name);
+                                return -EINVAL;
+                        }
+                }
+
+                if (actuator.Pwm && !device_is_ready(actuator.Pwm->dev)) {
+                        LOG_ERR("Device %s is not ready", actuator.Pwm->dev->name);
+                        return -ENODEV;
+                }
+        }
+
+        return 0;
+}
+
+const ActuatorDescriptor *Actuators::Find(chip::EndpointId endpoint)
+{
+        const size_t index = static_cast<size_t>(endpoint - kFirstActuatorEndpoint);
+
+        if (endpoint < kFirstActuatorEndpoint || index >= ARRAY_SIZE(kActuators)) {
+                return nullptr;
+        }
+        return &kActuators[index];
+}
+
+size_t Actuators::IndexOf(const ActuatorDescriptor &actuator)
+{
+        return static_cast<size_t>(&actuator - kActuators);
+}
+
+size_t Actuators::Count()
+{
+        return ARRAY_SIZE(kActuators);
+}
+
+int Actuators::Stage(const ActuatorDescriptor &actuator, bool on)
+{
+        /* A forced actuator silently stays Off, its On/Off attribute follows */
+        if (on && IsForcedOff(actuator)) {
+                on = false;
+                AttributeBatcher::SetOnOff(actuator.Endpoint, false);
+        }
+
+        int ret = on ? actuator.Activate(actuator) : actuator.Deactivate(actuator);
+        if (ret) {
+                LOG_ERR("Failed to switch %s %s: %d", actuator.Name, on ? "On" : "Off", ret);
+        } else if (sStates[IndexOf(actuator)] != on) {
+                sStates[IndexOf(actuator)] = on;
+#ifdef CONFIG_APP_FLASH_LOG
+                FlashLog::RecordActuator(actuator.Endpoint, on);
+#endif
+                if (actuator.AffectedSensors) {
+                        SensorTask::Instance().Expedite(actuator.AffectedSensors);
+                }
+                TimedActuation::Staged(actuator, on);
+        }
+
+        return ret;
+}
+
+int Actuators::Commit()
+{
+        int ret = sRelayBank.Commit();
+        if (ret) {
+                LOG_ERR("Failed to commit the relay bank: %d", ret);
+        }
+        return ret;
+}
+
+int Actuators::Apply(const ActuatorDescriptor &actuator, bool on)
+{
+        int ret = Stage(actuator, on);
+        return ret ? ret : Commit();
+}
+
+bool Actuators::IsOn(const ActuatorDescriptor &actuator)
+{
+        return sStates[IndexOf(actuator)] && !IsForcedOff(actuator);
+}
+
+int Actuators::ForceOff(const ActuatorDescriptor &actuator)
+{
+        atomic_set_bit(&sForcedOff, IndexOf(actuator));
+
+        /* The relays are written at once, bypassing the staged levels */
+        int ret = actuator.Gpio ? sRelayBank.Force(*actuator.Gpio) : actuator.Deactivate(actuator);
+        if (ret) {
+                LOG_ERR("Failed to force %s Off: %d", actuator.Name, ret);
+        }
+
+        AttributeBatcher::SetOnOff(actuator.Endpoint, false);
+
+        AppEvent event;
+        event.Type = AppEventType::ActuatorCommand;
+        event.ActuatorEvent.Endpoint = actuator.Endpoint;
+        event.ActuatorEvent.On = false;
+        event.Handler = AppTask::ActuatorCommandHandler;
+        AppTask::PostEvent(event);
+
+        return ret;
+}
+
+int Actuators::Release(const ActuatorDescriptor &actuator)
+{
+        atomic_clear_bit(&sForcedOff, IndexOf(actuator));
+
+        return actuator.Gpio ? sRelayBank.Release(*actuator.Gpio) : 0;
+}
+
+bool Actuators::IsForcedOff(const ActuatorDescriptor &actuator)
+{
+        return atomic_test_bit(&sForcedOff, IndexOf(actuator));
+}
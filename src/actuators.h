@@ -0,0 +1,76 @@
+/* ****************************************************************************
+ *
+ *  ACTUATORS TABLE - actuators.cpp
+ *
+ * Every actuator is described by one ActuatorDescriptor entry of the
+ * constexpr kActuators table, in endpoint order starting from
+ * kFirstActuatorEndpoint, so that the endpoint of an On/Off command directly
+ * indexes its actuator. Adding an actuator only means adding its entry (and
+ * its On/Off endpoint in the ZAP file).
+ *
+ * Init: check and configure the actuators hardware, all switched Off
+ * Find: O(1) lookup of the actuator driven by an endpoint, nullptr if none
+ * Stage: switch the actuator On or Off, start or stop its OnOff countdowns
+ *        (see timed_actuation.h) and expedite the sampling of the sensors
+ *        it affects, the relays are only switched by the next Commit
+ * Commit: switch all the staged relays at once, see relay_bank.h
+ * Apply: Stage and Commit a single actuator
+ * IsOn: last state staged for the actuator, Off while forced Off
+ * ForceOff: switch the actuator Off at once, from any thread, and keep it
+ *           Off until Release whatever is staged, see interlocks.h. The
+ *           Off command is also queued to the AppTask, so that the state,
+ *           the countdowns and the flash log follow
+ * Release: let the actuator be staged On again, it stays Off until then
+ * IsForcedOff: the actuator is forced Off
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <lib/core/DataModelTypes.h>
+
+struct gpio_dt_spec;
+struct pwm_dt_spec;
+struct ActuatorDescriptor;
+
+using ActuatorHandler = int (*)(const ActuatorDescriptor &actuator);
+
+struct ActuatorDescriptor {
+        const char *Name;
+        chip::EndpointId Endpoint;
+        /* Output of the relay actuators, nullptr otherwise */
+        const struct gpio_dt_spec *Gpio;
+        /* Output of the servo actuators, nullptr otherwise */
+        const struct pwm_dt_spec *Pwm;
+        /* Logical GPIO level, or PWM pulse in ns, that switches the actuator On */
+        uint32_t ActiveLevel;
+        ActuatorHandler Activate;
+        ActuatorHandler Deactivate;
+        /* The actuator switches itself back Off after this time, 0 if
+         * bistable, see timed_actuation.h */
+        uint32_t MonostableTimeoutMs;
+        /* SensorBit() mask of the sensors sampled sooner after a switch */
+        uint8_t AffectedSensors;
+};
+
+class Actuators {
+public:
+        static constexpr chip::EndpointId kFirstActuatorEndpoint = 2;
+        /* Capacity of the per-actuator state kept by the other modules */
+        static constexpr size_t kMaxActuators = 8;
+
+        static int Init();
+        static const ActuatorDescriptor *Find(chip::EndpointId endpoint);
+        static size_t IndexOf(const ActuatorDescriptor &actuator);
+        static size_t Count();
+        static int Stage(const ActuatorDescriptor &actuator, bool on);
+        static int Commit();
+        static int Apply(const ActuatorDescriptor &actuator, bool on);
+        static bool IsOn(const ActuatorDescriptor &actuator);
+        static int ForceOff(const ActuatorDescriptor &actuator);
+        static int Release(const ActuatorDescriptor &actuator);
+        static bool IsForcedOff(const ActuatorDescriptor &actuator);
+};
@@ -0,0 +1,37 @@
+/* ****************************************************************************
+ *
+ *  ADAPTIVE INTERVAL - adaptive_interval.h
+ *
+ * Sampling interval of a sensor that follows the rate of change of its
+ * readings: back to the shortest interval as soon as the reading moves, and
+ * doubled, up to the longest interval, every time it stays stable. The
+ * shortest interval is never below the minimum the sensor supports.
+ *
+ * Shorten: the reading changed, sample again after the shortest interval
+ * BackOff: the reading was stable, double the interval
+ * IntervalMs: interval until the next sample
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+class AdaptiveInterval {
+public:
+        constexpr AdaptiveInterval(uint32_t minMs, uint32_t maxMs)
+                : mMinMs(minMs), mMaxMs(maxMs < minMs ? minMs : maxMs), mIntervalMs(minMs)
+        {
+        }
+
+        void Shorten() { mIntervalMs = mMinMs; }
+        void BackOff() { mIntervalMs = mIntervalMs > mMaxMs / 2 ? mMaxMs : mIntervalMs * 2; }
+
+        uint32_t IntervalMs() const { return mIntervalMs; }
+        uint32_t MinMs() const { return mMinMs; }
+
+private:
+        uint32_t mMinMs;
+        uint32_t mMaxMs;
+        uint32_t mIntervalMs;
+};
@@ -13,19 +13,15 @@
 class LEDWidget;
 
 enum class AppEventType : uint8_t { None = 0, Button, ButtonPushed, ButtonReleased, Timer, UpdateLedState, 
-									HotLampActivate, 
-									HotLampDeactivate, 
-									UvbLampActivate, 
-									UvbLampDeactivate, 
-									HeaterActivate, 
-									HeaterDeactivate, 
-									FilterActivate, 
-									FilterDeactivate, 
-									FeederActivate, 
-									FeederDeactivate, 
-									HotSensorMeasure, 
-									ColdSensorMeasure, 
-									WaterTempSensorMeasure, };
+									ActuatorCommand, 
+									ActuatorCommit, 
+									SensorSample, 
+									BenchmarkActuator, 
+									BenchmarkSensor, 
+									TimedActuation, 
+									TimedActuationWheel, 
+									WaterHeaterWindow, 
+									Count, };
 
 enum class FunctionEvent : uint8_t { NoneSelected = 0, FactoryReset };
 
@@ -41,8 +37,22 @@ struct AppEvent {
 		struct {
 			LEDWidget *LedWidget;
 		} UpdateLedStateEvent;
+		struct {
+			uint16_t Endpoint;
+			bool On;
+		} ActuatorEvent;
+		struct {
+			uint16_t Endpoint;
+			/* TimedActuationRequest, see timed_actuation.h */
+			uint8_t Request;
+			bool AcceptOnlyWhenOn;
+			uint16_t OnTime;
+			uint16_t OffWaitTime;
+		} TimedActuationEvent;
 	};
 
 	AppEventType Type{ AppEventType::None };
 	EventHandler Handler;
+	/* Cycle counter when the event was posted, set by AppEventQueue */
+	uint32_t PostedAt{ 0 };
 };
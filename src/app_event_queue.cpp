@@ -0,0 +1,163 @@
+#include "app_event_queue.h"
+#include "app_event_stats.h"
+
+#include <cstring>
+
+#include <zephyr/kernel.h>
+
+namespace
+{
+/* Entries shared by the events without coalescing key */
+constexpr size_t kActuatorQueueSize = 10;
+constexpr size_t kInputQueueSize = 4;
+constexpr size_t kLedQueueSize = 4;
+constexpr size_t kSensorQueueSize = 4;
+
+static_assert(AppEventClassOfKey(0) == AppEventClassOf(AppEventType::ActuatorCommand) &&
+                      AppEventClassOfKey(Actuators::kMaxActuators) == AppEventClassOf(AppEventType::SensorSample) &&
+                      AppEventClassOfKey(Actuators::kMaxActuators + 1) ==
+                              AppEventClassOf(AppEventType::TimedActuationWheel) &&
+                      AppEventClassOfKey(Actuators::kMaxActuators + 2) ==
+                              AppEventClassOf(AppEventType::WaterHeaterWindow),
+              "a coalescing key reserves its entry in the queue of its events");
+
+/* Entries reserved for the coalescing keys of a class, one each */
+constexpr size_t ReservedEntries(AppEventClass eventClass)
+{
+        size_t entries = 0;
+
+        for (size_t key = 0; key < kAppEventCoalescingKeys; key++) {
+                if (AppEventClassOfKey(key) == eventClass) {
+                        entries++;
+                }
+        }
+        return entries;
+}
+
+K_MSGQ_DEFINE(sActuatorEventQueue, sizeof(AppEvent), kActuatorQueueSize + ReservedEntries(AppEventClass::Actuator),
+              alignof(AppEvent));
+K_MSGQ_DEFINE(sInputEventQueue, sizeof(AppEvent), kInputQueueSize + ReservedEntries(AppEventClass::Input),
+              alignof(AppEvent));
+K_MSGQ_DEFINE(sLedEventQueue, sizeof(AppEvent), kLedQueueSize + ReservedEntries(AppEventClass::Led),
+              alignof(AppEvent));
+K_MSGQ_DEFINE(sSensorEventQueue, sizeof(AppEvent), kSensorQueueSize + ReservedEntries(AppEventClass::Sensor),
+              alignof(AppEvent));
+
+/* Indexed by AppEventClass, from the most to the least urgent */
+k_msgq *const sClassQueues[] = { &sActuatorEventQueue, &sInputEventQueue, &sLedEventQueue, &sSensorEventQueue };
+static_assert(ARRAY_SIZE(sClassQueues) == static_cast<size_t>(AppEventClass::Count), "missing class queue");
+
+/* Shared entries still free in each class queue, indexed by AppEventClass */
+atomic_t sFreeEntries[] = { ATOMIC_INIT(kActuatorQueueSize), ATOMIC_INIT(kInputQueueSize),
+                            ATOMIC_INIT(kLedQueueSize), ATOMIC_INIT(kSensorQueueSize) };
+static_assert(ARRAY_SIZE(sFreeEntries) == static_cast<size_t>(AppEventClass::Count), "missing class entries");
+
+/* Counts the events queued in all the class queues */
+K_SEM_DEFINE(sPendingEvents, 0, K_SEM_MAX_LIMIT);
+
+uint32_t sMaxLatencyCycles[static_cast<size_t>(AppEventClass::Count)];
+
+/* Latest content of the coalesced events, the queued copy is only a token */
+struct CoalescingSlot {
+        AppEvent Event;
+        bool Queued;
+};
+
+CoalescingSlot sCoalescingSlots[kAppEventCoalescingKeys];
+k_spinlock sCoalescingLock;
+
+bool TakeSharedEntry(AppEventClass eventClass)
+{
+        atomic_t &free = sFreeEntries[static_cast<size_t>(eventClass)];
+
+        while (true) {
+                const atomic_val_t current = atomic_get(&free);
+                if (current <= 0) {
+                        return false;
+                }
+                if (atomic_cas(&free, current, current - 1)) {
+                        return true;
+                }
+        }
+}
+} /* namespace */
+
+bool AppEventQueue::Post(const AppEvent &event)
+{
+        AppEvent stamped = event;
+        stamped.PostedAt = k_cycle_get_32();
+
+        AppEventStats::RecordPosted(event.Type);
+
+        const AppEventClass eventClass = AppEventClassOf(event.Type);
+        const int key = AppEventCoalescingKeyOf(event);
+        if (key != kNoCoalescing) {
+                k_spinlock_key_t lock = k_spin_lock(&sCoalescingLock);
+                CoalescingSlot &slot = sCoalescingSlots[key];
+                if (slot.Queued) {
+                        /* Keep the oldest post time, the event waits since then */
+                        stamped.PostedAt = slot.Event.PostedAt;
+                        slot.Event = stamped;
+                        k_spin_unlock(&sCoalescingLock, lock);
+                        AppEventStats::RecordCoalesced(event.Type);
+                        return true;
+                }
+                slot.Event = stamped;
+                slot.Queued = true;
+                k_spin_unlock(&sCoalescingLock, lock);
+        } else if (!TakeSharedEntry(eventClass)) {
+                AppEventStats::RecordDropped(event.Type);
+                return false;
+        }
+
+        /* Cannot fail: the event holds either the reserved entry of its
+         * key, which the posts merged into it rely on, or a shared one */
+        k_msgq *queue = sClassQueues[static_cast<size_t>(eventClass)];
+        k_msgq_put(queue, &stamped, K_NO_WAIT);
+        AppEventStats::RecordQueueDepth(eventClass, k_msgq_num_used_get(queue));
+        k_sem_give(&sPendingEvents);
+        return true;
+}
+
+void AppEventQueue::Get(AppEvent &event)
+{
+        k_sem_take(&sPendingEvents, K_FOREVER);
+
+        /* Every semaphore count matches an event already put in one of the
+         * queues, so the scan always finds one */
+        for (size_t i = 0; i < ARRAY_SIZE(sClassQueues); i++) {
+                if (k_msgq_get(sClassQueues[i], &event, K_NO_WAIT) == 0) {
+                        const int key = AppEventCoalescingKeyOf(event);
+                        if (key != kNoCoalescing) {
+                                k_spinlock_key_t lock = k_spin_lock(&sCoalescingLock);
+                                event = sCoalescingSlots[key].Event;
+                                sCoalescingSlots[key].Queued = false;
+                                k_spin_unlock(&sCoalescingLock, lock);
+                        } else {
+                                atomic_inc(&sFreeEntries[i]);
+                        }
+
+                        const uint32_t latency = k_cycle_get_32() - event.PostedAt;
+                        sMaxLatencyCycles[i] = MAX(sMaxLatencyCycles[i], latency);
+                        return;
+                }
+        }
+}
+
+size_t AppEventQueue::Capacity(AppEventClass eventClass)
+{
+        const size_t capacities[] = { kActuatorQueueSize, kInputQueueSize, kLedQueueSize, kSensorQueueSize };
+        static_assert(ARRAY_SIZE(capacities) == static_cast<size_t>(AppEventClass::Count), "missing class capacity");
+
+        return capacities[static_cast<size_t>(eventClass)];
+}
+
+uint32_t AppEventQueue::MaxLatencyUs(AppEventClass eventClass)
+{
+        return k_cyc_to_us_ceil32(sMaxLatencyCycles[static_cast<size_t>(eventClass)]);
+}
+
+void AppEventQueue::ResetLatency()
+{
+        memset(sMaxLatencyCycles, 0, sizeof(sMaxLatencyCycles));
+}
@@ -0,0 +1,105 @@
+/* ****************************************************************************
+ *
+ *  APP EVENT QUEUE - app_event_queue.cpp
+ *
+ * Multi-level priority queue feeding the AppTask event loop. Each
+ * AppEventClass has its own bounded message queue, so a burst of one class
+ * can never use up the room of another one, and Get always returns the
+ * oldest event of the most urgent non-empty class:
+ *
+ *   Actuator > Input (button/timer) > Led > Sensor
+ *
+ * Events sharing a coalescing key are never queued twice: while one of them
+ * is waiting, a new post only replaces its content (latest wins). This keeps
+ * at most one sample notification and one command per actuator endpoint in
+ * flight, whatever the sensor latency, and an On quickly followed by an Off
+ * on the same endpoint only switches the relay once. The timer wheel wakeup
+ * of timed_actuation.cpp and the water heater window have a slot of their
+ * own, so a burst of inputs cannot crowd them out. The relay commits are
+ * never coalesced: merged into an older one, a commit would be dispatched
+ * ahead of the commands it covers.
+ *
+ * Every coalescing key has an entry of its class queue reserved for it, the
+ * other events of the class only share the remaining entries. A coalesced
+ * post therefore always finds room, and a post merged into a queued one is
+ * never lost to a failed put.
+ *
+ * Post is safe to call from ISRs and from any thread.
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include "actuators.h"
+#include "app_event.h"
+
+#include <cstdint>
+
+enum class AppEventClass : uint8_t { Actuator = 0, Input, Led, Sensor, Count };
+
+constexpr AppEventClass AppEventClassOf(AppEventType type)
+{
+        switch (type) {
+        case AppEventType::ActuatorCommand:
+        case AppEventType::ActuatorCommit:
+        case AppEventType::BenchmarkActuator:
+        case AppEventType::TimedActuation:
+        case AppEventType::TimedActuationWheel:
+        case AppEventType::WaterHeaterWindow:
+                return AppEventClass::Actuator;
+        case AppEventType::Button:
+        case AppEventType::ButtonPushed:
+        case AppEventType::ButtonReleased:
+        case AppEventType::Timer:
+                return AppEventClass::Input;
+        case AppEventType::UpdateLedState:
+                return AppEventClass::Led;
+        default:
+                return AppEventClass::Sensor;
+        }
+}
+
+/* Slot shared by the events that replace each other in the queue,
+ * kNoCoalescing for the events that are always queued */
+constexpr int kNoCoalescing = -1;
+
+constexpr size_t kAppEventCoalescingKeys = Actuators::kMaxActuators + 3;
+
+/* Class of the events of a coalescing key */
+constexpr AppEventClass AppEventClassOfKey(size_t key)
+{
+        return key == Actuators::kMaxActuators ? AppEventClass::Sensor : AppEventClass::Actuator;
+}
+
+/* One slot per actuator, then the sample notification, the timer wheel
+ * wakeup and the water heater window */
+inline int AppEventCoalescingKeyOf(const AppEvent &event)
+{
+        switch (event.Type) {
+        case AppEventType::ActuatorCommand: {
+                const ActuatorDescriptor *actuator = Actuators::Find(event.ActuatorEvent.Endpoint);
+                return actuator ? static_cast<int>(Actuators::IndexOf(*actuator)) : kNoCoalescing;
+        }
+        case AppEventType::SensorSample:
+                return static_cast<int>(Actuators::kMaxActuators);
+        case AppEventType::TimedActuationWheel:
+                return static_cast<int>(Actuators::kMaxActuators + 1);
+        case AppEventType::WaterHeaterWindow:
+                return static_cast<int>(Actuators::kMaxActuators + 2);
+        default:
+                return kNoCoalescing;
+        }
+}
+
+class AppEventQueue {
+public:
+        static bool Post(const AppEvent &event);
+        static void Get(AppEvent &event);
+
+        /* Entries shared by the events of a class without coalescing key */
+        static size_t Capacity(AppEventClass eventClass);
+
+        /* Worst post-to-dispatch latency seen so far for the given class */
+        static uint32_t MaxLatencyUs(AppEventClass eventClass);
+        static void ResetLatency();
+};
@@ -0,0 +1,98 @@
+#include "app_event_stats.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+namespace
+{
+atomic_t sPosted[AppEventStats::kTypeCount];
+atomic_t sDropped[AppEventStats::kTypeCount];
+atomic_t sCoalesced[AppEventStats::kTypeCount];
+atomic_t sDispatched[AppEventStats::kTypeCount];
+atomic_t sHighWaterMarks[AppEventStats::kClassCount];
+atomic_t sHistogram[AppEventStats::kHistogramBuckets];
+
+size_t TypeIndex(AppEventType type)
+{
+        return MIN(static_cast<size_t>(type), AppEventStats::kTypeCount - 1);
+}
+
+size_t HistogramIndex(uint32_t us)
+{
+        if (us == 0) {
+                return 0;
+        }
+        return MIN(static_cast<size_t>(31 - __builtin_clz(us)), AppEventStats::kHistogramBuckets - 1);
+}
+
+void Clear(atomic_t *values, size_t count)
+{
+        for (size_t i = 0; i < count; i++) {
+                atomic_clear(&values[i]);
+        }
+}
+} /* namespace */
+
+void AppEventStats::RecordPosted(AppEventType type)
+{
+        atomic_inc(&sPosted[TypeIndex(type)]);
+}
+
+void AppEventStats::RecordDropped(AppEventType type)
+{
+        atomic_inc(&sDropped[TypeIndex(type)]);
+}
+
+void AppEventStats::RecordCoalesced(AppEventType type)
+{
+        atomic_inc(&sCoalesced[TypeIndex(type)]);
+}
+
+void AppEventStats::RecordQueueDepth(AppEventClass eventClass, uint32_t depth)
+{
+        atomic_t &mark = sHighWaterMarks[static_cast<size_t>(eventClass)];
+        atomic_val_t current = atomic_get(&mark);
+
+        while (depth > static_cast<uint32_t>(current) && !atomic_cas(&mark, current, depth)) {
+                current = atomic_get(&mark);
+        }
+}
+
+void AppEventStats::RecordDispatched(AppEventType type, uint32_t handlerCycles)
+{
+        atomic_inc(&sDispatched[TypeIndex(type)]);
+        atomic_inc(&sHistogram[HistogramIndex(k_cyc_to_us_floor32(handlerCycles))]);
+}
+
+AppEventStats::TypeCounters AppEventStats::Counters(AppEventType type)
+{
+        const size_t index = TypeIndex(type);
+        TypeCounters counters;
+
+        counters.Posted = atomic_get(&sPosted[index]);
+        counters.Dropped = atomic_get(&sDropped[index]);
+        counters.Coalesced = atomic_get(&sCoalesced[index]);
+        counters.Dispatched = atomic_get(&sDispatched[index]);
+
+        return counters;
+}
+
+uint32_t AppEventStats::HighWaterMark(AppEventClass eventClass)
+{
+        return atomic_get(&sHighWaterMarks[static_cast<size_t>(eventClass)]);
+}
+
+uint32_t AppEventStats::HistogramBucket(size_t bucket)
+{
+        return bucket < kHistogramBuckets ? atomic_get(&sHistogram[bucket]) : 0;
+}
+
+void AppEventStats::Reset()
+{
+        Clear(sPosted, kTypeCount);
+        Clear(sDropped, kTypeCount);
+        Clear(sCoalesced, kTypeCount);
+        Clear(sDispatched, kTypeCount);
+        Clear(sHighWaterMarks, kClassCount);
+        Clear(sHistogram, kHistogramBuckets);
+}
@@ -0,0 +1,51 @@
+/* ****************************************************************************
+ *
+ *  APP EVENT STATISTICS - app_event_stats.cpp
+ *
+ * Counters of the AppTask event path, readable through the terrarium shell
+ * and the Terrarium Diagnostics cluster:
+ *
+ * - posted, dropped (queue full), coalesced and dispatched events per
+ *   AppEventType
+ * - high-water mark of every AppEventQueue class queue
+ * - log2 histogram of the handler execution time, bucket i counts the
+ *   handlers that took [2^i, 2^(i+1)) us, bucket 0 also counts < 1 us and
+ *   the last bucket everything above
+ *
+ * All the Record* functions are lock-free and safe to call from ISRs.
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include "app_event.h"
+#include "app_event_queue.h"
+
+#include <cstddef>
+#include <cstdint>
+
+class AppEventStats {
+public:
+        static constexpr size_t kTypeCount = static_cast<size_t>(AppEventType::Count);
+        static constexpr size_t kClassCount = static_cast<size_t>(AppEventClass::Count);
+        static constexpr size_t kHistogramBuckets = 20;
+
+        struct TypeCounters {
+                uint32_t Posted;
+                uint32_t Dropped;
+                uint32_t Coalesced;
+                uint32_t Dispatched;
+        };
+
+        static void RecordPosted(AppEventType type);
+        static void RecordDropped(AppEventType type);
+        static void RecordCoalesced(AppEventType type);
+        static void RecordQueueDepth(AppEventClass eventClass, uint32_t depth);
+        static void RecordDispatched(AppEventType type, uint32_t handlerCycles);
+
+        static TypeCounters Counters(AppEventType type);
+        static uint32_t HighWaterMark(AppEventClass eventClass);
+        static uint32_t HistogramBucket(size_t bucket);
+
+        static void Reset();
+};
@@ -0,0 +1,796 @@
+/* ****************************************************************************
+ *
+ *  TERRARIUM SHELL - app_shell.cpp
+ *
+ * terrarium queue latency: worst post-to-dispatch latency per event class
+ * terrarium queue reset: clear the latency records and the statistics
+ * terrarium queue stats: per event type counters, class queue high-water
+ *      marks and handler execution time histogram
+ * terrarium queue bench [sensor_events] [rounds]: queue sensor_events slow
+ *      sensor-class events, at most the sensor class capacity, inject an
+ *      actuator command from a timer ISR while they are being dispatched
+ *      and report the worst time from the command post to the end of its
+ *      relay bank commit, i.e. of the relay GPIO port write
+ *
+ * terrarium publish stats: published and suppressed measurement updates
+ *      per endpoint
+ * terrarium publish reset: clear the publish counters
+ *
+ * terrarium log stats: flash log usage, wear and error counters
+ * terrarium log flush: program the records still batched in RAM
+ * terrarium log bench [records]: time the append of benchmark records to
+ *      scratch sectors, then a query of the last hour of the log, with
+ *      CONFIG_APP_FLASH_LOG_BENCHMARK
+ *
+ * terrarium rollup show <minute|hour|day>: rollups in progress of every
+ *      sensor channel
+ * terrarium rollup query <minute|hour|day> <channel> <seconds>: closed
+ *      rollups of a channel stored in the flash log over the last seconds
+ *
+ * terrarium sampling show: per sensor adaptive sampling interval, average
+ *      sampling rate, and the acquisitions and energy saved compared to
+ *      sampling every CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS, then the
+ *      acquisition failures, DHT checksum errors and Matter idle waits,
+ *      and the health of every sensor and DS18B20 probe
+ * terrarium sampling reset: clear the acquisition and fault counters
+ * terrarium sampling wait <on|off>: wait for an idle Matter thread before
+ *      the DHT transactions, to compare the checksum error rates
+ *
+ * terrarium probes show: ROM ID and Matter endpoint of every DS18B20 probe
+ * terrarium probes forget: clear the cached probe IDs, the probes are
+ *      numbered again in search order at the next boot
+ * terrarium probes rescan: search the 1-Wire bus and cache the probes
+ *      present, the missing ones are dropped and the new ones get an
+ *      endpoint at the next boot
+ * terrarium probes timing: last and worst times of the split DS18B20
+ *      acquisition, Convert-T and scratchpad reads on the bus, sensor
+ *      thread wait for the conversion, and conversion start to sample
+ * terrarium probes bench [rounds]: expedite the water sampling, post an
+ *      actuator command as soon as a DS18B20 acquisition is in flight and
+ *      report the worst time from the command post to the end of its relay
+ *      bank commit, and how many commands were handled before the
+ *      acquisition ended
+ *
+ * terrarium endpoints show: dynamic endpoint pool, with the kind and unique
+ *      ID of every device and whether it was found since the boot
+ * terrarium endpoints switch: add a virtual On/Off switch endpoint
+ * terrarium endpoints remove <endpoint>: remove a dynamic endpoint, a
+ *      device still present gets a new endpoint at the next boot
+ *
+ * terrarium heater show: water heater PID configuration and duty cycle
+ * terrarium heater enable|disable: start or stop the on-device regulation
+ * terrarium heater setpoint <0.01 C>: water temperature setpoint
+ * terrarium heater window <ms>: time-proportional window
+ * terrarium heater gains <kp> <ki> <kd>: PID gains, in 0.001 units
+ *
+ * terrarium interlocks show: safety interlock rules, their alarms and
+ *      worst-case reaction times
+ * terrarium interlocks ack <rule|all>: acknowledge latched alarms and
+ *      release their actuators, refused while the condition is present
+ *
+ * ***************************************************************************/
+
+#include "actuators.h"
+#include "app_event_queue.h"
+#include "app_event_stats.h"
+#include "app_task.h"
+#include "dynamic_endpoints.h"
+#include "interlocks.h"
+#ifdef CONFIG_APP_FLASH_LOG
+#include "flash_log.h"
+#endif
+#include "measurement_publisher.h"
+#include "probe_endpoints.h"
+#include "sensor_rollups.h"
+#include "sensor_task.h"
+#include "water_heater.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <lib/support/ErrorStr.h>
+#include <platform/CHIPDeviceLayer.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+namespace
+{
+/* Comparable to a DHT transaction, the slowest sensor work */
+constexpr uint32_t kBenchSensorWorkUs = 20000;
+constexpr uint32_t kBenchInjectDelayMs = 5;
+constexpr uint32_t kBenchDefaultSensorEvents = 3;
+constexpr uint32_t kBenchDefaultRounds = 10;
+constexpr uint32_t kBenchTimeoutMs = 1000;
+constexpr uint32_t kProbeBenchPollMs = 1;
+#ifdef CONFIG_APP_FLASH_LOG_BENCHMARK
+constexpr uint32_t kLogBenchDefaultRecords = 4096;
+#endif
+
+K_SEM_DEFINE(sBenchDone, 0, 1);
+k_timer sBenchTimer;
+uint32_t sBenchLatencyCycles;
+bool sBenchDuringProbeAcquisition;
+
+const char *const kClassNames[] = { "actuator", "input", "led", "sensor" };
+
+void BenchSensorHandler(const AppEvent &)
+{
+        k_busy_wait(kBenchSensorWorkUs);
+}
+
+/* Commits the staged relay levels, unchanged, so that the clock stops after
+ * the same GPIO port write as a real command without switching a relay */
+void BenchActuatorHandler(const AppEvent &event)
+{
+        Actuators::Commit();
+        sBenchLatencyCycles = k_cycle_get_32() - event.PostedAt;
+        sBenchDuringProbeAcquisition = SensorTask::Instance().ProbeAcquisitionInFlight();
+        k_sem_give(&sBenchDone);
+}
+
+void PostBenchActuatorCommand()
+{
+        AppEvent event;
+        event.Type = AppEventType::BenchmarkActuator;
+        event.Handler = BenchActuatorHandler;
+        AppTask::PostEvent(event);
+}
+
+void BenchTimerHandler(k_timer *)
+{
+        PostBenchActuatorCommand();
+}
+
+int cmd_queue_latency(const struct shell *sh, size_t argc, char **argv)
+{
+        for (size_t i = 0; i < static_cast<size_t>(AppEventClass::Count); i++) {
+                shell_print(sh, "%-8s max latency: %u us", kClassNames[i],
+                            AppEventQueue::MaxLatencyUs(static_cast<AppEventClass>(i)));
+        }
+        return 0;
+}
+
+int cmd_queue_reset(const struct shell *sh, size_t argc, char **argv)
+{
+        AppEventQueue::ResetLatency();
+        AppEventStats::Reset();
+        return 0;
+}
+
+int cmd_queue_stats(const struct shell *sh, size_t argc, char **argv)
+{
+        shell_print(sh, "type   posted  dropped coalesced dispatched");
+        for (size_t i = 0; i < AppEventStats::kTypeCount; i++) {
+                const AppEventStats::TypeCounters counters = AppEventStats::Counters(static_cast<AppEventType>(i));
+                if (counters.Posted == 0 && counters.Dispatched == 0) {
+                        continue;
+                }
+                shell_print(sh, "%4u %8u %8u %9u %10u", static_cast<unsigned>(i), counters.Posted,
+                            counters.Dropped, counters.Coalesced, counters.Dispatched);
+        }
+
+        for (size_t i = 0; i < AppEventStats::kClassCount; i++) {
+                shell_print(sh, "%-8s high-water mark: %u", kClassNames[i],
+                            AppEventStats::HighWaterMark(static_cast<AppEventClass>(i)));
+        }
+
+        shell_print(sh, "handler time histogram:");
+        for (size_t i = 0; i < AppEventStats::kHistogramBuckets; i++) {
+                const uint32_t count = AppEventStats::HistogramBucket(i);
+                if (count != 0) {
+                        shell_print(sh, "  >= %7u us: %u", i == 0 ? 0u : 1u << i, count);
+                }
+        }
+        return 0;
+}
+
+int cmd_queue_bench(const struct shell *sh, size_t argc, char **argv)
+{
+        const uint32_t capacity = AppEventQueue::Capacity(AppEventClass::Sensor);
+        uint32_t sensorEvents = argc > 1 ? strtoul(argv[1], nullptr, 0) : kBenchDefaultSensorEvents;
+        const uint32_t rounds = argc > 2 ? strtoul(argv[2], nullptr, 0) : kBenchDefaultRounds;
+        uint32_t worst = 0;
+        uint32_t dropped = 0;
+
+        if (sensorEvents > capacity) {
+                shell_warn(sh, "the sensor class queues %u events, using %u", capacity, capacity);
+                sensorEvents = capacity;
+        }
+
+        k_timer_init(&sBenchTimer, BenchTimerHandler, nullptr);
+
+        for (uint32_t round = 0; round < rounds; round++) {
+                for (uint32_t i = 0; i < sensorEvents; i++) {
+                        AppEvent event;
+                        event.Type = AppEventType::BenchmarkSensor;
+                        event.Handler = BenchSensorHandler;
+                        /* Real sensor events may hold some of the entries */
+                        if (!AppEventQueue::Post(event)) {
+                                dropped++;
+                        }
+                }
+                k_timer_start(&sBenchTimer, K_MSEC(kBenchInjectDelayMs), K_NO_WAIT);
+
+                const uint32_t timeoutMs = sensorEvents * kBenchSensorWorkUs / 1000 + kBenchTimeoutMs;
+                if (k_sem_take(&sBenchDone, K_MSEC(timeoutMs)) != 0) {
+                        shell_error(sh, "actuator event lost in round %u", round);
+                        return -ETIMEDOUT;
+                }
+                worst = MAX(worst, sBenchLatencyCycles);
+
+                /* Let the remaining sensor events drain before the next round */
+                k_sleep(K_MSEC(sensorEvents * kBenchSensorWorkUs / 1000 + 10));
+        }
+
+        shell_print(sh, "worst command-to-GPIO latency with %u queued sensor events: %u us", sensorEvents,
+                    k_cyc_to_us_ceil32(worst));
+        if (dropped) {
+                shell_warn(sh, "%u sensor events dropped, the sensor class queue was full", dropped);
+        }
+        return 0;
+}
+
+int cmd_publish_stats(const struct shell *sh, size_t argc, char **argv)
+{
+        shell_print(sh, "endpoint published suppressed");
+        for (size_t i = 0; i < MeasurementPublisher::kEndpointCount; i++) {
+                const chip::EndpointId endpoint = MeasurementPublisher::kFirstEndpoint + i;
+                const MeasurementPublisher::Counters counters = MeasurementPublisher::GetCounters(endpoint);
+                shell_print(sh, "%8u %9u %10u", static_cast<unsigned>(endpoint), counters.Published,
+                            counters.Suppressed);
+        }
+        return 0;
+}
+
+int cmd_publish_reset(const struct shell *sh, size_t argc, char **argv)
+{
+        MeasurementPublisher::ResetCounters();
+        return 0;
+}
+
+#ifdef CONFIG_APP_FLASH_LOG
+int cmd_log_stats(const struct shell *sh, size_t argc, char **argv)
+{
+        const FlashLog::Stats stats = FlashLog::GetStats();
+
+        shell_print(sh, "sectors %u used %u, head sequence %u, log time %u s", stats.Sectors, stats.UsedSectors,
+                    stats.HeadSequence, FlashLog::LogTime());
+        shell_print(sh, "erase count min %u max %u", stats.MinEraseCount, stats.MaxEraseCount);
+        shell_print(sh, "appended %u dropped %u crc errors %u write errors %u", stats.Appended, stats.Dropped,
+                    stats.CrcErrors, stats.WriteErrors);
+        return 0;
+}
+
+int cmd_log_flush(const struct shell *sh, size_t argc, char **argv)
+{
+        return FlashLog::Flush();
+}
+
+#ifdef CONFIG_APP_FLASH_LOG_BENCHMARK
+int cmd_log_bench(const struct shell *sh, size_t argc, char **argv)
+{
+        const uint32_t records = argc > 1 ? strtoul(argv[1], nullptr, 0) : kLogBenchDefaultRecords;
+        FlashLog::BenchmarkResult result;
+
+        const int ret = FlashLog::Benchmark(records, result);
+        if (ret) {
+                shell_error(sh, "benchmark failed: %d", ret);
+                return ret;
+        }
+
+        shell_print(sh, "append: %u records in %u us, %u records/s", result.Records, result.AppendUs,
+                    result.AppendUs ? static_cast<uint32_t>(uint64_t(result.Records) * 1000000 / result.AppendUs) :
+                                      0);
+        shell_print(sh, "query last hour: %u records in %u us", result.QueryRecords, result.QueryUs);
+        return 0;
+}
+#endif
+#endif
+
+const char *const kResolutionNames[] = { "minute", "hour", "day" };
+static_assert(ARRAY_SIZE(kResolutionNames) == SensorRollups::kResolutionCount, "one name per resolution");
+
+bool ParseResolution(const struct shell *sh, const char *name, RollupResolution &resolution)
+{
+        for (size_t i = 0; i < ARRAY_SIZE(kResolutionNames); i++) {
+                if (strcmp(name, kResolutionNames[i]) == 0) {
+                        resolution = static_cast<RollupResolution>(i);
+                        return true;
+                }
+        }
+
+        shell_error(sh, "unknown resolution %s", name);
+        return false;
+}
+
+void PrintSummary(const struct shell *sh, unsigned channel, const SensorRollups::Summary &summary)
+{
+        shell_print(sh, "%7u %10u %6u %6d %6d %6d", channel, summary.Start, summary.Values.Count,
+                    summary.Values.Min, summary.Values.Max, summary.Values.Mean());
+}
+
+int cmd_rollup_show(const struct shell *sh, size_t argc, char **argv)
+{
+        RollupResolution resolution;
+
+        if (!ParseResolution(sh, argv[1], resolution)) {
+                return -EINVAL;
+        }
+
+        shell_print(sh, "channel      start  count    min    max   mean");
+        for (size_t channel = 0; channel < SensorHistory::kChannelCount; channel++) {
+                const SensorRollups::Summary summary =
+                        SensorRollups::Current(static_cast<HistoryChannel>(channel), resolution);
+                if (summary.Values.Count > 0) {
+                        PrintSummary(sh, static_cast<unsigned>(channel), summary);
+                }
+        }
+        return 0;
+}
+
+#ifdef CONFIG_APP_FLASH_LOG
+int cmd_rollup_query(const struct shell *sh, size_t argc, char **argv)
+{
+        RollupResolution resolution;
+
+        if (!ParseResolution(sh, argv[1], resolution)) {
+                return -EINVAL;
+        }
+
+        const uint32_t channel = strtoul(argv[2], nullptr, 0);
+        const uint32_t seconds = strtoul(argv[3], nullptr, 0);
+        const uint32_t now = FlashLog::LogTime();
+
+        if (channel >= SensorHistory::kChannelCount) {
+                shell_error(sh, "unknown channel %u", channel);
+                return -EINVAL;
+        }
+
+        struct QueryContext {
+                const struct shell *Shell;
+                unsigned Channel;
+        } context = { sh, channel };
+
+        shell_print(sh, "channel      start  count    min    max   mean");
+        return SensorRollups::Query(
+                static_cast<HistoryChannel>(channel), resolution, now > seconds ? now - seconds : 0, now,
+                [](const SensorRollups::Summary &summary, void *queryContext) {
+                        const QueryContext &query = *static_cast<const QueryContext *>(queryContext);
+                        PrintSummary(query.Shell, query.Channel, summary);
+                        return true;
+                },
+                &context);
+}
+#endif
+
+int cmd_sampling_show(const struct shell *sh, size_t argc, char **argv)
+{
+        uint32_t totalSavedUj = 0;
+
+        shell_print(sh, "sensor  interval ms samples rate mHz avoided saved %%");
+        for (size_t i = 0; i < static_cast<size_t>(SensorId::Count); i++) {
+                const SensorTask::SamplingStats stats =
+                        SensorTask::Instance().GetSamplingStats(static_cast<SensorId>(i));
+                const uint32_t rateMhz =
+                        stats.ElapsedMs ? static_cast<uint32_t>(stats.Samples * 1000000ULL / stats.ElapsedMs) : 0;
+                const uint32_t fixedSamples = stats.Samples + stats.Avoided;
+
+                shell_print(sh, "%-7s %11u %7u %8u %7u %7u", stats.Name, stats.IntervalMs, stats.Samples, rateMhz,
+                            stats.Avoided, fixedSamples ? stats.Avoided * 100 / fixedSamples : 0);
+                totalSavedUj += stats.EnergySavedUj;
+        }
+        shell_print(sh, "estimated sensor energy saved %u.%03u mJ", totalSavedUj / 1000, totalSavedUj % 1000);
+
+        shell_print(sh, "Matter idle wait %s", SensorTask::Instance().MatterIdleWait() ? "on" : "off");
+        shell_print(sh, "sensor  attempts failures checksum deferred forced");
+        for (size_t i = 0; i < static_cast<size_t>(SensorId::Count); i++) {
+                const SensorId sensor = static_cast<SensorId>(i);
+                const SensorTask::AcquisitionCounters counters =
+                        SensorTask::Instance().GetAcquisitionCounters(sensor);
+
+                shell_print(sh, "%-7s %8u %8u %8u %8u %6u", SensorTask::Instance().GetSamplingStats(sensor).Name,
+                            counters.Attempts, counters.Failures, counters.ChecksumErrors, counters.Deferred,
+                            counters.Forced);
+        }
+
+        static const char *const kStateNames[] = { "ok", "retrying", "failed" };
+        const int64_t now = k_uptime_get();
+
+        shell_print(sh, "sensor  probe state    in a row failures faults last ok s");
+        for (size_t i = 0; i < static_cast<size_t>(SensorId::Count); i++) {
+                const SensorId sensor = static_cast<SensorId>(i);
+                const size_t probes = sensor == SensorId::WaterTemp ?
+                                              MAX(SensorTask::Instance().ProbeCount(), static_cast<size_t>(1)) :
+                                              1;
+
+                for (size_t probe = 0; probe < probes; probe++) {
+                        const SensorTask::HealthStats health = SensorTask::Instance().GetHealth(sensor, probe);
+                        const char *name = SensorTask::Instance().GetSamplingStats(sensor).Name;
+                        const char *state = kStateNames[static_cast<size_t>(health.State)];
+
+                        if (health.LastSuccessMs < 0) {
+                                shell_print(sh, "%-7s %5u %-8s %8u %8u %6u     never", name,
+                                            static_cast<unsigned>(probe), state, health.ConsecutiveFailures,
+                                            health.Failures, health.Faults);
+                        } else {
+                                shell_print(sh, "%-7s %5u %-8s %8u %8u %6u %9u", name, static_cast<unsigned>(probe),
+                                            state, health.ConsecutiveFailures, health.Failures, health.Faults,
+                                            static_cast<uint32_t>((now - health.LastSuccessMs) / 1000));
+                        }
+                }
+        }
+        return 0;
+}
+
+int cmd_sampling_reset(const struct shell *sh, size_t argc, char **argv)
+{
+        SensorTask::Instance().ResetAcquisitionCounters();
+        return 0;
+}
+
+int cmd_sampling_wait(const struct shell *sh, size_t argc, char **argv)
+{
+        const bool on = strcmp(argv[1], "on") == 0;
+
+        if (!on && strcmp(argv[1], "off") != 0) {
+                shell_error(sh, "expected on or off");
+                return -EINVAL;
+        }
+
+        SensorTask::Instance().SetMatterIdleWait(on);
+        if (on && !SensorTask::Instance().MatterIdleWait()) {
+                shell_warn(sh, "disabled by CONFIG_APP_SENSOR_MATTER_IDLE_WAIT_MS");
+        }
+        return 0;
+}
+
+int cmd_probes_show(const struct shell *sh, size_t argc, char **argv)
+{
+        const size_t count = SensorTask::Instance().ProbeCount();
+
+        shell_print(sh, "probe rom id           endpoint");
+        for (size_t probe = 0; probe < count; probe++) {
+                shell_print(sh, "%5u %016llx %8u", static_cast<unsigned>(probe),
+                            static_cast<unsigned long long>(SensorTask::Instance().ProbeId(probe)),
+                            ProbeEndpoints::EndpointOf(probe));
+        }
+        return 0;
+}
+
+int cmd_probes_forget(const struct shell *sh, size_t argc, char **argv)
+{
+        const int ret = SensorTask::Instance().ForgetProbes();
+
+        if (ret) {
+                shell_error(sh, "Cannot clear the probe IDs: %d", ret);
+                return ret;
+        }
+        shell_print(sh, "The probes will be numbered again at the next boot");
+        return 0;
+}
+
+int cmd_probes_timing(const struct shell *sh, size_t argc, char **argv)
+{
+        const SensorTask::ProbeTimings timings = SensorTask::Instance().GetProbeTimings();
+
+        shell_print(sh, "%u acquisitions, conversion time %u ms", timings.Acquisitions, timings.ConversionMs);
+        shell_print(sh, "           last      max");
+        shell_print(sh, "convert %6u %8u us", timings.ConvertUs, timings.MaxConvertUs);
+        shell_print(sh, "wait    %6u %8u ms", timings.WaitMs, timings.MaxWaitMs);
+        shell_print(sh, "read    %6u %8u us", timings.ReadUs, timings.MaxReadUs);
+        shell_print(sh, "latency %6u %8u ms", timings.LatencyMs, timings.MaxLatencyMs);
+        return 0;
+}
+
+bool WaitProbeAcquisition(bool inFlight, int64_t deadline)
+{
+        while (SensorTask::Instance().ProbeAcquisitionInFlight() != inFlight) {
+                if (k_uptime_get() > deadline) {
+                        return false;
+                }
+                k_msleep(kProbeBenchPollMs);
+        }
+        return true;
+}
+
+int cmd_probes_bench(const struct shell *sh, size_t argc, char **argv)
+{
+        SensorTask &sensors = SensorTask::Instance();
+        const uint32_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 0) : kBenchDefaultRounds;
+        /* An expedited acquisition starts within the longest sampling interval */
+        const uint32_t timeoutMs = CONFIG_APP_SENSOR_MAX_INTERVAL_MS + sensors.GetProbeTimings().ConversionMs;
+        uint32_t worst = 0;
+        uint32_t overlapped = 0;
+
+        if (sensors.ProbeCount() == 0) {
+                shell_error(sh, "no DS18B20 probe on the bus");
+                return -ENODEV;
+        }
+
+        for (uint32_t round = 0; round < rounds; round++) {
+                sensors.Expedite(SensorBit(SensorId::WaterTemp));
+                if (!WaitProbeAcquisition(true, k_uptime_get() + timeoutMs)) {
+                        shell_error(sh, "no DS18B20 acquisition in round %u", round);
+                        return -ETIMEDOUT;
+                }
+
+                PostBenchActuatorCommand();
+                if (k_sem_take(&sBenchDone, K_MSEC(kBenchTimeoutMs)) != 0) {
+                        shell_error(sh, "actuator event lost in round %u", round);
+                        return -ETIMEDOUT;
+                }
+                worst = MAX(worst, sBenchLatencyCycles);
+                if (sBenchDuringProbeAcquisition) {
+                        overlapped++;
+                }
+
+                /* Start the next round on a new acquisition */
+                if (!WaitProbeAcquisition(false, k_uptime_get() + timeoutMs)) {
+                        shell_error(sh, "DS18B20 acquisition stuck in round %u", round);
+                        return -ETIMEDOUT;
+                }
+        }
+
+        shell_print(sh, "worst command-to-GPIO latency during a DS18B20 acquisition: %u us",
+                    k_cyc_to_us_ceil32(worst));
+        shell_print(sh, "%u of %u commands committed before the %u ms conversion ended", overlapped, rounds,
+                    sensors.GetProbeTimings().ConversionMs);
+        return 0;
+}
+
+int cmd_probes_rescan(const struct shell *sh, size_t argc, char **argv)
+{
+        const int ret = SensorTask::Instance().RescanProbes();
+
+        if (ret < 0) {
+                shell_error(sh, "Cannot search the 1-Wire bus: %d", ret);
+                return ret;
+        }
+        shell_print(sh, "%d probe(s) found, applied at the next boot", ret);
+        return 0;
+}
+
+const char *KindName(DynamicEndpointKind kind)
+{
+        switch (kind) {
+        case DynamicEndpointKind::Temperature:
+                return "temperature";
+        case DynamicEndpointKind::Humidity:
+                return "humidity";
+        default:
+                return "on/off";
+        }
+}
+
+int cmd_endpoints_show(const struct shell *sh, size_t argc, char **argv)
+{
+        DynamicEndpoints::Info info;
+
+        shell_print(sh, "slot endpoint kind        device id        found");
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        for (size_t slot = 0; slot < DynamicEndpoints::kPoolSize; slot++) {
+                if (DynamicEndpoints::GetInfo(slot, info)) {
+                        shell_print(sh, "%4u %8u %-11s %016llx %s", static_cast<unsigned>(slot), info.Endpoint,
+                                    KindName(info.Kind), static_cast<unsigned long long>(info.Uid),
+                                    info.Attached ? "yes" : "no");
+                }
+        }
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+        return 0;
+}
+
+int cmd_endpoints_switch(const struct shell *sh, size_t argc, char **argv)
+{
+        chip::EndpointId endpoint;
+
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        const CHIP_ERROR err = DynamicEndpoints::AddSwitch(DynamicEndpoints::kVirtualSwitch, nullptr, endpoint);
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+
+        if (err != CHIP_NO_ERROR) {
+                shell_error(sh, "Cannot add the switch: %s", chip::ErrorStr(err));
+                return -ENOMEM;
+        }
+        shell_print(sh, "Virtual switch on endpoint %u", endpoint);
+        return 0;
+}
+
+int cmd_endpoints_remove(const struct shell *sh, size_t argc, char **argv)
+{
+        const chip::EndpointId endpoint = static_cast<chip::EndpointId>(strtoul(argv[1], nullptr, 10));
+
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        const CHIP_ERROR err = DynamicEndpoints::Remove(endpoint);
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+
+        if (err != CHIP_NO_ERROR) {
+                shell_error(sh, "unknown dynamic endpoint %u", endpoint);
+                return -ENOENT;
+        }
+        return 0;
+}
+
+int cmd_heater_show(const struct shell *sh, size_t argc, char **argv)
+{
+        const WaterHeater::Config config = WaterHeater::GetConfig();
+
+        shell_print(sh, "%s, setpoint %d (0.01 C), window %u ms", config.Enabled ? "enabled" : "disabled",
+                    config.Setpoint, config.WindowMs);
+        shell_print(sh, "kp %d ki %d kd %d (0.001 units)", FixedPointPid::ToMilli(config.Gains.Kp),
+                    FixedPointPid::ToMilli(config.Gains.Ki), FixedPointPid::ToMilli(config.Gains.Kd));
+        shell_print(sh, "duty %u / %u", WaterHeater::Duty(), WaterHeater::kMaxDuty);
+        return 0;
+}
+
+int SetHeaterEnabled(bool enabled)
+{
+        WaterHeater::Config config = WaterHeater::GetConfig();
+        config.Enabled = enabled;
+        return WaterHeater::SetConfig(config);
+}
+
+int cmd_heater_enable(const struct shell *sh, size_t argc, char **argv)
+{
+        return SetHeaterEnabled(true);
+}
+
+int cmd_heater_disable(const struct shell *sh, size_t argc, char **argv)
+{
+        return SetHeaterEnabled(false);
+}
+
+int cmd_heater_setpoint(const struct shell *sh, size_t argc, char **argv)
+{
+        WaterHeater::Config config = WaterHeater::GetConfig();
+        config.Setpoint = static_cast<int16_t>(strtol(argv[1], nullptr, 0));
+        return WaterHeater::SetConfig(config);
+}
+
+int cmd_heater_window(const struct shell *sh, size_t argc, char **argv)
+{
+        WaterHeater::Config config = WaterHeater::GetConfig();
+        config.WindowMs = strtoul(argv[1], nullptr, 0);
+
+        const int ret = WaterHeater::SetConfig(config);
+        if (ret == -EINVAL) {
+                shell_error(sh, "window too short");
+        }
+        return ret;
+}
+
+int cmd_heater_gains(const struct shell *sh, size_t argc, char **argv)
+{
+        WaterHeater::Config config = WaterHeater::GetConfig();
+        config.Gains.Kp = FixedPointPid::FromMilli(strtol(argv[1], nullptr, 0));
+        config.Gains.Ki = FixedPointPid::FromMilli(strtol(argv[2], nullptr, 0));
+        config.Gains.Kd = FixedPointPid::FromMilli(strtol(argv[3], nullptr, 0));
+        return WaterHeater::SetConfig(config);
+}
+
+int cmd_interlocks_show(const struct shell *sh, size_t argc, char **argv)
+{
+        static const char *const kConditionNames[] = { "above", "below", "stale ms" };
+        Interlocks::Status status;
+
+        shell_print(sh, "rule name                 condition       limit endpoint alarm   trips reaction ms");
+        for (size_t i = 0; Interlocks::GetStatus(i, status); i++) {
+                const InterlockRule &rule = *status.Rule;
+
+                shell_print(sh, "%4u %-20s %-9s %11d %8u %-7s %5u %11u", static_cast<unsigned>(i), rule.Name,
+                            kConditionNames[static_cast<size_t>(rule.Condition)], rule.Limit, rule.Actuator,
+                            status.Latched ? "latched" : (status.Violating ? "present" : "-"), status.Trips,
+                            Interlocks::WorstCaseReactionMs(rule));
+        }
+        return 0;
+}
+
+int cmd_interlocks_ack(const struct shell *sh, size_t argc, char **argv)
+{
+        const bool all = strcmp(argv[1], "all") == 0;
+        const size_t first = all ? 0 : strtoul(argv[1], nullptr, 10);
+        const size_t last = all ? Interlocks::RuleCount() : first + 1;
+
+        if (first >= Interlocks::RuleCount()) {
+                shell_error(sh, "unknown rule %s", argv[1]);
+                return -EINVAL;
+        }
+
+        int ret = 0;
+        for (size_t i = first; i < last; i++) {
+                if (Interlocks::Acknowledge(i) == -EBUSY) {
+                        shell_error(sh, "rule %u: condition still present", static_cast<unsigned>(i));
+                        ret = -EBUSY;
+                }
+        }
+        return ret;
+}
+
+} /* namespace */
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_queue,
+                               SHELL_CMD(latency, NULL, "Print the worst latency per event class", cmd_queue_latency),
+                               SHELL_CMD(reset, NULL, "Reset the latency records and statistics", cmd_queue_reset),
+                               SHELL_CMD(stats, NULL, "Print the event statistics", cmd_queue_stats),
+                               SHELL_CMD_ARG(bench, NULL, "Actuator latency under sensor load [sensor_events] [rounds]",
+                                             cmd_queue_bench, 1, 2),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_publish,
+                               SHELL_CMD(stats, NULL, "Print the publish counters", cmd_publish_stats),
+                               SHELL_CMD(reset, NULL, "Reset the publish counters", cmd_publish_reset),
+                               SHELL_SUBCMD_SET_END);
+
+#ifdef CONFIG_APP_FLASH_LOG
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_log, SHELL_CMD(stats, NULL, "Print the flash log statistics", cmd_log_stats),
+                               SHELL_CMD(flush, NULL, "Program the batched records", cmd_log_flush),
+#ifdef CONFIG_APP_FLASH_LOG_BENCHMARK
+                               SHELL_CMD_ARG(bench, NULL, "Append and query benchmark [records]", cmd_log_bench, 1,
+                                             1),
+#endif
+                               SHELL_SUBCMD_SET_END);
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_rollup,
+                               SHELL_CMD_ARG(show, NULL, "Rollups in progress <minute|hour|day>", cmd_rollup_show, 2,
+                                             0),
+#ifdef CONFIG_APP_FLASH_LOG
+                               SHELL_CMD_ARG(query, NULL, "Stored rollups <minute|hour|day> <channel> <seconds>",
+                                             cmd_rollup_query, 4, 0),
+#endif
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sampling,
+                               SHELL_CMD(show, NULL, "Print the sampling statistics", cmd_sampling_show),
+                               SHELL_CMD(reset, NULL, "Reset the acquisition and fault counters", cmd_sampling_reset),
+                               SHELL_CMD_ARG(wait, NULL, "Wait for an idle Matter thread <on|off>",
+                                             cmd_sampling_wait, 2, 0),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_probes, SHELL_CMD(show, NULL, "Print the DS18B20 probes", cmd_probes_show),
+                               SHELL_CMD(forget, NULL, "Renumber the probes at the next boot", cmd_probes_forget),
+                               SHELL_CMD(rescan, NULL, "Search the 1-Wire bus for the next boot",
+                                         cmd_probes_rescan),
+                               SHELL_CMD(timing, NULL, "Print the DS18B20 acquisition times", cmd_probes_timing),
+                               SHELL_CMD_ARG(bench, NULL, "Actuator latency during a DS18B20 acquisition [rounds]",
+                                             cmd_probes_bench, 1, 1),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_endpoints,
+                               SHELL_CMD(show, NULL, "Print the dynamic endpoints", cmd_endpoints_show),
+                               SHELL_CMD(switch, NULL, "Add a virtual On/Off switch", cmd_endpoints_switch),
+                               SHELL_CMD_ARG(remove, NULL, "Remove a dynamic endpoint <endpoint>",
+                                             cmd_endpoints_remove, 2, 0),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_heater,
+                               SHELL_CMD(show, NULL, "Print the water heater configuration", cmd_heater_show),
+                               SHELL_CMD(enable, NULL, "Regulate the water heater on the device", cmd_heater_enable),
+                               SHELL_CMD(disable, NULL, "Leave the water heater to On/Off commands",
+                                         cmd_heater_disable),
+                               SHELL_CMD_ARG(setpoint, NULL, "Water setpoint <0.01 C>", cmd_heater_setpoint, 2, 0),
+                               SHELL_CMD_ARG(window, NULL, "Time-proportional window <ms>", cmd_heater_window, 2, 0),
+                               SHELL_CMD_ARG(gains, NULL, "PID gains <kp> <ki> <kd>, 0.001 units", cmd_heater_gains,
+                                             4, 0),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_interlocks,
+                               SHELL_CMD(show, NULL, "Print the safety interlocks", cmd_interlocks_show),
+                               SHELL_CMD_ARG(ack, NULL, "Acknowledge latched alarms <rule|all>", cmd_interlocks_ack,
+                                             2, 0),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_terrarium, SHELL_CMD(queue, &sub_queue, "App event queue", NULL),
+                               SHELL_CMD(publish, &sub_publish, "Measurement publishing", NULL),
+#ifdef CONFIG_APP_FLASH_LOG
+                               SHELL_CMD(log, &sub_log, "Flash log", NULL),
+#endif
+                               SHELL_CMD(rollup, &sub_rollup, "Sensor rollups", NULL),
+                               SHELL_CMD(sampling, &sub_sampling, "Sensor sampling", NULL),
+                               SHELL_CMD(probes, &sub_probes, "DS18B20 probes", NULL),
+                               SHELL_CMD(endpoints, &sub_endpoints, "Dynamic endpoints", NULL),
+                               SHELL_CMD(heater, &sub_heater, "Water heater PID", NULL),
+                               SHELL_CMD(interlocks, &sub_interlocks, "Safety interlocks", NULL),
+                               SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(terrarium, &sub_terrarium, "Terrarium commands", NULL);
@@ -5,8 +5,28 @@
  */
 
 #include "app_task.h"
+#include "actuators.h"
 #include "app_config.h"
+#include "app_event_queue.h"
+#include "app_event_stats.h"
+#include "dynamic_endpoints.h"
+#ifdef CONFIG_APP_FLASH_LOG
+#include "flash_log.h"
+#endif
+#include "hot_lamp_thermostat.h"
+#include "interlocks.h"
 #include "led_util.h"
+#include "matter_units.h"
+#include "measurement_publisher.h"
+#include "probe_endpoints.h"
+#include "sensor_history.h"
+#include "sensor_rollups.h"
+#include "sensor_task.h"
+#include "spike_filter.h"
+#include "terrarium_endpoint.h"
+#include "terrarium_snapshot.h"
+#include "timed_actuation.h"
+#include "water_heater.h"
 
 #include <platform/CHIPDeviceLayer.h>
 
@@ -36,7 +56,6 @@
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/sensor.h>
-#include <zephyr/drivers/pwm.h>
 #include <app-common/zap-generated/attributes/Accessors.h>
 
 LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
@@ -48,10 +67,8 @@ using namespace ::chip::DeviceLayer;
 
 namespace
 {
-constexpr size_t kAppEventQueueSize = 10;
 constexpr uint32_t kFactoryResetTriggerTimeout = 6000;
 
-K_MSGQ_DEFINE(sAppEventQueue, sizeof(AppEvent), kAppEventQueueSize, alignof(AppEvent));
 k_timer sFunctionTimer;
 
 LEDWidget sStatusLED;
@@ -65,6 +82,28 @@ FactoryResetLEDsWrapper<3> sFactoryResetLEDs{ { FACTORY_RESET_SIGNAL_LED, FACTOR
 bool sIsNetworkProvisioned = false;
 bool sIsNetworkEnabled = false;
 bool sHaveBLEConnections = false;
+
+/* Spike rejection of the DHT channels, see spike_filter.h */
+using DhtFilter = SpikeFilter<CONFIG_APP_DHT_FILTER_WINDOW>;
+
+DhtFilter sHotSpotTemperatureFilter(CONFIG_APP_DHT_MAX_TEMPERATURE_RATE);
+DhtFilter sHotSpotHumidityFilter(CONFIG_APP_DHT_MAX_HUMIDITY_RATE);
+DhtFilter sColdZoneTemperatureFilter(CONFIG_APP_DHT_MAX_TEMPERATURE_RATE);
+DhtFilter sColdZoneHumidityFilter(CONFIG_APP_DHT_MAX_HUMIDITY_RATE);
+
+/* The filtered values replace the readings for the history, the publishing
+ * and the control loops */
+struct sensor_value FilterTemperature(DhtFilter &filter, const SensorSample &sample)
+{
+        return MatterUnits::FromHundredths(
+                filter.Update(MatterUnits::ToMatterTemperature(sample.Temperature), sample.Timestamp));
+}
+
+struct sensor_value FilterHumidity(DhtFilter &filter, const SensorSample &sample)
+{
+        return MatterUnits::FromHundredths(
+                filter.Update(MatterUnits::ToMatterHumidity(sample.Humidity), sample.Timestamp));
+}
 } /* namespace */
 
 namespace LedConsts
@@ -90,29 +129,8 @@ app::Clusters::NetworkCommissioning::Instance
         sWiFiCommissioningInstance(0, &(NetworkCommissioning::NrfWiFiDriver::Instance()));
 #endif
 
-/* Software timer to periodically fetch the sensors */
-k_timer sSensorTimer;
-/* Software timer to monostable actuation of the feeder */
-k_timer sFeederMonoTimer;
-
 static const struct gpio_dt_spec ls1 = GPIO_DT_SPEC_GET(DT_ALIAS(level_shifter1), gpios);
 
-static const struct pwm_dt_spec servo = PWM_DT_SPEC_GET(DT_ALIAS(servo));
-static const uint32_t min_pulse = DT_PROP(DT_ALIAS(servo), min_pulse);
-static const uint32_t max_pulse = DT_PROP(DT_ALIAS(servo), max_pulse);
-volatile uint32_t pulse = (uint32_t)(1050000);
-
-
-static const struct device *const dht11 = DEVICE_DT_GET(DT_ALIAS(dht11));
-static const struct device *const dht22 = DEVICE_DT_GET(DT_ALIAS(dht22));
-
-static const struct device *const ds18b20 = DEVICE_DT_GET(DT_ALIAS(ds18b20));
-
-static const struct  gpio_dt_spec rel1 = GPIO_DT_SPEC_GET(DT_ALIAS(relay1), gpios);
-static const struct  gpio_dt_spec rel2 = GPIO_DT_SPEC_GET(DT_ALIAS(relay2), gpios);
-static const struct  gpio_dt_spec rel3 = GPIO_DT_SPEC_GET(DT_ALIAS(relay3), gpios);
-static const struct  gpio_dt_spec rel4 = GPIO_DT_SPEC_GET(DT_ALIAS(relay4), gpios);
-
 /* Global data of last measures */
 struct sensor_value last_temperature_1;
 struct sensor_value last_humidity_1;
@@ -120,31 +138,27 @@ struct sensor_value last_temperature_2;
 struct sensor_value last_humidity_2;
 struct sensor_value last_temperature_3;
 
-/* The SensorTimerHandler callback is called periodically
- * every 5 seconds.
- * In this callback will be sent 3 events to the main app
- * handler, ones per sensor. */
-void SensorTimerHandler(k_timer *timer)
+/* Called by the sensor thread every time a sample is pushed
+ * into the ring, the sample is published from the app task */
+void SensorSampleReadyHandler()
 {
-        AppEvent hot_ev, cold_ev, water_ev;
-        
-        hot_ev.Type = AppEventType::HotSensorMeasure;
-        hot_ev.Handler = AppTask::HotSensorMeasureHandler;
-        AppTask::Instance().PostEvent(hot_ev);
-                
-        cold_ev.Type = AppEventType::ColdSensorMeasure;
-        cold_ev.Handler = AppTask::ColdSensorMeasureHandler;
-        AppTask::Instance().PostEvent(cold_ev);
-                
-        water_ev.Type = AppEventType::WaterTempSensorMeasure;
-        water_ev.Handler = AppTask::WaterTempSensorMeasureHandler;
-        AppTask::Instance().PostEvent(water_ev);
+        AppEvent sample_ev;
+
+        sample_ev.Type = AppEventType::SensorSample;
+        sample_ev.Handler = AppTask::SensorSampleHandler;
+        AppTask::Instance().PostEvent(sample_ev);
 }
 
-/* At activation timeout the feeder change it's state to Off */
-void FeederMonoTimerHandler(k_timer *timer)
+/* Keep a successful measurement in the RAM history, in the flash log and
+ * in the rollups */
+void RecordMeasurement(HistoryChannel channel, int64_t timestamp, int16_t value)
 {
-        chip::app::Clusters::OnOff::Attributes::OnOff::Set(/* endpoint ID */ 6, /* On/Off state */ false);
+        SensorHistory::Record(channel, timestamp, value);
+#ifdef CONFIG_APP_FLASH_LOG
+        FlashLog::RecordMeasurement(channel, timestamp, value);
+#endif
+        SensorRollups::Record(channel, timestamp, value);
+        TerrariumSnapshot::SetMeasurement(channel, value);
 }
 
 CHIP_ERROR AppTask::Init()
@@ -212,62 +226,40 @@ CHIP_ERROR AppTask::Init()
         }
         gpio_pin_configure_dt(&ls1, GPIO_OUTPUT_ACTIVE);
 
-        /* Initialize SERVO */
-        ret = device_is_ready(servo.dev);
-        if (!ret) {
-                LOG_ERR("Device %s is not ready\n", servo.dev->name);
-                return chip::System::MapErrorZephyr(ret);
-        }
-
-        /* Initialize DHT11 */
-        ret = device_is_ready(dht11);
-        if (!ret) {
-                LOG_ERR("Device %s is not ready\n", dht11->name);
-                return chip::System::MapErrorZephyr(ret);
-        }
-
-        /* Initialize DHT22 */
-        ret = device_is_ready(dht22);
-        if (!ret) {
-                LOG_ERR("Device %s is not ready\n", dht22->name);
+        /* Initialize sensors */
+        ret = SensorTask::Instance().Init(SensorSampleReadyHandler);
+        if (ret) {
+                LOG_ERR("SensorTask::Init() failed");
                 return chip::System::MapErrorZephyr(ret);
         }
 
-        /* Initialize DS18B20 */
-        ret = device_is_ready(ds18b20);
-        if (!ret) {
-                LOG_ERR("Device %s is not ready\n", ds18b20->name);
+        /* Initialize RELAYs and SERVO */
+        ret = Actuators::Init();
+        if (ret) {
+                LOG_ERR("Actuators::Init() failed");
                 return chip::System::MapErrorZephyr(ret);
         }
 
-        /* Initialize RELAYs */
-        ret = gpio_is_ready_dt(&rel1);
-        if (!ret) {
-                LOG_ERR("gpio_is_ready_dt(&rel1) failed");
+        /* The safety interlocks run on the sensor thread from its start */
+        ret = Interlocks::Init();
+        if (ret) {
+                LOG_ERR("Interlocks::Init() failed");
                 return chip::System::MapErrorZephyr(ret);
         }
-        gpio_pin_configure_dt(&rel1, GPIO_OUTPUT_HIGH);
 
-        ret = gpio_is_ready_dt(&rel2);
-        if (!ret) {
-                LOG_ERR("gpio_is_ready_dt(&rel2) failed");
-                return chip::System::MapErrorZephyr(ret);
+#ifdef CONFIG_APP_FLASH_LOG
+        /* The device keeps working without the persistent history */
+        ret = FlashLog::Init();
+        if (ret) {
+                LOG_ERR("FlashLog::Init() failed: %d", ret);
         }
-        gpio_pin_configure_dt(&rel2, GPIO_OUTPUT_HIGH);
+#endif
 
-        ret = gpio_is_ready_dt(&rel3);
-        if (!ret) {
-                LOG_ERR("gpio_is_ready_dt(&rel3) failed");
-                return chip::System::MapErrorZephyr(ret);
-        }
-        gpio_pin_configure_dt(&rel3, GPIO_OUTPUT_HIGH);
-        
-        ret = gpio_is_ready_dt(&rel4);
-        if (!ret) {
-                LOG_ERR("gpio_is_ready_dt(&rel4) failed");
-                return chip::System::MapErrorZephyr(ret);
+        /* Resume the rollups in progress before the reboot */
+        ret = SensorRollups::Init();
+        if (ret) {
+                LOG_ERR("SensorRollups::Init() failed: %d", ret);
         }
-        gpio_pin_configure_dt(&rel4, GPIO_OUTPUT_HIGH);
 
         /* Enable Level Shifter */
         gpio_pin_set_dt(&ls1, 1);
@@ -291,6 +283,16 @@ CHIP_ERROR AppTask::Init()
         (void)initParams.InitializeStaticResourcesBeforeServerInit();
 
         ReturnErrorOnFailure(chip::Server::GetInstance().Init(initParams));
+        ReturnErrorOnFailure(TerrariumEndpoint::Init());
+        ReturnErrorOnFailure(HotLampThermostat::Init());
+        ReturnErrorOnFailure(DynamicEndpoints::Init());
+        ReturnErrorOnFailure(ProbeEndpoints::Init());
+        ReturnErrorOnFailure(TimedActuation::Init());
+        ret = WaterHeater::Init();
+        if (ret) {
+                LOG_ERR("WaterHeater::Init() failed");
+                return chip::System::MapErrorZephyr(ret);
+        }
         ConfigurationMgr().LogDeviceConfig();
         PrintOnboardingCodes(chip::RendezvousInformationFlags(chip::RendezvousInformationFlag::kBLE));
 
@@ -314,15 +316,8 @@ CHIP_ERROR AppTask::Init()
         memset(&last_humidity_2, 0x00, sizeof(last_humidity_2));
         memset(&last_temperature_3, 0x00, sizeof(last_temperature_3));
 
-        /* Init the Sensors Timer to periodically call the
-         * SensorTimerHandler every 5 seconds and start it */
-        k_timer_init(&sSensorTimer, &SensorTimerHandler, nullptr);
-        k_timer_user_data_set(&sSensorTimer, this);
-        k_timer_start(&sSensorTimer, K_MSEC(5000), K_MSEC(5000));
-
-        /* Init the Feeder Timer */
-        k_timer_init(&sFeederMonoTimer, &FeederMonoTimerHandler, nullptr);
-        k_timer_user_data_set(&sFeederMonoTimer, this);
+        /* Start the sensors acquisition thread */
+        SensorTask::Instance().Start();
 
         return CHIP_NO_ERROR;
 }
@@ -334,7 +329,7 @@ CHIP_ERROR AppTask::StartApp()
         AppEvent event = {};
 
         while (true) {
-                k_msgq_get(&sAppEventQueue, &event, K_FOREVER);
+                AppEventQueue::Get(event);
                 DispatchEvent(event);
         }
 
@@ -437,71 +432,23 @@ void AppTask::UpdateStatusLED()
         }
 }
 
-/* Turn on the hot lamp */
-void AppTask::HotLampActivateHandler(const AppEvent &)
-{
-        gpio_pin_set_dt(&rel1, 0);
-}
-
-/* Turn off the hot lamp */
-void AppTask::HotLampDeactivateHandler(const AppEvent &)
-{
-        gpio_pin_set_dt(&rel1, 1);
-}
-
-/* Turn on the uvb lamp */
-void AppTask::UvbLampActivateHandler(const AppEvent &)
+/* Stage the actuator of the command endpoint, the relays
+ * are switched together by the following ActuatorCommit */
+void AppTask::ActuatorCommandHandler(const AppEvent &event)
 {
-        gpio_pin_set_dt(&rel2, 0);
-}
+        const ActuatorDescriptor *actuator = Actuators::Find(event.ActuatorEvent.Endpoint);
 
-/* Turn off the uvb lamp */
-void AppTask::UvbLampDeactivateHandler(const AppEvent &)
-{
-        gpio_pin_set_dt(&rel2, 1);
-}
-
-/* Turn on the water heater */
-void AppTask::HeaterActivateHandler(const AppEvent &)
-{
-        gpio_pin_set_dt(&rel3, 0);
-}
-
-/* Turn off the water heater */
-void AppTask::HeaterDeactivateHandler(const AppEvent &)
-{
-        gpio_pin_set_dt(&rel3, 1);
-}
-
-/* Turn on the filter pump */
-void AppTask::FilterActivateHandler(const AppEvent &)
-{
-        gpio_pin_set_dt(&rel4, 0);
-}
-
-/* Turn off the filter pump */
-void AppTask::FilterDeactivateHandler(const AppEvent &)
-{
-        gpio_pin_set_dt(&rel4, 1);
-}
-
-/* Start the pwm-servo and start the sFeederMonoTimer software timer */
-void AppTask::FeederActivateHandler(const AppEvent &)
-{
-        int ret;
-        ret = pwm_set_pulse_dt(&servo, (uint32_t)(pulse));
-        k_timer_start(&sFeederMonoTimer, K_MSEC(2000), K_MSEC(200000));
+        if (actuator) {
+                Actuators::Stage(*actuator, event.ActuatorEvent.On);
+        }
 }
 
-/* Stop the pwm-servo and stop the sFeederMonoTimer software timer */
-void AppTask::FeederDeactivateHandler(const AppEvent &)
+/* Switch all the staged relays with a single port write */
+void AppTask::ActuatorCommitHandler(const AppEvent &)
 {
-        int ret;
-        ret = pwm_set_pulse_dt(&servo, 0);
-        k_timer_stop(&sFeederMonoTimer);
+        Actuators::Commit();
 }
 
-
 void AppTask::ChipEventHandler(const ChipDeviceEvent *event, intptr_t /* arg */)
 {
         switch (event->Type) {
@@ -547,106 +494,151 @@ void AppTask::StartTimer(uint32_t timeoutInMs)
 
 void AppTask::PostEvent(const AppEvent &event)
 {
-        if (k_msgq_put(&sAppEventQueue, &event, K_NO_WAIT) != 0) {
-                LOG_INF("Failed to post event to app task event queue");
+        if (!AppEventQueue::Post(event)) {
+                LOG_WRN("Failed to post event %u to app task event queue", static_cast<unsigned>(event.Type));
         }
 }
 
 void AppTask::DispatchEvent(const AppEvent &event)
 {
         if (event.Handler) {
+                const uint32_t start = k_cycle_get_32();
                 event.Handler(event);
+                AppEventStats::RecordDispatched(event.Type, k_cycle_get_32() - start);
         } else {
                 LOG_INF("Event received with no handler. Dropping event.");
         }
 }
 
-// This execute a fetch to the Hot-Spot sensor and update
-// the endpoints EP6 with the read temperature and EP7 with 
-// the read relative humidity
-void AppTask::HotSensorMeasureHandler(const AppEvent &)
-{
-        int rc = sensor_sample_fetch(dht22);
-        if (rc != 0) {
-                LOG_ERR("Sensor DHT22 fetch failed: %d", rc);
-                if ((last_temperature_1.val1 != 0) && (last_humidity_1.val1 != 0)) {
-                        LOG_INF("Sensor DHT22 temp: %d, %d", last_temperature_1.val1, last_temperature_1.val2);
-                        LOG_INF("Sensor DHT22 hum: %d, %d", last_humidity_1.val1, last_humidity_1.val2);
-                }
-        } else {
-                struct sensor_value temperature;
-                struct sensor_value humidity;
-                rc = sensor_channel_get(dht22, SENSOR_CHAN_AMBIENT_TEMP, &temperature);
-                if (rc == 0) {
-                        rc = sensor_channel_get(dht22, SENSOR_CHAN_HUMIDITY, &humidity);
-                }
-                if (rc != 0) {
-                        LOG_ERR("get failed: %d", rc);
-                } else {
-                        last_temperature_1 = temperature;
-                        last_humidity_1 = humidity;
-                        LOG_INF("Sensor DHT22 temp: %d, %d", temperature.val1, temperature.val2);
-                        LOG_INF("Sensor DHT22 hum: %d, %d", humidity.val1, humidity.val2);
+// This drain the samples finished by the sensor thread and
+// publish each of them on the relative endpoints
+void AppTask::SensorSampleHandler(const AppEvent &)
+{
+        SensorSample sample;
+
+        while (SensorTask::Instance().GetSample(sample)) {
+                switch (sample.Sensor) {
+                case SensorId::HotSpot:
+                        PublishHotSensorSample(sample);
+                        break;
+                case SensorId::ColdZone:
+                        PublishColdSensorSample(sample);
+                        break;
+                case SensorId::WaterTemp:
+                        PublishWaterTempSensorSample(sample);
+                        break;
+                default:
+                        break;
                 }
+                TerrariumSnapshot::SampleDone(sample);
         }
-        
-        chip::app::Clusters::TemperatureMeasurement::Attributes::MeasuredValue::Set(
-        /* endpoint ID */ 7, /* temperature in 0.01*C */ int16_t(sensor_value_to_double(&last_temperature_1)));
-        chip::app::Clusters::RelativeHumidityMeasurement::Attributes::MeasuredValue::Set(
-        /* endpoint ID */ 8, /* humidity */ int16_t(sensor_value_to_double(&last_humidity_1)));
 }
 
-// This execute a fetch to the Cold Zone sensor and update
-// the endpoints EP9 with the read temperature and EP10 with 
-// the read relative humidity
-void AppTask::ColdSensorMeasureHandler(const AppEvent &)
-{
-        int rc = sensor_sample_fetch(dht11);
-        if (rc != 0) {
-                LOG_ERR("Sensor DHT11 fetch failed: %d", rc);
-                if ((last_temperature_2.val1 != 0) && (last_humidity_2.val1 != 0)) {
-                        LOG_INF("Sensor DHT11 temp: %d, %d", last_temperature_2.val1, last_temperature_2.val2);
-                        LOG_INF("Sensor DHT11 hum: %d, %d", last_humidity_2.val1, last_humidity_2.val2);
+// This update the endpoints EP7 with the Hot-Spot sensor
+// temperature and EP8 with the relative humidity
+void AppTask::PublishHotSensorSample(const SensorSample &sample)
+{
+        if (sample.Result != 0) {
+                /* A retrying sensor keeps its last published values, a failed one is nulled */
+                if (sample.Health == SensorState::Failed) {
+                        LOG_WRN("Sensor DHT22 failed");
+                        HotLampThermostat::SensorLost();
+                        sHotSpotTemperatureFilter.Reset();
+                        sHotSpotHumidityFilter.Reset();
+                        TerrariumSnapshot::ClearMeasurement(HistoryChannel::HotSpotTemperature);
+                        TerrariumSnapshot::ClearMeasurement(HistoryChannel::HotSpotHumidity);
+                        MeasurementPublisher::PublishNull(7);
+                        MeasurementPublisher::PublishNull(8);
                 }
-        } else {
-                struct sensor_value temperature;
-                struct sensor_value humidity;
-                rc = sensor_channel_get(dht11, SENSOR_CHAN_AMBIENT_TEMP, &temperature);
-                if (rc == 0) {
-                        rc = sensor_channel_get(dht11, SENSOR_CHAN_HUMIDITY, &humidity);
-                }
-                if (rc != 0) {
-                        LOG_ERR("get failed: %d", rc);
-                } else {
-                        last_temperature_2 = temperature;
-                        last_humidity_2 = humidity;
-                        LOG_INF("Sensor DHT11 temp: %d, %d", temperature.val1, temperature.val2);
-                        LOG_INF("Sensor DHT11 hum: %d, %d", humidity.val1, humidity.val2);
+                return;
+        }
+
+        last_temperature_1 = FilterTemperature(sHotSpotTemperatureFilter, sample);
+        last_humidity_1 = FilterHumidity(sHotSpotHumidityFilter, sample);
+        LOG_INF("Sensor DHT22 temp: %d, %d", sample.Temperature.val1, sample.Temperature.val2);
+        LOG_INF("Sensor DHT22 hum: %d, %d", sample.Humidity.val1, sample.Humidity.val2);
+
+        RecordMeasurement(HistoryChannel::HotSpotTemperature, sample.Timestamp,
+                          MatterUnits::ToMatterTemperature(last_temperature_1));
+        RecordMeasurement(HistoryChannel::HotSpotHumidity, sample.Timestamp,
+                          MatterUnits::ToMatterHumidity(last_humidity_1));
+
+        /* Regulate the hot lamp on fresh readings only */
+        HotLampThermostat::Update(MatterUnits::ToMatterTemperature(last_temperature_1));
+
+        MeasurementPublisher::PublishTemperature(
+        /* endpoint ID */ 7, /* temperature in 0.01*C */ MatterUnits::ToMatterTemperature(last_temperature_1));
+        MeasurementPublisher::PublishHumidity(
+        /* endpoint ID */ 8, /* humidity in 0.01*%RH */ MatterUnits::ToMatterHumidity(last_humidity_1));
+}
+
+// This update the endpoints EP9 with the Cold Zone sensor
+// temperature and EP10 with the relative humidity
+void AppTask::PublishColdSensorSample(const SensorSample &sample)
+{
+        if (sample.Result != 0) {
+                if (sample.Health == SensorState::Failed) {
+                        LOG_WRN("Sensor DHT11 failed");
+                        sColdZoneTemperatureFilter.Reset();
+                        sColdZoneHumidityFilter.Reset();
+                        TerrariumSnapshot::ClearMeasurement(HistoryChannel::ColdZoneTemperature);
+                        TerrariumSnapshot::ClearMeasurement(HistoryChannel::ColdZoneHumidity);
+                        MeasurementPublisher::PublishNull(9);
+                        MeasurementPublisher::PublishNull(10);
                 }
+                return;
         }
-        chip::app::Clusters::TemperatureMeasurement::Attributes::MeasuredValue::Set(
-        /* endpoint ID */ 9, /* temperature in 0.01*C */ int16_t(sensor_value_to_double(&last_temperature_2)));
-        chip::app::Clusters::RelativeHumidityMeasurement::Attributes::MeasuredValue::Set(
-        /* endpoint ID */ 10, /* humidity */ int16_t(sensor_value_to_double(&last_humidity_2)));
+
+        last_temperature_2 = FilterTemperature(sColdZoneTemperatureFilter, sample);
+        last_humidity_2 = FilterHumidity(sColdZoneHumidityFilter, sample);
+        LOG_INF("Sensor DHT11 temp: %d, %d", sample.Temperature.val1, sample.Temperature.val2);
+        LOG_INF("Sensor DHT11 hum: %d, %d", sample.Humidity.val1, sample.Humidity.val2);
+
+        RecordMeasurement(HistoryChannel::ColdZoneTemperature, sample.Timestamp,
+                          MatterUnits::ToMatterTemperature(last_temperature_2));
+        RecordMeasurement(HistoryChannel::ColdZoneHumidity, sample.Timestamp,
+                          MatterUnits::ToMatterHumidity(last_humidity_2));
+
+        MeasurementPublisher::PublishTemperature(
+        /* endpoint ID */ 9, /* temperature in 0.01*C */ MatterUnits::ToMatterTemperature(last_temperature_2));
+        MeasurementPublisher::PublishHumidity(
+        /* endpoint ID */ 10, /* humidity in 0.01*%RH */ MatterUnits::ToMatterHumidity(last_humidity_2));
 }
 
-// This execute a fetch to the Water sensor and update
-// the endpoint EP11 with the read temperature
-void AppTask::WaterTempSensorMeasureHandler(const AppEvent &)
-{
-        int rc = sensor_sample_fetch(ds18b20);
-        if (rc != 0) {
-                LOG_ERR("Sensor DS18B20 fetch failed: %d", rc);
-        } else {
-                struct sensor_value temperature;
-                rc = sensor_channel_get(ds18b20, SENSOR_CHAN_AMBIENT_TEMP, &temperature);
-                if (rc != 0) {
-                        LOG_ERR("get failed: %d", rc);
-                } else {
-                        last_temperature_3 = temperature;
-                        LOG_INF("Sensor DS18B20 temp: %d, %d", temperature.val1, temperature.val2);
+// This update the endpoint EP11 with the Water sensor temperature, the other
+// DS18B20 probes go to their own endpoints
+void AppTask::PublishWaterTempSensorSample(const SensorSample &sample)
+{
+        if (sample.Probe != 0) {
+                if (sample.Result == 0) {
+                        LOG_INF("Sensor DS18B20 #%u temp: %d, %d", sample.Probe, sample.Temperature.val1,
+                                sample.Temperature.val2);
+                        ProbeEndpoints::Publish(sample.Probe, MatterUnits::ToMatterTemperature(sample.Temperature));
+                } else if (sample.Health == SensorState::Failed) {
+                        ProbeEndpoints::PublishNull(sample.Probe);
+                }
+                return;
+        }
+
+        if (sample.Result != 0) {
+                /* Never keep heating on a stale water temperature */
+                WaterHeater::SensorLost();
+                if (sample.Health == SensorState::Failed) {
+                        LOG_WRN("Sensor DS18B20 failed");
+                        TerrariumSnapshot::ClearMeasurement(HistoryChannel::WaterTemperature);
+                        MeasurementPublisher::PublishNull(11);
                 }
+                return;
         }
-        chip::app::Clusters::TemperatureMeasurement::Attributes::MeasuredValue::Set(
-        /* endpoint ID */ 11, /* temperature in 0.01*C */ int16_t(sensor_value_to_double(&last_temperature_3)));
+
+        last_temperature_3 = sample.Temperature;
+        LOG_INF("Sensor DS18B20 temp: %d, %d", sample.Temperature.val1, sample.Temperature.val2);
+
+        RecordMeasurement(HistoryChannel::WaterTemperature, sample.Timestamp,
+                          MatterUnits::ToMatterTemperature(last_temperature_3));
+
+        WaterHeater::Update(MatterUnits::ToMatterTemperature(last_temperature_3), sample.Timestamp);
+
+        MeasurementPublisher::PublishTemperature(
+        /* endpoint ID */ 11, /* temperature in 0.01*C */ MatterUnits::ToMatterTemperature(last_temperature_3));
 }
@@ -10,22 +10,43 @@
  *
  *  SENSORS MANAGEMENT - app_task.cpp
  * 
- * sSensorTimer: 2 second periodic software timer that trigger the events
- *               hot_ev, cold_ev and water_ev, which do the fetch of 
- *               corresponding sensor
+ * The sensors are acquired by the SensorTask thread (see sensor_task.h),
+ * which hands the finished samples over through a lock-free ring.
  * 
- * hot_ev: app event that trigger the HotSensorMeasureHandler
- * cold_ev: app event that trigger the ColdSensorMeasureHandler
- * water_ev: app event that trigger the WaterTempSensorMeasureHandler
+ * SensorSampleReadyHandler: called by the sensor thread for every finished
+ *                           sample, post the sample_ev event
+ * 
+ * sample_ev: app event that trigger the SensorSampleHandler
+ *
+ * SensorSampleHandler: drain the sample ring and dispatch each sample to
+ *                      the corresponding Publish handler
  *
- * HotSensorMeasureHandler: fetch the Hot-Spot sensor and update the endpoints
- *                          with temperature and humidity values
+ * PublishHotSensorSample: update the Hot-Spot endpoints with temperature
+ *                         and humidity values, and feed the hot lamp
+ *                         thermostat (see hot_lamp_thermostat.h)
  * 
- * ColdSensorMeasureHandler: fetch the Cold-Zone sensor and update the relative
- *                           endpoints with temperature and humidity values
+ * PublishColdSensorSample: update the Cold-Zone endpoints with temperature
+ *                          and humidity values
  * 
- * WaterTempSensorMeasureHandler: fetch the Water sensor and update the relative
- *                                endpoint with temperature value
+ * PublishWaterTempSensorSample: update the Water endpoint with the first
+ *                               DS18B20 probe and feed the water heater PID
+ *                               (see water_heater.h), publish the other
+ *                               probes on their own endpoints (see
+ *                               probe_endpoints.h)
+ *
+ * The Publish handlers go through the MeasurementPublisher (see
+ * measurement_publisher.h), which skips the insignificant updates, and
+ * record the successful measurements in the SensorHistory, the FlashLog
+ * and the SensorRollups (see sensor_rollups.h), and stage them in the
+ * TerrariumSnapshot (see terrarium_snapshot.h). The DHT readings first go
+ * through a SpikeFilter per channel (see spike_filter.h), and only the
+ * filtered values are recorded, published and fed to the control loops
+ *
+ * A failed acquisition publishes nothing while its sensor is retried (see
+ * sensor_health.h), the endpoints keep the last value. Once the sensor is
+ * Failed, its MeasuredValue attributes are set to null, its snapshot
+ * channels are cleared and its SpikeFilters restarted, so that no stale or
+ * made up value is ever reported.
  *  
  * ***************************************************************************/
 
@@ -35,27 +56,14 @@
  *
  *  ACTUATORS MANAGEMENT - app_task.cpp
  * 
- * sFeederMonoTimer: software timer for monostable monostable actuation 
- *                   of the feeder
- * 
- * feeder_ev: event to internally trigger the FeederDeactivateHandler
- * 
- * FeederMonoTimerHandler: launch the feeder_ev event
- *  
- * HotLampActivateHandler: turn the hot amp On
- * HotLampDeactivateHandler: turn the hot lamp Off
+ * The actuators are described by the kActuators table (see actuators.h),
+ * indexed by their On/Off endpoint.
  * 
- * UvbLampActivateHandler: turn the uvb lamp On
- * UvbLampDeactivateHandler: turn the uvb lamp Off
- * 
- * HeaterActivateHandler: turn the water heater On
- * HeaterDeactivateHandler: turn the water heater Off
- * 
- * FilterActivateHandler: turn the filter pump On
- * FilterDeactivateHandler: turn the filter pump Off
- * 
- * FeederActivateHandler: turn the feeder pwm-servo On
- * FeederDeactivateHandler: turn the feeder pwm-servo Off
+ * ActuatorCommandHandler: switch the actuator of the event endpoint On or
+ *                         Off, its OnTime countdown (see timed_actuation.h)
+ *                         switches it back Off. Relays are only staged
+ *
+ * ActuatorCommitHandler: switch all the staged relays at once (RelayBank)
  * 
  * ***************************************************************************/
 
@@ -65,7 +73,11 @@
  *
  *  MATTER COMMANDS LISTNER - zcl_callbacks.cpp
  * 
- * MatterPostAttributeChangeCallback: callback of matter command is received
+ * MatterPostAttributeChangeCallback: callback of matter command is received,
+ *                                    post an ActuatorCommand event when the
+ *                                    On/Off attribute of an actuator changes
+ *                                    and one ActuatorCommit event once the
+ *                                    whole Matter message is processed
  * 
  * ***************************************************************************/
 
@@ -85,6 +97,7 @@
 #endif
 
 struct k_timer;
+struct SensorSample;
 
 class AppTask {
 public:
@@ -98,20 +111,10 @@ public:
 
         static void PostEvent(const AppEvent &event);
 
-        static void HotSensorMeasureHandler(const AppEvent &);
-        static void ColdSensorMeasureHandler(const AppEvent &);
-        static void WaterTempSensorMeasureHandler(const AppEvent &);
-
-        static void HotLampActivateHandler(const AppEvent &);
-        static void HotLampDeactivateHandler(const AppEvent &);
-        static void UvbLampActivateHandler(const AppEvent &);
-        static void UvbLampDeactivateHandler(const AppEvent &);
-        static void HeaterActivateHandler(const AppEvent &);
-        static void HeaterDeactivateHandler(const AppEvent &);
-        static void FilterActivateHandler(const AppEvent &);
-        static void FilterDeactivateHandler(const AppEvent &);
-        static void FeederActivateHandler(const AppEvent &);
-        static void FeederDeactivateHandler(const AppEvent &);
+        static void SensorSampleHandler(const AppEvent &);
+
+        static void ActuatorCommandHandler(const AppEvent &);
+        static void ActuatorCommitHandler(const AppEvent &);
 
 private:
         CHIP_ERROR Init();
@@ -130,6 +133,10 @@ private:
         static void FunctionTimerTimeoutCallback(k_timer *timer);
         static void UpdateStatusLED();
 
+        static void PublishHotSensorSample(const SensorSample &sample);
+        static void PublishColdSensorSample(const SensorSample &sample);
+        static void PublishWaterTempSensorSample(const SensorSample &sample);
+
         FunctionEvent mFunction = FunctionEvent::NoneSelected;
         bool mFunctionTimerActive = false;
 
@@ -0,0 +1,177 @@
+#include "attribute_batcher.h"
+#include "actuators.h"
+#include "dynamic_endpoints.h"
+#include "measurement_publisher.h"
+#include "terrarium_endpoint.h"
+
+#include <app-common/zap-generated/attributes/Accessors.h>
+#include <app/reporting/reporting.h>
+#include <platform/CHIPDeviceLayer.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip;
+using namespace ::chip::app::Clusters;
+using namespace ::chip::DeviceLayer;
+
+namespace
+{
+enum class AttributeKind : uint8_t { OnOff, Temperature, Humidity, Snapshot };
+
+/* One OnOff per actuator, one MeasuredValue per measurement endpoint, one
+ * attribute per dynamic endpoint and the snapshot */
+constexpr size_t kMaxSlots =
+        Actuators::kMaxActuators + MeasurementPublisher::kEndpointCount + DynamicEndpoints::kPoolSize + 1;
+
+/* Slot value of a null MeasuredValue, out of range of both attributes */
+constexpr int32_t kNullValue = INT32_MIN;
+
+struct Slot {
+        EndpointId Endpoint;
+        AttributeKind Kind;
+        bool Pending;
+        int32_t Value;
+};
+
+/* Slots are allocated on the first update of an attribute and then reused */
+k_spinlock sLock;
+Slot sSlots[kMaxSlots];
+size_t sSlotCount;
+bool sBatchScheduled;
+
+void CommitBatch(intptr_t);
+
+/* ScheduleWork is not ISR safe, so the batch is scheduled from the system
+ * work queue, which also lets the updates of a burst join the same batch */
+void ScheduleBatch(k_work *)
+{
+        if (PlatformMgr().ScheduleWork(CommitBatch) != CHIP_NO_ERROR) {
+                LOG_ERR("Failed to schedule the attribute batch");
+
+                k_spinlock_key_t key = k_spin_lock(&sLock);
+                sBatchScheduled = false;
+                k_spin_unlock(&sLock, key);
+        }
+}
+
+K_WORK_DEFINE(sScheduleBatchWork, ScheduleBatch);
+
+void Write(const Slot &slot)
+{
+        switch (slot.Kind) {
+        case AttributeKind::OnOff:
+                OnOff::Attributes::OnOff::Set(slot.Endpoint, slot.Value != 0);
+                break;
+        case AttributeKind::Temperature:
+                if (slot.Value == kNullValue) {
+                        TemperatureMeasurement::Attributes::MeasuredValue::SetNull(slot.Endpoint);
+                } else {
+                        TemperatureMeasurement::Attributes::MeasuredValue::Set(slot.Endpoint,
+                                                                               static_cast<int16_t>(slot.Value));
+                }
+                break;
+        case AttributeKind::Humidity:
+                if (slot.Value == kNullValue) {
+                        RelativeHumidityMeasurement::Attributes::MeasuredValue::SetNull(slot.Endpoint);
+                } else {
+                        RelativeHumidityMeasurement::Attributes::MeasuredValue::Set(slot.Endpoint,
+                                                                                    static_cast<uint16_t>(slot.Value));
+                }
+                break;
+        case AttributeKind::Snapshot:
+                MatterReportingAttributeChangeCallback(slot.Endpoint, TerrariumClusters::Snapshot::Id,
+                                                       TerrariumClusters::Snapshot::Attributes::Snapshot);
+                break;
+        }
+}
+
+/* Runs on the Matter thread, with the stack locked */
+void CommitBatch(intptr_t)
+{
+        Slot batch[kMaxSlots];
+        size_t count = 0;
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        for (size_t i = 0; i < sSlotCount; i++) {
+                if (sSlots[i].Pending) {
+                        batch[count++] = sSlots[i];
+                        sSlots[i].Pending = false;
+                }
+        }
+        sBatchScheduled = false;
+        k_spin_unlock(&sLock, key);
+
+        /* Written outside the spinlock, the OnOff writes call back into
+         * MatterPostAttributeChangeCallback */
+        for (size_t i = 0; i < count; i++) {
+                Write(batch[i]);
+        }
+}
+
+void Queue(EndpointId endpoint, AttributeKind kind, int32_t value)
+{
+        bool schedule = false;
+        Slot *slot = nullptr;
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        for (size_t i = 0; i < sSlotCount && !slot; i++) {
+                if (sSlots[i].Endpoint == endpoint && sSlots[i].Kind == kind) {
+                        slot = &sSlots[i];
+                }
+        }
+        if (!slot && sSlotCount < kMaxSlots) {
+                slot = &sSlots[sSlotCount++];
+                slot->Endpoint = endpoint;
+                slot->Kind = kind;
+        }
+        if (slot) {
+                slot->Value = value;
+                slot->Pending = true;
+                schedule = !sBatchScheduled;
+                sBatchScheduled = true;
+        }
+        k_spin_unlock(&sLock, key);
+
+        if (!slot) {
+                LOG_WRN("No attribute batch slot for endpoint %u", endpoint);
+                return;
+        }
+
+        if (schedule) {
+                k_work_submit(&sScheduleBatchWork);
+        }
+}
+} /* namespace */
+
+void AttributeBatcher::SetOnOff(EndpointId endpoint, bool on)
+{
+        Queue(endpoint, AttributeKind::OnOff, on);
+}
+
+void AttributeBatcher::SetTemperature(EndpointId endpoint, int16_t value)
+{
+        Queue(endpoint, AttributeKind::Temperature, value);
+}
+
+void AttributeBatcher::SetHumidity(EndpointId endpoint, uint16_t value)
+{
+        Queue(endpoint, AttributeKind::Humidity, value);
+}
+
+void AttributeBatcher::SetTemperatureNull(EndpointId endpoint)
+{
+        Queue(endpoint, AttributeKind::Temperature, kNullValue);
+}
+
+void AttributeBatcher::SetHumidityNull(EndpointId endpoint)
+{
+        Queue(endpoint, AttributeKind::Humidity, kNullValue);
+}
+
+void AttributeBatcher::ReportSnapshot()
+{
+        Queue(TerrariumEndpoint::kEndpointId, AttributeKind::Snapshot, 0);
+}
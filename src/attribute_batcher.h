@@ -0,0 +1,40 @@
+/* ****************************************************************************
+ *
+ *  ATTRIBUTE UPDATE BATCHER - attribute_batcher.cpp
+ *
+ * The generated attribute accessors must only be called on the Matter
+ * thread, or with the Matter stack locked, and never from an ISR. The app
+ * task, the timers and the control loops queue their attribute updates here
+ * instead: every pending value is kept in a slot per endpoint and attribute,
+ * the latest value wins, and the whole batch is written by a single
+ * ScheduleWork callback, which runs on the Matter thread with the stack
+ * lock already held, instead of one lock round-trip per attribute.
+ *
+ * The Set functions are safe to call from any thread and from ISRs.
+ *
+ * SetOnOff: queue an OnOff::OnOff update
+ * SetTemperature: queue a TemperatureMeasurement::MeasuredValue update
+ * SetHumidity: queue a RelativeHumidityMeasurement::MeasuredValue update
+ * SetTemperatureNull, SetHumidityNull: queue a null MeasuredValue, for a
+ *                                      failed sensor
+ * ReportSnapshot: queue a report of the terrarium snapshot attribute, whose
+ *                 value is kept by TerrariumSnapshot (see
+ *                 terrarium_snapshot.h)
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include <lib/core/DataModelTypes.h>
+
+class AttributeBatcher {
+public:
+        static void SetOnOff(chip::EndpointId endpoint, bool on);
+        static void SetTemperature(chip::EndpointId endpoint, int16_t value);
+        static void SetHumidity(chip::EndpointId endpoint, uint16_t value);
+        static void SetTemperatureNull(chip::EndpointId endpoint);
+        static void SetHumidityNull(chip::EndpointId endpoint);
+        static void ReportSnapshot();
+};
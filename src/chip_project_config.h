@@ -14,3 +14,7 @@
  */
 
 #pragma once
+
+/* Dynamic endpoints registered after the fixed ZAP ones, see terrarium_endpoint.h,
+ * hot_lamp_thermostat.h and dynamic_endpoints.h */
+#define CHIP_DEVICE_CONFIG_DYNAMIC_ENDPOINT_COUNT (2 + CONFIG_APP_DYNAMIC_ENDPOINT_POOL_SIZE)
@@ -0,0 +1,258 @@
+#include "ds18b20_bus.h"
+
+#include <cstring>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+namespace
+{
+constexpr uint8_t kDs18b20FamilyCode = 0x28;
+
+constexpr uint8_t kCmdConvertT = 0x44;
+constexpr uint8_t kCmdWriteScratchpad = 0x4E;
+constexpr uint8_t kCmdReadScratchpad = 0xBE;
+
+constexpr size_t kScratchpadSize = 9;
+constexpr uint8_t kScratchpadConfigOffset = 4;
+
+/* Conversion time at 9 bit resolution, it doubles for every extra bit */
+constexpr uint32_t kConversionTime9BitUs = 93750;
+
+constexpr char kSettingsSubtree[] = "w1";
+constexpr char kProbesKey[] = "w1/probes";
+
+/* Skip-ROM addressing, for the commands broadcast to all the probes */
+const struct w1_slave_config kSkipRomConfig = {};
+} /* namespace */
+
+int Ds18b20Bus::Init()
+{
+        if (!device_is_ready(mBus)) {
+                LOG_ERR("Device %s is not ready", mBus->name);
+                return -ENODEV;
+        }
+
+        int rc = settings_load_subtree_direct(kSettingsSubtree, LoadSetting, this);
+        if (rc) {
+                LOG_ERR("settings_load_subtree_direct(%s) failed: %d", kSettingsSubtree, rc);
+        }
+
+        /* A missing probe or an empty bus only fails its samples, the rest
+         * of the device still starts */
+        SearchResult found;
+        if (Search(found) == 0) {
+                const size_t cached = mProbeCount;
+
+                mProbeCount = Merge(mProbeIds, mProbeCount, found, true, mProbeIds);
+                if (mProbeCount != cached) {
+                        Save(mProbeIds, mProbeCount);
+                }
+        }
+
+        if (mProbeCount == 0) {
+                LOG_WRN("No DS18B20 on %s, the water temperature is unavailable", mBus->name);
+                return 0;
+        }
+
+        for (size_t i = 0; i < mProbeCount; i++) {
+                LOG_INF("DS18B20 probe %u: %016llx", static_cast<unsigned>(i), mProbeIds[i]);
+        }
+
+        rc = WriteConfiguration();
+        if (rc) {
+                LOG_ERR("Cannot configure the DS18B20 resolution: %d", rc);
+        }
+
+        return 0;
+}
+
+int Ds18b20Bus::LoadSetting(const char *key, size_t length, settings_read_cb read_cb, void *cb_arg, void *param)
+{
+        Ds18b20Bus *bus = static_cast<Ds18b20Bus *>(param);
+
+        if (settings_name_steq(key, "probes", nullptr) && length > 0 && length % sizeof(uint64_t) == 0 &&
+            length <= sizeof(bus->mProbeIds)) {
+                const ssize_t read = read_cb(cb_arg, bus->mProbeIds, length);
+                bus->mProbeCount = read == static_cast<ssize_t>(length) ? length / sizeof(uint64_t) : 0;
+        }
+
+        return 0;
+}
+
+void Ds18b20Bus::FoundProbe(struct w1_rom rom, void *context)
+{
+        SearchResult *result = static_cast<SearchResult *>(context);
+
+        if (rom.family != kDs18b20FamilyCode) {
+                return;
+        }
+        if (result->Count == kMaxProbes) {
+                LOG_WRN("Ignoring DS18B20 %016llx, CONFIG_APP_DS18B20_MAX_PROBES reached", w1_rom_to_uint64(&rom));
+                return;
+        }
+        result->Ids[result->Count++] = w1_rom_to_uint64(&rom);
+}
+
+int Ds18b20Bus::Search(SearchResult &result)
+{
+        result.Count = 0;
+
+        const int found = w1_search_rom(mBus, FoundProbe, &result);
+        if (found < 0) {
+                LOG_ERR("w1_search_rom() failed: %d", found);
+                return found;
+        }
+
+        return 0;
+}
+
+/* The known probes keep their order, hence their endpoints, the new ones
+ * are appended. The known probes not found are kept or dropped */
+size_t Ds18b20Bus::Merge(const uint64_t *known, size_t knownCount, const SearchResult &found, bool keepMissing,
+                         uint64_t *merged)
+{
+        uint64_t ids[kMaxProbes];
+        size_t count = 0;
+
+        for (size_t i = 0; i < knownCount; i++) {
+                const bool present = Contains(found.Ids, found.Count, known[i]);
+
+                if (!present) {
+                        LOG_WRN("DS18B20 %016llx not found on the bus", known[i]);
+                }
+                if (present || keepMissing) {
+                        ids[count++] = known[i];
+                }
+        }
+        for (size_t i = 0; i < found.Count && count < kMaxProbes; i++) {
+                if (!Contains(known, knownCount, found.Ids[i])) {
+                        LOG_INF("New DS18B20 %016llx", found.Ids[i]);
+                        ids[count++] = found.Ids[i];
+                }
+        }
+
+        memcpy(merged, ids, count * sizeof(ids[0]));
+        return count;
+}
+
+bool Ds18b20Bus::Contains(const uint64_t *ids, size_t count, uint64_t id)
+{
+        for (size_t i = 0; i < count; i++) {
+                if (ids[i] == id) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+/* An empty list is not cached, so that the bus is searched again */
+void Ds18b20Bus::Save(const uint64_t *ids, size_t count)
+{
+        const int rc = count ? settings_save_one(kProbesKey, ids, count * sizeof(uint64_t)) :
+                               settings_delete(kProbesKey);
+        if (rc) {
+                LOG_ERR("Cannot save %s: %d", kProbesKey, rc);
+        }
+}
+
+int Ds18b20Bus::Rescan()
+{
+        SearchResult found;
+        uint64_t ids[kMaxProbes];
+
+        const int rc = Search(found);
+        if (rc) {
+                return rc;
+        }
+
+        const size_t count = Merge(mProbeIds, mProbeCount, found, false, ids);
+        Save(ids, count);
+
+        return static_cast<int>(count);
+}
+
+int Ds18b20Bus::ForgetProbes()
+{
+        return settings_delete(kProbesKey);
+}
+
+uint64_t Ds18b20Bus::ProbeId(size_t probe) const
+{
+        return probe < mProbeCount ? mProbeIds[probe] : 0;
+}
+
+uint32_t Ds18b20Bus::ConversionTimeMs() const
+{
+        return ((kConversionTime9BitUs << (mResolution - 9)) + 999) / 1000;
+}
+
+int Ds18b20Bus::WriteConfiguration()
+{
+        /* TH and TL alarm registers are unused, the config register holds
+         * the resolution in bits 5-6 */
+        const uint8_t frame[] = { kCmdWriteScratchpad, 0x00, 0x00,
+                                  static_cast<uint8_t>(((mResolution - 9) << 5) | 0x1F) };
+
+        w1_lock_bus(mBus);
+        int rc = w1_skip_rom(mBus, &kSkipRomConfig);
+        if (rc == 0) {
+                rc = w1_write_block(mBus, frame, sizeof(frame));
+        }
+        w1_unlock_bus(mBus);
+
+        return rc;
+}
+
+int Ds18b20Bus::StartConversion()
+{
+        w1_lock_bus(mBus);
+        int rc = w1_skip_rom(mBus, &kSkipRomConfig);
+        if (rc == 0) {
+                rc = w1_write_byte(mBus, kCmdConvertT);
+        }
+        w1_unlock_bus(mBus);
+
+        return rc;
+}
+
+int Ds18b20Bus::ReadTemperature(size_t probe, struct sensor_value &temperature)
+{
+        uint8_t scratchpad[kScratchpadSize];
+        struct w1_slave_config config = {};
+
+        if (probe >= mProbeCount) {
+                return -ENODEV;
+        }
+        w1_uint64_to_rom(mProbeIds[probe], &config.rom);
+
+        w1_lock_bus(mBus);
+        int rc = w1_match_rom(mBus, &config);
+        if (rc == 0) {
+                rc = w1_write_byte(mBus, kCmdReadScratchpad);
+        }
+        if (rc == 0) {
+                rc = w1_read_block(mBus, scratchpad, sizeof(scratchpad));
+        }
+        w1_unlock_bus(mBus);
+
+        if (rc != 0) {
+                return rc;
+        }
+
+        if (w1_crc8(scratchpad, kScratchpadSize - 1) != scratchpad[kScratchpadSize - 1]) {
+                return -EIO;
+        }
+
+        /* Temperature is a signed 1/16 degree value, the low bits are
+         * undefined below 12 bit resolution */
+        const uint8_t resolution = ((scratchpad[kScratchpadConfigOffset] >> 5) & 0x03) + 9;
+        int16_t raw = static_cast<int16_t>(scratchpad[1] << 8 | scratchpad[0]);
+        raw &= ~((1 << (12 - resolution)) - 1);
+
+        temperature.val1 = raw / 16;
+        temperature.val2 = (raw % 16) * 62500;
+
+        return 0;
+}
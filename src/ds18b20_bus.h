@@ -0,0 +1,87 @@
+/* ****************************************************************************
+ *
+ *  DS18B20 SPLIT-PHASE ACCESS - ds18b20_bus.cpp
+ *
+ * The Zephyr ds18b20 driver performs Convert-T, sleeps for the whole
+ * conversion time (750 ms at 12 bit) and then reads the scratchpad inside a
+ * single sensor_sample_fetch() call, for the one probe of its devicetree
+ * node. Ds18b20Bus talks to the probes through the w1 bus API instead, so
+ * that the caller can start a conversion, go back to its own work and read
+ * the results once the conversion time has elapsed, and so that any number
+ * of probes can share the bus.
+ *
+ * The probes are enumerated with a ROM search at every boot, and their ROM
+ * IDs are cached in the settings subsystem ("w1/probes"): the cached probes
+ * keep their order, hence their endpoints, and the new ones are appended.
+ * A cached probe missing from the bus is kept, its samples fail and its
+ * sensor health reports it, until a Rescan drops it. An empty bus is not an
+ * error, the device runs without water temperature. A single Skip-ROM
+ * Convert-T starts the conversion of all the probes at once, then every
+ * scratchpad is read with Match-ROM, so the bus time for N probes stays
+ * close to one conversion.
+ *
+ * Init: load the cached probe IDs, add the new probes found on the bus,
+ *       then write the resolution from the devicetree into every probe
+ *       scratchpad. Only fails when the bus device is not ready
+ * StartConversion: issue a Skip-ROM Convert-T to all the probes
+ * ConversionTimeMs: time to wait between StartConversion and ReadTemperature
+ * ReadTemperature: read and CRC-check the scratchpad of a probe
+ * ProbeCount: number of probes found, at most kMaxProbes
+ * ProbeId: 64 bit ROM ID of a probe
+ * ForgetProbes: clear the cached IDs, the next boot numbers the probes
+ *               again in search order
+ * Rescan: search the bus now and cache the probes found, the known ones
+ *         first, return their count. The probe list in use only changes at
+ *         the next boot, like the endpoints
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/drivers/w1.h>
+#include <zephyr/settings/settings.h>
+
+class Ds18b20Bus {
+public:
+        static constexpr size_t kMaxProbes = CONFIG_APP_DS18B20_MAX_PROBES;
+
+        Ds18b20Bus(const struct device *bus, uint8_t resolution) : mBus(bus), mResolution(resolution) {}
+
+        int Init();
+        int StartConversion();
+        int ReadTemperature(size_t probe, struct sensor_value &temperature);
+
+        uint32_t ConversionTimeMs() const;
+        size_t ProbeCount() const { return mProbeCount; }
+        uint64_t ProbeId(size_t probe) const;
+        int ForgetProbes();
+        int Rescan();
+
+private:
+        struct SearchResult {
+                uint64_t Ids[kMaxProbes];
+                size_t Count;
+        };
+
+        static int LoadSetting(const char *key, size_t length, settings_read_cb read_cb, void *cb_arg, void *param);
+        static void FoundProbe(struct w1_rom rom, void *context);
+        static size_t Merge(const uint64_t *known, size_t knownCount, const SearchResult &found, bool keepMissing,
+                            uint64_t *merged);
+        static bool Contains(const uint64_t *ids, size_t count, uint64_t id);
+        static void Save(const uint64_t *ids, size_t count);
+
+        int Search(SearchResult &result);
+        int WriteConfiguration();
+
+        const struct device *mBus;
+        uint8_t mResolution;
+
+        /* Set once by Init, before the sensor thread starts */
+        uint64_t mProbeIds[kMaxProbes] = {};
+        size_t mProbeCount = 0;
+};
@@ -0,0 +1,514 @@
+#include "dynamic_endpoints.h"
+#include "attribute_batcher.h"
+#include "publish_filter.h"
+
+#include <app-common/zap-generated/ids/Attributes.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <app-common/zap-generated/ids/Commands.h>
+#include <app/util/attribute-storage.h>
+#include <lib/support/CodeUtils.h>
+#include <lib/support/Span.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip;
+using namespace ::chip::app::Clusters;
+
+namespace
+{
+/* After the terrarium (0) and the hot lamp thermostat (1) endpoints */
+constexpr uint16_t kFirstDynamicEndpointIndex = 2;
+
+constexpr DeviceTypeId kTemperatureSensorDeviceTypeId = 0x0302;
+constexpr DeviceTypeId kHumiditySensorDeviceTypeId = 0x0307;
+constexpr DeviceTypeId kOnOffPlugInUnitDeviceTypeId = 0x010A;
+constexpr uint8_t kDeviceTypeVersion = 2;
+constexpr uint16_t kDescriptorClusterRevision = 1;
+/* Of the clusters of the other dynamic endpoints, see
+ * emberAfExternalAttributeReadCallback */
+constexpr uint16_t kDefaultClusterRevision = 1;
+constexpr uint16_t kTemperatureMeasurementClusterRevision = 4;
+constexpr uint16_t kRelativeHumidityMeasurementClusterRevision = 3;
+constexpr uint16_t kOnOffClusterRevision = 4;
+constexpr uint16_t kListAttributeSize = 254;
+
+/* Null encodings of the nullable MeasuredValue attributes */
+constexpr int16_t kNullTemperature = INT16_MIN;
+constexpr uint16_t kNullHumidity = UINT16_MAX;
+
+constexpr char kSettingsSubtree[] = "dynep";
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(descriptorAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::DeviceTypeList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::ServerList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::ClientList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::PartsList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(temperatureAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(TemperatureMeasurement::Attributes::MeasuredValue::Id, INT16S, 2,
+                          ZAP_ATTRIBUTE_MASK(NULLABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(TemperatureMeasurement::Attributes::MinMeasuredValue::Id, INT16S, 2,
+                                  ZAP_ATTRIBUTE_MASK(NULLABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(TemperatureMeasurement::Attributes::MaxMeasuredValue::Id, INT16S, 2,
+                                  ZAP_ATTRIBUTE_MASK(NULLABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(TemperatureMeasurement::Attributes::FeatureMap::Id, BITMAP32, 4, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(humidityAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(RelativeHumidityMeasurement::Attributes::MeasuredValue::Id, INT16U, 2,
+                          ZAP_ATTRIBUTE_MASK(NULLABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(RelativeHumidityMeasurement::Attributes::MinMeasuredValue::Id, INT16U, 2,
+                                  ZAP_ATTRIBUTE_MASK(NULLABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(RelativeHumidityMeasurement::Attributes::MaxMeasuredValue::Id, INT16U, 2,
+                                  ZAP_ATTRIBUTE_MASK(NULLABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(RelativeHumidityMeasurement::Attributes::FeatureMap::Id, BITMAP32, 4, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(onOffAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(OnOff::Attributes::OnOff::Id, BOOLEAN, 1, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(OnOff::Attributes::FeatureMap::Id, BITMAP32, 4, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+constexpr CommandId onOffIncomingCommands[] = { OnOff::Commands::Off::Id, OnOff::Commands::On::Id,
+                                                OnOff::Commands::Toggle::Id, kInvalidCommandId };
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(temperatureClusters)
+DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs, nullptr, nullptr),
+        DECLARE_DYNAMIC_CLUSTER(TemperatureMeasurement::Id, temperatureAttrs, nullptr, nullptr)
+                DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(humidityClusters)
+DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs, nullptr, nullptr),
+        DECLARE_DYNAMIC_CLUSTER(RelativeHumidityMeasurement::Id, humidityAttrs, nullptr, nullptr)
+                DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(onOffClusters)
+DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs, nullptr, nullptr),
+        DECLARE_DYNAMIC_CLUSTER(OnOff::Id, onOffAttrs, onOffIncomingCommands, nullptr)
+                DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+/* Shared by all the endpoints of a kind, only the data versions are per endpoint */
+DECLARE_DYNAMIC_ENDPOINT(temperatureEndpoint, temperatureClusters);
+DECLARE_DYNAMIC_ENDPOINT(humidityEndpoint, humidityClusters);
+DECLARE_DYNAMIC_ENDPOINT(onOffEndpoint, onOffClusters);
+
+constexpr size_t kClustersPerEndpoint = 2;
+static_assert(ArraySize(temperatureClusters) == kClustersPerEndpoint &&
+                      ArraySize(humidityClusters) == kClustersPerEndpoint &&
+                      ArraySize(onOffClusters) == kClustersPerEndpoint,
+              "the pool slots keep kClustersPerEndpoint data versions");
+
+const EmberAfDeviceType sTemperatureDeviceTypes[] = { { kTemperatureSensorDeviceTypeId, kDeviceTypeVersion } };
+const EmberAfDeviceType sHumidityDeviceTypes[] = { { kHumiditySensorDeviceTypeId, kDeviceTypeVersion } };
+const EmberAfDeviceType sOnOffDeviceTypes[] = { { kOnOffPlugInUnitDeviceTypeId, kDeviceTypeVersion } };
+
+/* Persisted as is under "dynep/<slot>" */
+struct Record {
+        uint64_t Uid;
+        EndpointId Endpoint;
+        DynamicEndpointKind Kind;
+};
+
+struct Slot {
+        bool Used;
+        bool Attached;
+        Record Device;
+        DataVersion DataVersions[kClustersPerEndpoint];
+        /* Attribute values, Matter thread only */
+        bool HasValue;
+        int32_t Value;
+        int16_t MinValue;
+        int16_t MaxValue;
+        bool On;
+        DynamicSwitchHandler Handler;
+        /* AppTask only */
+        PublishFilter Filter{ 0, 0 };
+        bool PublishedNull;
+};
+
+Slot sSlots[DynamicEndpoints::kPoolSize];
+
+Slot *Find(EndpointId endpoint)
+{
+        for (Slot &slot : sSlots) {
+                if (slot.Used && slot.Device.Endpoint == endpoint) {
+                        return &slot;
+                }
+        }
+        return nullptr;
+}
+
+size_t IndexOf(const Slot &slot)
+{
+        return static_cast<size_t>(&slot - sSlots);
+}
+
+void SettingsKey(size_t index, char (&key)[sizeof(kSettingsSubtree) + 4])
+{
+        snprintf(key, sizeof(key), "%s/%u", kSettingsSubtree, static_cast<unsigned>(index));
+}
+
+int LoadSetting(const char *key, size_t length, settings_read_cb read_cb, void *cb_arg, void *)
+{
+        char *end;
+        const unsigned long index = strtoul(key, &end, 10);
+        Record record;
+
+        if (end == key || *end != '\0' || index >= DynamicEndpoints::kPoolSize || length != sizeof(record) ||
+            read_cb(cb_arg, &record, sizeof(record)) != sizeof(record)) {
+                return 0;
+        }
+        if (record.Kind > DynamicEndpointKind::OnOff || record.Endpoint < DynamicEndpoints::kFirstEndpointId) {
+                return 0;
+        }
+
+        Slot &slot = sSlots[index];
+        slot.Used = true;
+        slot.Device = record;
+        /* A virtual switch has no device to wait for */
+        slot.Attached = record.Kind == DynamicEndpointKind::OnOff && record.Uid == DynamicEndpoints::kVirtualSwitch;
+
+        return 0;
+}
+
+const EmberAfEndpointType *EndpointType(DynamicEndpointKind kind)
+{
+        switch (kind) {
+        case DynamicEndpointKind::Temperature:
+                return &temperatureEndpoint;
+        case DynamicEndpointKind::Humidity:
+                return &humidityEndpoint;
+        default:
+                return &onOffEndpoint;
+        }
+}
+
+Span<const EmberAfDeviceType> DeviceTypes(DynamicEndpointKind kind)
+{
+        switch (kind) {
+        case DynamicEndpointKind::Temperature:
+                return Span<const EmberAfDeviceType>(sTemperatureDeviceTypes);
+        case DynamicEndpointKind::Humidity:
+                return Span<const EmberAfDeviceType>(sHumidityDeviceTypes);
+        default:
+                return Span<const EmberAfDeviceType>(sOnOffDeviceTypes);
+        }
+}
+
+CHIP_ERROR Register(Slot &slot)
+{
+        EmberAfStatus status = emberAfSetDynamicEndpoint(
+                kFirstDynamicEndpointIndex + IndexOf(slot), slot.Device.Endpoint, EndpointType(slot.Device.Kind),
+                Span<DataVersion>(slot.DataVersions), DeviceTypes(slot.Device.Kind));
+        if (status != EMBER_ZCL_STATUS_SUCCESS) {
+                LOG_ERR("emberAfSetDynamicEndpoint(%u) failed: %d", slot.Device.Endpoint, status);
+                return CHIP_ERROR_INTERNAL;
+        }
+
+        return CHIP_NO_ERROR;
+}
+
+/* Lowest endpoint from kFirstEndpointId that no slot uses */
+EndpointId FreeEndpoint()
+{
+        EndpointId endpoint = DynamicEndpoints::kFirstEndpointId;
+
+        while (Find(endpoint)) {
+                endpoint++;
+        }
+        return endpoint;
+}
+
+/* The slot of a known device, or a new slot and endpoint for it */
+CHIP_ERROR Claim(DynamicEndpointKind kind, uint64_t uid, Slot *&claimed)
+{
+        Slot *free = nullptr;
+
+        for (Slot &slot : sSlots) {
+                if (!slot.Used) {
+                        free = free ? free : &slot;
+                } else if (uid != DynamicEndpoints::kVirtualSwitch && slot.Device.Uid == uid &&
+                           slot.Device.Kind == kind) {
+                        slot.Attached = true;
+                        claimed = &slot;
+                        return CHIP_NO_ERROR;
+                }
+        }
+
+        if (!free) {
+                LOG_ERR("No dynamic endpoint left for %016llx, see CONFIG_APP_DYNAMIC_ENDPOINT_POOL_SIZE",
+                        static_cast<unsigned long long>(uid));
+                return CHIP_ERROR_NO_MEMORY;
+        }
+
+        const Record record = { uid, FreeEndpoint(), kind };
+        *free = Slot{};
+        free->Device = record;
+        free->Used = true;
+        free->Attached = true;
+
+        CHIP_ERROR err = Register(*free);
+        if (err != CHIP_NO_ERROR) {
+                *free = Slot{};
+                return err;
+        }
+
+        char key[sizeof(kSettingsSubtree) + 4];
+        SettingsKey(IndexOf(*free), key);
+        const int ret = settings_save_one(key, &record, sizeof(record));
+        if (ret) {
+                LOG_ERR("settings_save_one(%s) failed: %d", key, ret);
+        }
+
+        LOG_INF("Dynamic endpoint %u created for %016llx", record.Endpoint, static_cast<unsigned long long>(uid));
+        claimed = free;
+        return CHIP_NO_ERROR;
+}
+
+template <typename T> EmberAfStatus Encode(T value, uint8_t *buffer, uint16_t maxReadLength)
+{
+        VerifyOrReturnError(sizeof(value) <= maxReadLength, EMBER_ZCL_STATUS_RESOURCE_EXHAUSTED);
+        memcpy(buffer, &value, sizeof(value));
+        return EMBER_ZCL_STATUS_SUCCESS;
+}
+
+template <typename T> T Decode(const uint8_t *buffer)
+{
+        T value;
+        memcpy(&value, buffer, sizeof(value));
+        return value;
+}
+
+/* Bridge-style external attribute storage of the pool endpoints */
+EmberAfStatus ReadSlotAttribute(const Slot *slot, ClusterId clusterId, AttributeId attribute, uint8_t *buffer,
+                                uint16_t maxReadLength)
+{
+        if (attribute == Globals::Attributes::FeatureMap::Id) {
+                return Encode(static_cast<uint32_t>(0), buffer, maxReadLength);
+        }
+
+        switch (clusterId) {
+        case Descriptor::Id:
+                if (attribute == Globals::Attributes::ClusterRevision::Id) {
+                        return Encode(kDescriptorClusterRevision, buffer, maxReadLength);
+                }
+                break;
+        case TemperatureMeasurement::Id:
+                switch (attribute) {
+                case TemperatureMeasurement::Attributes::MeasuredValue::Id:
+                        return Encode(slot->HasValue ? static_cast<int16_t>(slot->Value) : kNullTemperature, buffer,
+                                      maxReadLength);
+                case TemperatureMeasurement::Attributes::MinMeasuredValue::Id:
+                        return Encode(slot->MinValue, buffer, maxReadLength);
+                case TemperatureMeasurement::Attributes::MaxMeasuredValue::Id:
+                        return Encode(slot->MaxValue, buffer, maxReadLength);
+                case TemperatureMeasurement::Attributes::ClusterRevision::Id:
+                        return Encode(kTemperatureMeasurementClusterRevision, buffer, maxReadLength);
+                }
+                break;
+        case RelativeHumidityMeasurement::Id:
+                switch (attribute) {
+                case RelativeHumidityMeasurement::Attributes::MeasuredValue::Id:
+                        return Encode(slot->HasValue ? static_cast<uint16_t>(slot->Value) : kNullHumidity, buffer,
+                                      maxReadLength);
+                case RelativeHumidityMeasurement::Attributes::MinMeasuredValue::Id:
+                        return Encode(static_cast<uint16_t>(slot->MinValue), buffer, maxReadLength);
+                case RelativeHumidityMeasurement::Attributes::MaxMeasuredValue::Id:
+                        return Encode(static_cast<uint16_t>(slot->MaxValue), buffer, maxReadLength);
+                case RelativeHumidityMeasurement::Attributes::ClusterRevision::Id:
+                        return Encode(kRelativeHumidityMeasurementClusterRevision, buffer, maxReadLength);
+                }
+                break;
+        case OnOff::Id:
+                switch (attribute) {
+                case OnOff::Attributes::OnOff::Id:
+                        return Encode(static_cast<uint8_t>(slot->On), buffer, maxReadLength);
+                case OnOff::Attributes::ClusterRevision::Id:
+                        return Encode(kOnOffClusterRevision, buffer, maxReadLength);
+                }
+                break;
+        }
+
+        return EMBER_ZCL_STATUS_UNSUPPORTED_ATTRIBUTE;
+}
+} /* namespace */
+
+/* The only external attribute storage of the firmware: the pool endpoints
+ * keep all their attributes there, the other dynamic endpoints (terrarium,
+ * hot lamp thermostat, probes) are served by their AttributeAccessInterface
+ * and only leave the ClusterRevision of their clusters to it */
+EmberAfStatus emberAfExternalAttributeReadCallback(EndpointId endpoint, ClusterId clusterId,
+                                                   const EmberAfAttributeMetadata *attributeMetadata, uint8_t *buffer,
+                                                   uint16_t maxReadLength)
+{
+        const Slot *slot = Find(endpoint);
+        const AttributeId attribute = attributeMetadata->attributeId;
+
+        if (slot) {
+                return ReadSlotAttribute(slot, clusterId, attribute, buffer, maxReadLength);
+        }
+        if (attribute == Globals::Attributes::ClusterRevision::Id) {
+                return Encode(kDefaultClusterRevision, buffer, maxReadLength);
+        }
+
+        return EMBER_ZCL_STATUS_FAILURE;
+}
+
+/* Reached through the generated Set accessors, from the AttributeBatcher
+ * and the On/Off server, which then bump the data version and report */
+EmberAfStatus emberAfExternalAttributeWriteCallback(EndpointId endpoint, ClusterId clusterId,
+                                                    const EmberAfAttributeMetadata *attributeMetadata, uint8_t *buffer)
+{
+        Slot *slot = Find(endpoint);
+        const AttributeId attribute = attributeMetadata->attributeId;
+
+        VerifyOrReturnError(slot, EMBER_ZCL_STATUS_FAILURE);
+
+        if (clusterId == TemperatureMeasurement::Id &&
+            attribute == TemperatureMeasurement::Attributes::MeasuredValue::Id) {
+                const int16_t value = Decode<int16_t>(buffer);
+                slot->HasValue = value != kNullTemperature;
+                slot->Value = value;
+        } else if (clusterId == RelativeHumidityMeasurement::Id &&
+                   attribute == RelativeHumidityMeasurement::Attributes::MeasuredValue::Id) {
+                const uint16_t value = Decode<uint16_t>(buffer);
+                slot->HasValue = value != kNullHumidity;
+                slot->Value = value;
+        } else if (clusterId == OnOff::Id && attribute == OnOff::Attributes::OnOff::Id) {
+                slot->On = buffer[0] != 0;
+        } else {
+                return EMBER_ZCL_STATUS_UNSUPPORTED_WRITE;
+        }
+
+        return EMBER_ZCL_STATUS_SUCCESS;
+}
+
+CHIP_ERROR DynamicEndpoints::Init()
+{
+        const int ret = settings_load_subtree_direct(kSettingsSubtree, LoadSetting, nullptr);
+        if (ret) {
+                LOG_ERR("settings_load_subtree_direct(%s) failed: %d", kSettingsSubtree, ret);
+        }
+
+        /* Registered before their devices are found, so that the endpoints
+         * of the devices gone missing are still listed, with a null value */
+        for (Slot &slot : sSlots) {
+                if (slot.Used && Register(slot) != CHIP_NO_ERROR) {
+                        slot = Slot{};
+                }
+        }
+
+        return CHIP_NO_ERROR;
+}
+
+CHIP_ERROR DynamicEndpoints::AddMeasurement(DynamicEndpointKind kind, uint64_t uid, int16_t minValue,
+                                            int16_t maxValue, EndpointId &endpoint)
+{
+        VerifyOrReturnError(kind != DynamicEndpointKind::OnOff, CHIP_ERROR_INVALID_ARGUMENT);
+
+        Slot *slot;
+        ReturnErrorOnFailure(Claim(kind, uid, slot));
+
+        slot->MinValue = minValue;
+        slot->MaxValue = maxValue;
+        slot->Filter = PublishFilter(kind == DynamicEndpointKind::Temperature ? CONFIG_APP_PUBLISH_TEMPERATURE_DELTA :
+                                                                                CONFIG_APP_PUBLISH_HUMIDITY_DELTA,
+                                     CONFIG_APP_PUBLISH_MAX_SILENCE_MS);
+        endpoint = slot->Device.Endpoint;
+
+        return CHIP_NO_ERROR;
+}
+
+CHIP_ERROR DynamicEndpoints::AddSwitch(uint64_t uid, DynamicSwitchHandler handler, EndpointId &endpoint)
+{
+        Slot *slot;
+        ReturnErrorOnFailure(Claim(DynamicEndpointKind::OnOff, uid, slot));
+
+        slot->Handler = handler;
+        endpoint = slot->Device.Endpoint;
+
+        return CHIP_NO_ERROR;
+}
+
+CHIP_ERROR DynamicEndpoints::Remove(EndpointId endpoint)
+{
+        Slot *slot = Find(endpoint);
+        VerifyOrReturnError(slot, CHIP_ERROR_NOT_FOUND);
+
+        const size_t index = IndexOf(*slot);
+        emberAfClearDynamicEndpoint(kFirstDynamicEndpointIndex + index);
+        *slot = Slot{};
+
+        char key[sizeof(kSettingsSubtree) + 4];
+        SettingsKey(index, key);
+        const int ret = settings_delete(key);
+        if (ret) {
+                LOG_ERR("settings_delete(%s) failed: %d", key, ret);
+        }
+
+        return CHIP_NO_ERROR;
+}
+
+void DynamicEndpoints::Publish(EndpointId endpoint, int32_t value)
+{
+        Slot *slot = Find(endpoint);
+
+        if (!slot || slot->Device.Kind == DynamicEndpointKind::OnOff || !slot->Filter.Accept(value, k_uptime_get())) {
+                return;
+        }
+        slot->PublishedNull = false;
+
+        if (slot->Device.Kind == DynamicEndpointKind::Temperature) {
+                AttributeBatcher::SetTemperature(endpoint, static_cast<int16_t>(value));
+        } else {
+                AttributeBatcher::SetHumidity(endpoint, static_cast<uint16_t>(value));
+        }
+}
+
+void DynamicEndpoints::PublishNull(EndpointId endpoint)
+{
+        Slot *slot = Find(endpoint);
+
+        if (!slot || slot->Device.Kind == DynamicEndpointKind::OnOff || slot->PublishedNull) {
+                return;
+        }
+
+        slot->PublishedNull = true;
+        slot->Filter.Reset();
+        if (slot->Device.Kind == DynamicEndpointKind::Temperature) {
+                AttributeBatcher::SetTemperatureNull(endpoint);
+        } else {
+                AttributeBatcher::SetHumidityNull(endpoint);
+        }
+}
+
+void DynamicEndpoints::OnOffChanged(EndpointId endpoint, bool on)
+{
+        const Slot *slot = Find(endpoint);
+
+        if (slot && slot->Device.Kind == DynamicEndpointKind::OnOff && slot->Handler) {
+                slot->Handler(endpoint, on);
+        }
+}
+
+bool DynamicEndpoints::GetInfo(size_t slot, Info &info)
+{
+        if (slot >= kPoolSize || !sSlots[slot].Used) {
+                return false;
+        }
+
+        info.Endpoint = sSlots[slot].Device.Endpoint;
+        info.Kind = sSlots[slot].Device.Kind;
+        info.Uid = sSlots[slot].Device.Uid;
+        info.Attached = sSlots[slot].Attached;
+        return true;
+}
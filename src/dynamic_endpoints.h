@@ -0,0 +1,92 @@
+/* ****************************************************************************
+ *
+ *  DYNAMIC ENDPOINTS - dynamic_endpoints.cpp
+ *
+ * The fixed endpoints come from the ZAP file, so any new probe or relay
+ * would need a ZAP regeneration and a reflash. DynamicEndpoints creates
+ * Temperature, Humidity and On/Off endpoints at runtime instead, bridge
+ * style, on top of emberAfSetDynamicEndpoint():
+ *
+ *   Temperature: Temperature Sensor device, TemperatureMeasurement cluster
+ *   Humidity: Humidity Sensor device, RelativeHumidityMeasurement cluster
+ *   OnOff: On/Off Plug-in Unit device, On/Off cluster, On/Off/Toggle
+ *
+ * Every endpoint belongs to a device identified by a 64 bit unique ID (the
+ * ROM ID of a DS18B20 probe...). The device-to-endpoint records are
+ * persisted in the settings subsystem ("dynep/<slot>") and registered again
+ * at Init, so that a device keeps its endpoint across reboots and the
+ * controllers keep their bindings, even when the hardware is discovered in
+ * a different order. The new devices get the lowest free endpoint from
+ * kFirstEndpointId.
+ *
+ * The attribute storage is a preallocated pool of kPoolSize slots, one per
+ * endpoint, holding its data versions and attribute values. The attributes
+ * use the external storage of the ember layer, served by the
+ * emberAfExternalAttribute*Callback() pair, so the generated accessors, the
+ * AttributeBatcher and the On/Off server work on these endpoints like on
+ * the fixed ones. MeasuredValue is null until the first value is published.
+ * That callback pair is the only one of the firmware, it also serves the
+ * ClusterRevision of the terrarium, thermostat and probe endpoints.
+ *
+ * Init: load the persisted records and register their endpoints, before
+ *       the Matter thread runs
+ * AddMeasurement: attach a Temperature or Humidity device with its
+ *                 MinMeasuredValue and MaxMeasuredValue, registering a new
+ *                 endpoint if the device has none yet
+ * AddSwitch: attach an On/Off device and the handler of its commands, with
+ *            uid kVirtualSwitch for a virtual switch that is only kept for
+ *            the controllers automations
+ * Remove: unregister an endpoint and forget its record
+ * Publish: filter a measurement with the CONFIG_APP_PUBLISH_* delta and max
+ *          silence interval and queue it on the AttributeBatcher, AppTask
+ *          only
+ * PublishNull: set the MeasuredValue of a failed device to null, once, the
+ *              next value is then published whatever the delta, AppTask
+ *              only
+ * OnOffChanged: call the handler of a switch, from the Matter thread
+ * GetInfo: describe the endpoint of a slot, false if the slot is free
+ *
+ * Add and Remove must run before the Matter thread, or with the Matter
+ * stack locked.
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <lib/core/CHIPError.h>
+#include <lib/core/DataModelTypes.h>
+
+enum class DynamicEndpointKind : uint8_t { Temperature, Humidity, OnOff };
+
+/* Runs on the Matter thread, post to the AppTask for anything slow */
+using DynamicSwitchHandler = void (*)(chip::EndpointId endpoint, bool on);
+
+class DynamicEndpoints {
+public:
+        static constexpr size_t kPoolSize = CONFIG_APP_DYNAMIC_ENDPOINT_POOL_SIZE;
+        /* After the fixed endpoints (1-11) and the terrarium (12) and hot
+         * lamp thermostat (13) dynamic endpoints */
+        static constexpr chip::EndpointId kFirstEndpointId = 14;
+        static constexpr uint64_t kVirtualSwitch = 0;
+
+        struct Info {
+                chip::EndpointId Endpoint;
+                DynamicEndpointKind Kind;
+                uint64_t Uid;
+                /* Claimed by its device since the boot */
+                bool Attached;
+        };
+
+        static CHIP_ERROR Init();
+        static CHIP_ERROR AddMeasurement(DynamicEndpointKind kind, uint64_t uid, int16_t minValue, int16_t maxValue,
+                                         chip::EndpointId &endpoint);
+        static CHIP_ERROR AddSwitch(uint64_t uid, DynamicSwitchHandler handler, chip::EndpointId &endpoint);
+        static CHIP_ERROR Remove(chip::EndpointId endpoint);
+        static void Publish(chip::EndpointId endpoint, int32_t value);
+        static void PublishNull(chip::EndpointId endpoint);
+        static void OnOffChanged(chip::EndpointId endpoint, bool on);
+        static bool GetInfo(size_t slot, Info &info);
+};
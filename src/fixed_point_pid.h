@@ -0,0 +1,101 @@
+/* ****************************************************************************
+ *
+ *  FIXED-POINT PID - fixed_point_pid.h
+ *
+ * Integer PID controller for the slow thermal loops, with no floating point
+ * on the control path. The gains are Q16.16 fixed-point numbers expressed in
+ * output units per input unit, Ki per second and Kd times second, so the
+ * caller picks the units of the measurement and of the output range.
+ *
+ * The derivative acts on the measurement rather than on the error, so a
+ * setpoint change does not kick the output. The integral is anti-windup
+ * protected: it is clamped to the output range and stops integrating while
+ * the output is saturated in the direction of the error.
+ *
+ * Update: return the new output for a measurement taken dtMs after the
+ *         previous one
+ * Reset: forget the integral and the previous measurement
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+class FixedPointPid {
+public:
+        static constexpr int kFractionBits = 16;
+
+        struct Gains {
+                int32_t Kp;
+                int32_t Ki;
+                int32_t Kd;
+        };
+
+        static constexpr int32_t FromMilli(int32_t milli)
+        {
+                return static_cast<int32_t>((static_cast<int64_t>(milli) << kFractionBits) / 1000);
+        }
+
+        static constexpr int32_t ToMilli(int32_t fixed)
+        {
+                return static_cast<int32_t>((static_cast<int64_t>(fixed) * 1000) >> kFractionBits);
+        }
+
+        constexpr FixedPointPid(const Gains &gains, int32_t outputMin, int32_t outputMax)
+                : mGains(gains), mOutputMin(outputMin), mOutputMax(outputMax)
+        {
+        }
+
+        constexpr int32_t Update(int32_t setpoint, int32_t measurement, uint32_t dtMs)
+        {
+                const int64_t error = static_cast<int64_t>(setpoint) - measurement;
+                const int64_t min = static_cast<int64_t>(mOutputMin) << kFractionBits;
+                const int64_t max = static_cast<int64_t>(mOutputMax) << kFractionBits;
+
+                const int64_t proportional = mGains.Kp * error;
+
+                int64_t derivative = 0;
+                if (mPrimed && dtMs > 0) {
+                        derivative = -mGains.Kd * (static_cast<int64_t>(measurement) - mPrevMeasurement) * 1000 /
+                                     dtMs;
+                }
+
+                const int64_t integral = Clamp(mIntegral + mGains.Ki * error * dtMs / 1000, min, max);
+                const int64_t unclamped = proportional + integral + derivative;
+
+                /* Conditional integration: keep the previous integral when the
+                 * output is already saturated by the error sign */
+                if (!(unclamped > max && error > 0) && !(unclamped < min && error < 0)) {
+                        mIntegral = integral;
+                }
+
+                mPrevMeasurement = measurement;
+                mPrimed = true;
+
+                return static_cast<int32_t>(Clamp(proportional + mIntegral + derivative, min, max) >> kFractionBits);
+        }
+
+        constexpr void Reset()
+        {
+                mIntegral = 0;
+                mPrimed = false;
+        }
+
+        constexpr const Gains &GetGains() const { return mGains; }
+        constexpr void SetGains(const Gains &gains) { mGains = gains; }
+
+private:
+        static constexpr int64_t Clamp(int64_t value, int64_t min, int64_t max)
+        {
+                return value < min ? min : (value > max ? max : value);
+        }
+
+        Gains mGains;
+        int32_t mOutputMin;
+        int32_t mOutputMax;
+        /* Q16.16, output units */
+        int64_t mIntegral = 0;
+        int32_t mPrevMeasurement = 0;
+        bool mPrimed = false;
+};
@@ -0,0 +1,763 @@
+#include "flash_log.h"
+#include "spsc_ring.h"
+
+#include <pm_config.h>
+
+#include <cstddef>
+#include <cstring>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/crc.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+namespace
+{
+/* MX25R64 erase sector and program page */
+constexpr uint32_t kSectorSize = 4096;
+constexpr uint32_t kPageSize = 256;
+constexpr uint32_t kPartitionSectors = PM_EXTERNAL_FLASH_SIZE / kSectorSize;
+constexpr uint32_t kMinuteSectors = CONFIG_APP_FLASH_LOG_MINUTE_ROLLUP_SECTORS;
+constexpr uint32_t kHourSectors = CONFIG_APP_FLASH_LOG_HOUR_ROLLUP_SECTORS;
+constexpr uint32_t kDaySectors = CONFIG_APP_FLASH_LOG_DAY_ROLLUP_SECTORS;
+#ifdef CONFIG_APP_FLASH_LOG_BENCHMARK
+constexpr uint32_t kBenchmarkSectors = CONFIG_APP_FLASH_LOG_BENCHMARK_SECTORS;
+#else
+constexpr uint32_t kBenchmarkSectors = 0;
+#endif
+constexpr uint32_t kRawSectors = kPartitionSectors - kMinuteSectors - kHourSectors - kDaySectors - kBenchmarkSectors;
+constexpr size_t kPendingRecords = 64;
+constexpr size_t kPendingRollups = 16;
+/* FirstTime of a sector without record */
+constexpr uint32_t kNoRecord = 0;
+/* Log time of an empty log, one day so that no rollup period starts at
+ * kNoRecord */
+constexpr uint32_t kFirstLogTime = 86400;
+
+static_assert(PM_EXTERNAL_FLASH_ADDRESS % kSectorSize == 0, "external_flash must be sector aligned");
+static_assert(kMinuteSectors + kHourSectors + kDaySectors + kBenchmarkSectors < kPartitionSectors,
+              "rollups fill the partition");
+static_assert(kRawSectors >= 2, "the raw log needs at least two sectors");
+
+/* The rings only rely on the time leading a record and the CRC ending it */
+static_assert(offsetof(LogRecord, Time) == 0 && offsetof(LogRecord, Crc) == sizeof(LogRecord) - 1,
+              "invalid LogRecord layout");
+static_assert(offsetof(RollupRecord, Time) == 0 && offsetof(RollupRecord, Crc) == sizeof(RollupRecord) - 1,
+              "invalid RollupRecord layout");
+static_assert(kPageSize % sizeof(RollupRecord) == 0 && kPageSize % sizeof(LogRecord) == 0,
+              "records must not straddle pages");
+
+struct SectorHeader {
+        uint32_t Magic;
+        uint32_t Sequence;
+        uint32_t EraseCount;
+        uint32_t Crc;
+};
+
+constexpr uint32_t kFirstRecordOffset = sizeof(SectorHeader);
+static_assert(kFirstRecordOffset % sizeof(RollupRecord) == 0 && kFirstRecordOffset % sizeof(LogRecord) == 0,
+              "records must stay aligned");
+
+struct PendingRollup {
+        RollupResolution Resolution;
+        RollupRecord Record;
+};
+
+uint32_t HeaderCrc(const SectorHeader &header)
+{
+        return crc32_ieee(reinterpret_cast<const uint8_t *>(&header), offsetof(SectorHeader, Crc));
+}
+
+bool IsErased(const uint8_t *data, size_t length)
+{
+        for (size_t i = 0; i < length; i++) {
+                if (data[i] != 0xFF) {
+                        return false;
+                }
+        }
+        return true;
+}
+
+const struct flash_area *sArea;
+
+/* Ring of erase sectors of fixed size records, in a slice of the partition.
+ * Every ring has its own sector magic, so that resizing the slices only
+ * makes the sectors that changed ring look empty. */
+class SectorRing {
+public:
+        using RecordCallback = bool (*)(const uint8_t *record, void *context);
+
+        constexpr SectorRing(const char *name, uint32_t magic, uint32_t firstSector, uint32_t sectorCount,
+                   uint32_t recordSize, uint32_t *firstTime)
+                : mName(name), mMagic(magic), mFirstSector(firstSector), mSectorCount(sectorCount),
+                  mRecordSize(recordSize), mFirstTime(firstTime)
+        {
+        }
+
+        int Mount(uint32_t &lastTime);
+        int Append(const void *record);
+        int ProgramPending();
+        int ProgramPage();
+        int Flush();
+        int Query(uint32_t fromTime, uint32_t toTime, RecordCallback callback, void *context);
+        void AddStats(FlashLog::Stats &stats);
+
+        uint32_t HeadSequence() const { return mHeadSequence; }
+
+private:
+        off_t SectorOffset(uint32_t sector) const
+        {
+                return static_cast<off_t>(mFirstSector + sector) * kSectorSize;
+        }
+
+        bool IsValid(const uint8_t *record) const
+        {
+                return crc8_ccitt(0xFF, record, mRecordSize - 1) == record[mRecordSize - 1];
+        }
+
+        static uint32_t TimeOf(const uint8_t *record)
+        {
+                uint32_t time;
+                memcpy(&time, record, sizeof(time));
+                return time;
+        }
+
+        bool ReadHeader(uint32_t sector, SectorHeader &header);
+        int OpenSector(uint32_t sector, uint32_t sequence);
+        int NextSector();
+        void ScanSector(uint32_t sector, uint32_t &end, uint32_t &lastTime);
+        uint32_t SectorAt(uint32_t position) const;
+        uint32_t PositionKey(uint32_t position) const;
+        uint32_t FindStart(uint32_t fromTime) const;
+
+        const char *mName;
+        uint32_t mMagic;
+        uint32_t mFirstSector;
+        uint32_t mSectorCount;
+        uint32_t mRecordSize;
+        /* Sparse index: log time of the first record of every sector */
+        uint32_t *mFirstTime;
+        uint32_t mHead = 0;
+        uint32_t mHeadSequence = 0;
+        /* Offset of the next record in the head sector */
+        uint32_t mOffset = kFirstRecordOffset;
+        /* Records of the current page, from mPageStart, the first
+         * mProgrammed bytes are already programmed */
+        uint8_t mPage[kPageSize] = {};
+        uint32_t mPageStart = 0;
+        uint32_t mPageLength = 0;
+        uint32_t mProgrammed = 0;
+};
+
+K_THREAD_STACK_DEFINE(sLogStack, CONFIG_APP_FLASH_LOG_THREAD_STACK_SIZE);
+k_work_q sLogWorkQueue;
+
+/* Records posted by the AppTask, programmed by the log work queue */
+SpscRing<LogRecord, kPendingRecords> sPending;
+SpscRing<PendingRollup, kPendingRollups> sPendingRollups;
+
+atomic_t sAppended;
+atomic_t sDropped;
+atomic_t sWriteErrors;
+atomic_t sCrcErrors;
+
+/* The ring state is protected by sLogMutex, which the writers release
+ * while they erase a sector, so that a query never waits for an erase.
+ * sWriteMutex keeps the writers from running meanwhile */
+K_MUTEX_DEFINE(sLogMutex);
+K_MUTEX_DEFINE(sWriteMutex);
+bool sMounted;
+
+uint32_t sRawFirstTime[kRawSectors];
+uint32_t sMinuteFirstTime[kMinuteSectors];
+uint32_t sHourFirstTime[kHourSectors];
+uint32_t sDayFirstTime[kDaySectors];
+
+SectorRing sRawRing("raw", 0x544C4F47, 0, kRawSectors, sizeof(LogRecord), sRawFirstTime);
+SectorRing sRollupRings[SensorRollups::kResolutionCount] = {
+        SectorRing("minute", 0x544C4D4E, kRawSectors, kMinuteSectors, sizeof(RollupRecord), sMinuteFirstTime),
+        SectorRing("hour", 0x544C4852, kRawSectors + kMinuteSectors, kHourSectors, sizeof(RollupRecord),
+                   sHourFirstTime),
+        SectorRing("day", 0x544C4459, kRawSectors + kMinuteSectors + kHourSectors, kDaySectors,
+                   sizeof(RollupRecord), sDayFirstTime),
+};
+
+#ifdef CONFIG_APP_FLASH_LOG_BENCHMARK
+/* Scratch sectors at the end of the partition, the benchmark records
+ * never reach the log */
+uint32_t sBenchmarkFirstTime[kBenchmarkSectors];
+SectorRing sBenchmarkRing("bench", 0x544C424E, kPartitionSectors - kBenchmarkSectors, kBenchmarkSectors,
+                          sizeof(LogRecord), sBenchmarkFirstTime);
+bool sBenchmarkMounted;
+#endif
+
+/* Log time at uptime 0, so that the log time continues the last record */
+int64_t sTimeBase;
+
+SectorRing &RollupRing(RollupResolution resolution)
+{
+        return sRollupRings[static_cast<size_t>(resolution)];
+}
+
+bool SectorRing::ReadHeader(uint32_t sector, SectorHeader &header)
+{
+        return flash_area_read(sArea, SectorOffset(sector), &header, sizeof(header)) == 0 &&
+               header.Magic == mMagic && header.Crc == HeaderCrc(header);
+}
+
+/* Program the records of the current page not programmed yet, the page
+ * stays current so that the next records fill the rest of it */
+int SectorRing::ProgramPending()
+{
+        if (mProgrammed == mPageLength) {
+                return 0;
+        }
+
+        const int ret = flash_area_write(sArea, SectorOffset(mHead) + mPageStart + mProgrammed, mPage + mProgrammed,
+                                         mPageLength - mProgrammed);
+        if (ret) {
+                LOG_ERR("flash_area_write() failed: %d", ret);
+        }
+        mProgrammed = mPageLength;
+
+        return ret;
+}
+
+int SectorRing::ProgramPage()
+{
+        const int ret = ProgramPending();
+
+        mPageLength = 0;
+        mProgrammed = 0;
+
+        return ret;
+}
+
+/* Erase the sector and make it the new head, called with sWriteMutex and
+ * sLogMutex held once. The queries skip the sector as soon as its first
+ * time is cleared, so sLogMutex is released during the erase */
+int SectorRing::OpenSector(uint32_t sector, uint32_t sequence)
+{
+        SectorHeader header;
+        const uint32_t eraseCount = ReadHeader(sector, header) ? header.EraseCount + 1 : 1;
+
+        mFirstTime[sector] = kNoRecord;
+
+        k_mutex_unlock(&sLogMutex);
+        int ret = flash_area_erase(sArea, SectorOffset(sector), kSectorSize);
+        k_mutex_lock(&sLogMutex, K_FOREVER);
+        if (ret) {
+                LOG_ERR("flash_area_erase() failed: %d", ret);
+                return ret;
+        }
+
+        header = { mMagic, sequence, eraseCount, 0 };
+        header.Crc = HeaderCrc(header);
+        ret = flash_area_write(sArea, SectorOffset(sector), &header, sizeof(header));
+        if (ret) {
+                LOG_ERR("flash_area_write() failed: %d", ret);
+                return ret;
+        }
+
+        mHead = sector;
+        mHeadSequence = sequence;
+        mOffset = kFirstRecordOffset;
+        mPageLength = 0;
+        mProgrammed = 0;
+
+        return 0;
+}
+
+int SectorRing::NextSector()
+{
+        return OpenSector((mHead + 1) % mSectorCount, mHeadSequence + 1);
+}
+
+/* Append a record whose last byte is left for the CRC */
+int SectorRing::Append(const void *record)
+{
+        if (mPageLength == 0) {
+                mPageStart = mOffset;
+        }
+        uint8_t *data = mPage + mPageLength;
+        memcpy(data, record, mRecordSize);
+        data[mRecordSize - 1] = crc8_ccitt(0xFF, data, mRecordSize - 1);
+        mPageLength += mRecordSize;
+        mOffset += mRecordSize;
+
+        if (mFirstTime[mHead] == kNoRecord) {
+                mFirstTime[mHead] = TimeOf(data);
+        }
+
+        int ret = 0;
+        if (mOffset % kPageSize == 0) {
+                ret = ProgramPage();
+        }
+        if (mOffset == kSectorSize) {
+                ret = NextSector();
+        }
+        return ret;
+}
+
+int SectorRing::Flush()
+{
+        int ret = ProgramPage();
+
+        mOffset = ROUND_UP(mOffset, kPageSize);
+        if (ret == 0 && mOffset >= kSectorSize) {
+                ret = NextSector();
+        }
+        return ret;
+}
+
+/* Find the end of the records of a sector and the time of its last one */
+void SectorRing::ScanSector(uint32_t sector, uint32_t &end, uint32_t &lastTime)
+{
+        uint8_t page[kPageSize];
+
+        end = kFirstRecordOffset;
+        for (uint32_t offset = 0; offset < kSectorSize; offset += kPageSize) {
+                if (flash_area_read(sArea, SectorOffset(sector) + offset, page, sizeof(page))) {
+                        return;
+                }
+                for (uint32_t i = offset ? 0 : kFirstRecordOffset; i < kPageSize; i += mRecordSize) {
+                        if (IsErased(page + i, mRecordSize)) {
+                                continue;
+                        }
+                        end = offset + i + mRecordSize;
+                        if (IsValid(page + i)) {
+                                lastTime = MAX(lastTime, TimeOf(page + i));
+                        }
+                }
+        }
+}
+
+/* Rebuild the index and find the head, the sector with the highest
+ * sequence number. A sector with an invalid header is empty. */
+int SectorRing::Mount(uint32_t &lastTime)
+{
+        bool found = false;
+
+        for (uint32_t sector = 0; sector < mSectorCount; sector++) {
+                SectorHeader header;
+                uint8_t first[sizeof(RollupRecord)];
+
+                mFirstTime[sector] = kNoRecord;
+                if (!ReadHeader(sector, header)) {
+                        continue;
+                }
+                if (!found || header.Sequence > mHeadSequence) {
+                        found = true;
+                        mHead = sector;
+                        mHeadSequence = header.Sequence;
+                }
+                if (flash_area_read(sArea, SectorOffset(sector) + kFirstRecordOffset, first, mRecordSize) == 0 &&
+                    !IsErased(first, mRecordSize) && IsValid(first)) {
+                        mFirstTime[sector] = TimeOf(first);
+                        lastTime = MAX(lastTime, TimeOf(first));
+                }
+        }
+
+        if (!found) {
+                LOG_INF("Flash log %s ring is empty, %u sectors", mName, mSectorCount);
+                return OpenSector(0, 1);
+        }
+
+        uint32_t end;
+        ScanSector(mHead, end, lastTime);
+        if (end == kFirstRecordOffset) {
+                /* Empty head, the last records are in the previous sector */
+                uint32_t previousEnd;
+                ScanSector((mHead + mSectorCount - 1) % mSectorCount, previousEnd, lastTime);
+        }
+
+        /* Resume on the next page, the end of a flushed page stays erased */
+        mOffset = end == kFirstRecordOffset ? end : ROUND_UP(end, kPageSize);
+        mPageLength = 0;
+        mProgrammed = 0;
+        LOG_INF("Flash log %s ring head sector %u, sequence %u", mName, mHead, mHeadSequence);
+
+        return mOffset >= kSectorSize ? NextSector() : 0;
+}
+
+/* Ring position 0 is the oldest sector, the one after the head */
+uint32_t SectorRing::SectorAt(uint32_t position) const
+{
+        return (mHead + 1 + position) % mSectorCount;
+}
+
+/* Index key of a ring position: the empty sectors before the head were
+ * never written and sort before all the others, an empty head sorts last */
+uint32_t SectorRing::PositionKey(uint32_t position) const
+{
+        const uint32_t firstTime = mFirstTime[SectorAt(position)];
+
+        if (firstTime == kNoRecord) {
+                return position == mSectorCount - 1 ? UINT32_MAX : 0;
+        }
+        return firstTime;
+}
+
+/* Last ring position whose first record is not after fromTime */
+uint32_t SectorRing::FindStart(uint32_t fromTime) const
+{
+        uint32_t low = 0;
+        uint32_t high = mSectorCount;
+
+        while (high - low > 1) {
+                const uint32_t middle = low + (high - low) / 2;
+                if (PositionKey(middle) <= fromTime) {
+                        low = middle;
+                } else {
+                        high = middle;
+                }
+        }
+        return low;
+}
+
+int SectorRing::Query(uint32_t fromTime, uint32_t toTime, RecordCallback callback, void *context)
+{
+        uint8_t page[kPageSize];
+
+        k_mutex_lock(&sLogMutex, K_FOREVER);
+        uint32_t sector = SectorAt(FindStart(fromTime));
+        k_mutex_unlock(&sLogMutex);
+
+        /* Walk the sectors in log order up to the head, which may move on
+         * while the query runs */
+        for (uint32_t count = 0; count < mSectorCount; count++, sector = (sector + 1) % mSectorCount) {
+                bool last = false;
+
+                for (uint32_t offset = 0; offset < kSectorSize; offset += kPageSize) {
+                        k_mutex_lock(&sLogMutex, K_FOREVER);
+
+                        const uint32_t firstTime = mFirstTime[sector];
+                        const bool head = sector == mHead;
+                        last = head || (firstTime != kNoRecord && firstTime > toTime);
+                        if (firstTime == kNoRecord || firstTime > toTime || (head && offset >= mOffset)) {
+                                k_mutex_unlock(&sLogMutex);
+                                break;
+                        }
+
+                        const int ret = flash_area_read(sArea, SectorOffset(sector) + offset, page, sizeof(page));
+                        /* Overlay the records of the head page not programmed yet */
+                        if (ret == 0 && head && mPageLength && ROUND_DOWN(mPageStart, kPageSize) == offset) {
+                                memcpy(page + (mPageStart - offset), mPage, mPageLength);
+                        }
+                        k_mutex_unlock(&sLogMutex);
+                        if (ret) {
+                                return ret;
+                        }
+
+                        for (uint32_t i = offset ? 0 : kFirstRecordOffset; i < kPageSize; i += mRecordSize) {
+                                if (IsErased(page + i, mRecordSize)) {
+                                        continue;
+                                }
+                                if (!IsValid(page + i)) {
+                                        atomic_inc(&sCrcErrors);
+                                        continue;
+                                }
+                                const uint32_t time = TimeOf(page + i);
+                                if (time < fromTime || time > toTime) {
+                                        continue;
+                                }
+                                if (!callback(page + i, context)) {
+                                        return 0;
+                                }
+                        }
+                }
+
+                if (last) {
+                        break;
+                }
+        }
+
+        return 0;
+}
+
+/* Wear and usage of the ring sectors, called with sLogMutex held */
+void SectorRing::AddStats(FlashLog::Stats &stats)
+{
+        for (uint32_t sector = 0; sector < mSectorCount; sector++) {
+                SectorHeader header;
+                const uint32_t eraseCount = ReadHeader(sector, header) ? header.EraseCount : 0;
+
+                stats.MinEraseCount = MIN(stats.MinEraseCount, eraseCount);
+                stats.MaxEraseCount = MAX(stats.MaxEraseCount, eraseCount);
+                if (mFirstTime[sector] != kNoRecord) {
+                        stats.UsedSectors++;
+                }
+        }
+}
+
+int Mount()
+{
+        uint32_t lastTime = 0;
+
+        int ret = sRawRing.Mount(lastTime);
+        for (SectorRing &ring : sRollupRings) {
+                if (ret == 0) {
+                        ret = ring.Mount(lastTime);
+                }
+        }
+
+        sTimeBase = static_cast<int64_t>(MAX(lastTime + 1, kFirstLogTime)) - k_uptime_get() / 1000;
+        LOG_INF("Flash log time %u", lastTime);
+
+        return ret;
+}
+
+void CountWrite(int ret)
+{
+        atomic_inc(ret ? &sWriteErrors : &sAppended);
+}
+
+void DrainPending(k_work *)
+{
+        LogRecord record;
+        PendingRollup rollup;
+
+        k_mutex_lock(&sWriteMutex, K_FOREVER);
+        k_mutex_lock(&sLogMutex, K_FOREVER);
+        while (sPending.Pop(record)) {
+                CountWrite(sRawRing.Append(&record));
+        }
+
+        /* A closed rollup is programmed at once, not when its page fills
+         * up, which takes days at the 1 day resolution */
+        bool rollups = false;
+        while (sPendingRollups.Pop(rollup)) {
+                CountWrite(RollupRing(rollup.Resolution).Append(&rollup.Record));
+                rollups = true;
+        }
+        if (rollups) {
+                for (SectorRing &ring : sRollupRings) {
+                        if (ring.ProgramPending()) {
+                                atomic_inc(&sWriteErrors);
+                        }
+                }
+        }
+        k_mutex_unlock(&sLogMutex);
+        k_mutex_unlock(&sWriteMutex);
+}
+
+K_WORK_DEFINE(sDrainWork, DrainPending);
+
+void Post(uint32_t time, uint8_t source, int16_t value)
+{
+        if (!sMounted) {
+                return;
+        }
+
+        LogRecord record = {};
+        record.Time = time;
+        record.Source = source;
+        record.Value = value;
+
+        if (!sPending.Push(record)) {
+                atomic_inc(&sDropped);
+                return;
+        }
+        k_work_submit_to_queue(&sLogWorkQueue, &sDrainWork);
+}
+
+/* Hand the records read by a ring over to a typed query callback */
+template <typename Record, typename Callback> struct TypedQuery {
+        Callback UserCallback;
+        void *UserContext;
+
+        static bool Dispatch(const uint8_t *data, void *context)
+        {
+                const TypedQuery &query = *static_cast<const TypedQuery *>(context);
+                Record record;
+
+                memcpy(&record, data, sizeof(record));
+                return query.UserCallback(record, query.UserContext);
+        }
+};
+} /* namespace */
+
+int FlashLog::Init()
+{
+        int ret = flash_area_open(PM_EXTERNAL_FLASH_ID, &sArea);
+        if (ret) {
+                LOG_ERR("flash_area_open() failed: %d", ret);
+                return ret;
+        }
+
+        k_mutex_lock(&sWriteMutex, K_FOREVER);
+        k_mutex_lock(&sLogMutex, K_FOREVER);
+        ret = Mount();
+        k_mutex_unlock(&sLogMutex);
+        k_mutex_unlock(&sWriteMutex);
+        if (ret) {
+                return ret;
+        }
+
+        k_work_queue_config config = {};
+        config.name = "flash_log";
+        k_work_queue_start(&sLogWorkQueue, sLogStack, K_THREAD_STACK_SIZEOF(sLogStack),
+                           CONFIG_APP_FLASH_LOG_THREAD_PRIORITY, &config);
+        sMounted = true;
+
+        return 0;
+}
+
+void FlashLog::RecordMeasurement(HistoryChannel channel, int64_t timestampMs, int16_t value)
+{
+        Post(ToLogTime(timestampMs), static_cast<uint8_t>(channel), value);
+}
+
+void FlashLog::RecordActuator(chip::EndpointId endpoint, bool on)
+{
+        Post(LogTime(), static_cast<uint8_t>(kActuatorSource + endpoint), on);
+}
+
+void FlashLog::RecordRollup(RollupResolution resolution, const RollupRecord &record)
+{
+        if (!sMounted) {
+                return;
+        }
+
+        if (!sPendingRollups.Push({ resolution, record })) {
+                atomic_inc(&sDropped);
+                return;
+        }
+        k_work_submit_to_queue(&sLogWorkQueue, &sDrainWork);
+}
+
+int FlashLog::Query(uint32_t fromTime, uint32_t toTime, QueryCallback callback, void *context)
+{
+        if (!sMounted) {
+                return -ENODEV;
+        }
+
+        TypedQuery<LogRecord, QueryCallback> query = { callback, context };
+        return sRawRing.Query(fromTime, toTime, query.Dispatch, &query);
+}
+
+int FlashLog::QueryRollups(RollupResolution resolution, uint32_t fromTime, uint32_t toTime, RollupCallback callback,
+                           void *context)
+{
+        if (!sMounted) {
+                return -ENODEV;
+        }
+
+        TypedQuery<RollupRecord, RollupCallback> query = { callback, context };
+        return RollupRing(resolution).Query(fromTime, toTime, query.Dispatch, &query);
+}
+
+int FlashLog::Flush()
+{
+        if (!sMounted) {
+                return -ENODEV;
+        }
+
+        k_mutex_lock(&sWriteMutex, K_FOREVER);
+        k_mutex_lock(&sLogMutex, K_FOREVER);
+        int ret = sRawRing.Flush();
+        for (SectorRing &ring : sRollupRings) {
+                if (ret == 0) {
+                        ret = ring.Flush();
+                }
+        }
+        k_mutex_unlock(&sLogMutex);
+        k_mutex_unlock(&sWriteMutex);
+
+        return ret;
+}
+
+uint32_t FlashLog::LogTime()
+{
+        return ToLogTime(k_uptime_get());
+}
+
+uint32_t FlashLog::ToLogTime(int64_t uptimeMs)
+{
+        return static_cast<uint32_t>(sTimeBase + uptimeMs / 1000);
+}
+
+FlashLog::Stats FlashLog::GetStats()
+{
+        Stats stats = {};
+
+        stats.Sectors = kPartitionSectors - kBenchmarkSectors;
+        stats.MinEraseCount = UINT32_MAX;
+        stats.Appended = atomic_get(&sAppended);
+        stats.Dropped = atomic_get(&sDropped);
+        stats.CrcErrors = atomic_get(&sCrcErrors);
+        stats.WriteErrors = atomic_get(&sWriteErrors);
+
+        if (!sMounted) {
+                return stats;
+        }
+
+        k_mutex_lock(&sLogMutex, K_FOREVER);
+        stats.HeadSequence = sRawRing.HeadSequence();
+        sRawRing.AddStats(stats);
+        for (SectorRing &ring : sRollupRings) {
+                ring.AddStats(stats);
+        }
+        k_mutex_unlock(&sLogMutex);
+
+        return stats;
+}
+
+#ifdef CONFIG_APP_FLASH_LOG_BENCHMARK
+int FlashLog::Benchmark(uint32_t records, BenchmarkResult &result)
+{
+        if (!sMounted) {
+                return -ENODEV;
+        }
+
+        result = {};
+        result.Records = records;
+
+        const uint32_t now = LogTime();
+        int ret = 0;
+
+        k_mutex_lock(&sWriteMutex, K_FOREVER);
+        k_mutex_lock(&sLogMutex, K_FOREVER);
+        if (!sBenchmarkMounted) {
+                /* The scratch records do not move the log time */
+                uint32_t lastTime = 0;
+                ret = sBenchmarkRing.Mount(lastTime);
+                sBenchmarkMounted = ret == 0;
+        }
+
+        const int64_t appendStart = k_uptime_ticks();
+        for (uint32_t i = 0; i < records && ret == 0; i++) {
+                LogRecord record = {};
+                record.Time = now;
+                record.Source = kBenchmarkSource;
+                record.Value = static_cast<int16_t>(i);
+                ret = sBenchmarkRing.Append(&record);
+        }
+        if (ret == 0) {
+                ret = sBenchmarkRing.ProgramPage();
+        }
+        result.AppendUs = static_cast<uint32_t>(k_ticks_to_us_ceil64(k_uptime_ticks() - appendStart));
+        k_mutex_unlock(&sLogMutex);
+        k_mutex_unlock(&sWriteMutex);
+
+        if (ret) {
+                return ret;
+        }
+
+        /* Query the last hour of the log itself, only read */
+        const int64_t queryStart = k_uptime_ticks();
+        ret = Query(
+                now > 3600 ? now - 3600 : 0, now,
+                [](const LogRecord &, void *context) {
+                        (*static_cast<uint32_t *>(context))++;
+                        return true;
+                },
+                &result.QueryRecords);
+        result.QueryUs = static_cast<uint32_t>(k_ticks_to_us_ceil64(k_uptime_ticks() - queryStart));
+
+        return ret;
+}
+#endif
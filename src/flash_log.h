@@ -0,0 +1,133 @@
+/* ****************************************************************************
+ *
+ *  FLASH LOG - flash_log.cpp
+ *
+ * Append-only log of the sensor measurements and of the actuator changes on
+ * the external_flash partition of the MX25R64, so that weeks of history
+ * survive reboots and network outages.
+ *
+ * The partition is used as a ring of 4 KB sectors, written in order and
+ * erased one at a time just before reuse, so every sector is erased once
+ * per lap of the ring and the wear is level by construction. A sector
+ * starts with a CRC-checked header holding its sequence number and erase
+ * count, followed by 8 byte CRC8-checked records. The records are batched
+ * in RAM and programmed one 256 byte page at a time.
+ *
+ * The record time is the log time, in seconds: the uptime plus the time of
+ * the last record found at boot, so it keeps increasing across reboots.
+ * The time of the first record of every sector is kept in a sparse RAM
+ * index, a range query binary-searches it and only reads the sectors of
+ * the range.
+ *
+ * The closed rollups of SensorRollups (see sensor_rollups.h) are kept in
+ * three smaller rings at the end of the partition, one per resolution,
+ * made of 16 byte records, so that a long range query at a coarse
+ * resolution does not read through the raw records. A closed rollup is
+ * programmed as soon as it is drained, into the erased rest of the
+ * current page, so a reboot never loses the rollups of the past days.
+ *
+ * The flash is only programmed and erased from the log work queue thread,
+ * the AppTask never waits for it. A query is not held up by the sector
+ * erases either, the log lock is released while they run.
+ *
+ * Init: mount the partition, recover the head of the log and the index
+ * RecordMeasurement: log a HistoryChannel value, AppTask only
+ * RecordActuator: log an actuator On/Off change, AppTask only
+ * RecordRollup: log a closed rollup, AppTask only
+ * Query: call back every valid record of a log time range, oldest first
+ * QueryRollups: same for the rollups of a resolution
+ * Flush: program the records still batched in RAM
+ * Benchmark: time the appends to scratch sectors reserved at the end of the
+ *            partition, never to the log, and a query of the last hour of
+ *            the log. Only built with CONFIG_APP_FLASH_LOG_BENCHMARK
+ * LogTime: current log time
+ * ToLogTime: log time of an uptime timestamp
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include "sensor_history.h"
+#include "sensor_rollups.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <lib/core/DataModelTypes.h>
+
+struct LogRecord {
+        /* Log time, seconds */
+        uint32_t Time;
+        /* HistoryChannel, or kActuatorSource + endpoint */
+        uint8_t Source;
+        /* Matter units for the channels, 0 or 1 for the actuators */
+        int16_t Value;
+        uint8_t Crc;
+} __attribute__((packed));
+
+static_assert(sizeof(LogRecord) == 8, "LogRecord must stay 8 bytes");
+
+struct RollupRecord {
+        /* Log time of the start of the period, seconds */
+        uint32_t Time;
+        /* HistoryChannel */
+        uint8_t Source;
+        int16_t Min;
+        int16_t Max;
+        int16_t Mean;
+        uint32_t Count;
+        uint8_t Crc;
+} __attribute__((packed));
+
+static_assert(sizeof(RollupRecord) == 16, "RollupRecord must stay 16 bytes");
+
+class FlashLog {
+public:
+        static constexpr uint8_t kActuatorSource = 0x80;
+        static constexpr uint8_t kBenchmarkSource = 0x7F;
+
+        using QueryCallback = bool (*)(const LogRecord &record, void *context);
+        using RollupCallback = bool (*)(const RollupRecord &record, void *context);
+
+        struct Stats {
+                uint32_t Sectors;
+                uint32_t UsedSectors;
+                uint32_t HeadSequence;
+                uint32_t MinEraseCount;
+                uint32_t MaxEraseCount;
+                uint32_t Appended;
+                uint32_t Dropped;
+                uint32_t CrcErrors;
+                /* Failed page programs and sector erases */
+                uint32_t WriteErrors;
+        };
+
+        struct BenchmarkResult {
+                uint32_t Records;
+                uint32_t AppendUs;
+                uint32_t QueryRecords;
+                uint32_t QueryUs;
+        };
+
+        static int Init();
+
+        static void RecordMeasurement(HistoryChannel channel, int64_t timestampMs, int16_t value);
+        static void RecordActuator(chip::EndpointId endpoint, bool on);
+        static void RecordRollup(RollupResolution resolution, const RollupRecord &record);
+
+        /* Stop early when the callback returns false */
+        static int Query(uint32_t fromTime, uint32_t toTime, QueryCallback callback, void *context);
+        static int QueryRollups(RollupResolution resolution, uint32_t fromTime, uint32_t toTime,
+                                RollupCallback callback, void *context);
+        static int Flush();
+
+        static uint32_t LogTime();
+        static uint32_t ToLogTime(int64_t uptimeMs);
+        static Stats GetStats();
+
+#ifdef CONFIG_APP_FLASH_LOG_BENCHMARK
+        /* Append records synchronously to the scratch sectors and time
+         * them, then time a query of the log */
+        static int Benchmark(uint32_t records, BenchmarkResult &result);
+#endif
+};
@@ -0,0 +1,293 @@
+#include "hot_lamp_thermostat.h"
+#include "actuators.h"
+#include "attribute_batcher.h"
+#include "hysteresis_thermostat.h"
+
+#include <app-common/zap-generated/cluster-enums.h>
+#include <app-common/zap-generated/ids/Attributes.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <app/AttributeAccessInterface.h>
+#include <app/data-model/Nullable.h>
+#include <app/reporting/reporting.h>
+#include <app/util/attribute-storage.h>
+#include <lib/support/CodeUtils.h>
+#include <lib/support/Span.h>
+#include <platform/CHIPDeviceLayer.h>
+
+#include <cstdlib>
+
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip;
+using namespace ::chip::app;
+using namespace ::chip::app::Clusters;
+using namespace ::chip::DeviceLayer;
+
+namespace
+{
+constexpr uint16_t kDynamicEndpointIndex = 1;
+constexpr DeviceTypeId kThermostatDeviceTypeId = 0x0301;
+constexpr uint8_t kThermostatDeviceTypeVersion = 2;
+constexpr uint16_t kThermostatClusterRevision = 5;
+constexpr uint16_t kListAttributeSize = 254;
+/* Manufacturer specific attribute (test vendor prefix 0xFFF1), so that the
+ * heat-only Thermostat cluster keeps to its conformant attributes */
+constexpr AttributeId kHysteresisAttributeId = 0xFFF10000;
+
+/* Accepted OccupiedHeatingSetpoint range, 0.01 C, reported as both the
+ * absolute and the configured heat setpoint limits */
+constexpr int16_t kMinSetpoint = 1500;
+constexpr int16_t kMaxSetpoint = 4500;
+/* Accepted hysteresis range, 0.01 C */
+constexpr uint16_t kMaxHysteresis = 250;
+
+constexpr char kSettingsSubtree[] = "thermostat/hot_lamp";
+constexpr char kSetpointKey[] = "thermostat/hot_lamp/setpoint";
+constexpr char kDeadbandKey[] = "thermostat/hot_lamp/deadband";
+constexpr char kSystemModeKey[] = "thermostat/hot_lamp/mode";
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(descriptorAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::DeviceTypeList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::ServerList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::ClientList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::PartsList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(thermostatAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::LocalTemperature::Id, INT16S, 2, ZAP_ATTRIBUTE_MASK(NULLABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::OccupiedHeatingSetpoint::Id, INT16S, 2,
+                                  ZAP_ATTRIBUTE_MASK(WRITABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::AbsMinHeatSetpointLimit::Id, INT16S, 2, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::AbsMaxHeatSetpointLimit::Id, INT16S, 2, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::MinHeatSetpointLimit::Id, INT16S, 2, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::MaxHeatSetpointLimit::Id, INT16S, 2, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::ControlSequenceOfOperation::Id, ENUM8, 1, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::SystemMode::Id, ENUM8, 1, ZAP_ATTRIBUTE_MASK(WRITABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::ThermostatRunningState::Id, BITMAP16, 2, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(kHysteresisAttributeId, INT16U, 2, ZAP_ATTRIBUTE_MASK(WRITABLE)),
+        DECLARE_DYNAMIC_ATTRIBUTE(Thermostat::Attributes::FeatureMap::Id, BITMAP32, 4, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(thermostatClusters)
+DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs, nullptr, nullptr),
+        DECLARE_DYNAMIC_CLUSTER(Thermostat::Id, thermostatAttrs, nullptr, nullptr) DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+DECLARE_DYNAMIC_ENDPOINT(thermostatEndpoint, thermostatClusters);
+
+DataVersion sDataVersions[ArraySize(thermostatClusters)];
+const EmberAfDeviceType sDeviceTypes[] = { { kThermostatDeviceTypeId, kThermostatDeviceTypeVersion } };
+
+/* The thermostat state is shared by the Matter thread (attribute reads and
+ * writes) and the app task (control loop), it is only accessed with the
+ * Matter stack locked */
+HysteresisThermostat sThermostat(CONFIG_APP_HOT_LAMP_SETPOINT, CONFIG_APP_HOT_LAMP_DEADBAND * 10);
+Thermostat::ThermostatSystemMode sSystemMode = Thermostat::ThermostatSystemMode::kHeat;
+DataModel::Nullable<int16_t> sLocalTemperature;
+
+bool Regulating()
+{
+        return sSystemMode == Thermostat::ThermostatSystemMode::kHeat;
+}
+
+void Report(AttributeId attribute)
+{
+        MatterReportingAttributeChangeCallback(HotLampThermostat::kEndpointId, Thermostat::Id, attribute);
+}
+
+void Persist(const char *key, const void *value, size_t length)
+{
+        const int ret = settings_save_one(key, value, length);
+        if (ret) {
+                LOG_ERR("settings_save_one(%s) failed: %d", key, ret);
+        }
+}
+
+int LoadSetting(const char *key, size_t length, settings_read_cb read_cb, void *cb_arg, void *)
+{
+        if (settings_name_steq(key, "setpoint", nullptr)) {
+                int16_t setpoint;
+                if (length == sizeof(setpoint) && read_cb(cb_arg, &setpoint, sizeof(setpoint)) == sizeof(setpoint)) {
+                        sThermostat.SetSetpoint(setpoint);
+                }
+        } else if (settings_name_steq(key, "deadband", nullptr)) {
+                int16_t deadband;
+                if (length == sizeof(deadband) && read_cb(cb_arg, &deadband, sizeof(deadband)) == sizeof(deadband)) {
+                        sThermostat.SetDeadband(deadband);
+                }
+        } else if (settings_name_steq(key, "mode", nullptr)) {
+                uint8_t mode;
+                if (length == sizeof(mode) && read_cb(cb_arg, &mode, sizeof(mode)) == sizeof(mode)) {
+                        sSystemMode = static_cast<Thermostat::ThermostatSystemMode>(mode);
+                }
+        }
+
+        return 0;
+}
+
+class ThermostatAttrAccess : public AttributeAccessInterface {
+public:
+        ThermostatAttrAccess()
+                : AttributeAccessInterface(Optional<EndpointId>(HotLampThermostat::kEndpointId), Thermostat::Id)
+        {
+        }
+
+        CHIP_ERROR Read(const ConcreteReadAttributePath &aPath, AttributeValueEncoder &aEncoder) override
+        {
+                switch (aPath.mAttributeId) {
+                case Thermostat::Attributes::LocalTemperature::Id:
+                        return aEncoder.Encode(sLocalTemperature);
+                case Thermostat::Attributes::OccupiedHeatingSetpoint::Id:
+                        return aEncoder.Encode(sThermostat.Setpoint());
+                case Thermostat::Attributes::AbsMinHeatSetpointLimit::Id:
+                case Thermostat::Attributes::MinHeatSetpointLimit::Id:
+                        return aEncoder.Encode(kMinSetpoint);
+                case Thermostat::Attributes::AbsMaxHeatSetpointLimit::Id:
+                case Thermostat::Attributes::MaxHeatSetpointLimit::Id:
+                        return aEncoder.Encode(kMaxSetpoint);
+                case Thermostat::Attributes::ControlSequenceOfOperation::Id:
+                        return aEncoder.Encode(Thermostat::ThermostatControlSequence::kHeatingOnly);
+                case Thermostat::Attributes::SystemMode::Id:
+                        return aEncoder.Encode(sSystemMode);
+                case Thermostat::Attributes::ThermostatRunningState::Id:
+                        return aEncoder.Encode(static_cast<uint16_t>(
+                                Regulating() && sThermostat.Heating() ?
+                                        to_underlying(Thermostat::ThermostatRunningState::kHeatStateOn) :
+                                        0));
+                case kHysteresisAttributeId:
+                        return aEncoder.Encode(static_cast<uint16_t>(sThermostat.Deadband()));
+                case Thermostat::Attributes::FeatureMap::Id:
+                        return aEncoder.Encode(static_cast<uint32_t>(Thermostat::ThermostatFeature::kHeating));
+                case Thermostat::Attributes::ClusterRevision::Id:
+                        return aEncoder.Encode(kThermostatClusterRevision);
+                default:
+                        return CHIP_NO_ERROR;
+                }
+        }
+
+        CHIP_ERROR Write(const ConcreteDataAttributePath &aPath, AttributeValueDecoder &aDecoder) override
+        {
+                switch (aPath.mAttributeId) {
+                case Thermostat::Attributes::OccupiedHeatingSetpoint::Id: {
+                        int16_t setpoint;
+                        ReturnErrorOnFailure(aDecoder.Decode(setpoint));
+                        VerifyOrReturnError(setpoint >= kMinSetpoint && setpoint <= kMaxSetpoint,
+                                            CHIP_IM_GLOBAL_STATUS(ConstraintError));
+                        sThermostat.SetSetpoint(setpoint);
+                        Persist(kSetpointKey, &setpoint, sizeof(setpoint));
+                        break;
+                }
+                case kHysteresisAttributeId: {
+                        uint16_t hysteresis;
+                        ReturnErrorOnFailure(aDecoder.Decode(hysteresis));
+                        VerifyOrReturnError(hysteresis <= kMaxHysteresis, CHIP_IM_GLOBAL_STATUS(ConstraintError));
+                        sThermostat.SetDeadband(static_cast<int16_t>(hysteresis));
+                        const int16_t stored = sThermostat.Deadband();
+                        Persist(kDeadbandKey, &stored, sizeof(stored));
+                        break;
+                }
+                case Thermostat::Attributes::SystemMode::Id: {
+                        Thermostat::ThermostatSystemMode mode;
+                        ReturnErrorOnFailure(aDecoder.Decode(mode));
+                        VerifyOrReturnError(mode == Thermostat::ThermostatSystemMode::kOff ||
+                                                    mode == Thermostat::ThermostatSystemMode::kHeat,
+                                            CHIP_IM_GLOBAL_STATUS(ConstraintError));
+                        sSystemMode = mode;
+                        Report(Thermostat::Attributes::ThermostatRunningState::Id);
+                        const uint8_t stored = to_underlying(mode);
+                        Persist(kSystemModeKey, &stored, sizeof(stored));
+                        break;
+                }
+                default:
+                        return CHIP_IM_GLOBAL_STATUS(UnsupportedWrite);
+                }
+
+                /* The new configuration is applied by the next Hot-Spot sample */
+                Report(aPath.mAttributeId);
+                return CHIP_NO_ERROR;
+        }
+};
+
+ThermostatAttrAccess sThermostatAttrAccess;
+} /* namespace */
+
+CHIP_ERROR HotLampThermostat::Init()
+{
+        const int ret = settings_load_subtree_direct(kSettingsSubtree, LoadSetting, nullptr);
+        if (ret) {
+                LOG_ERR("settings_load_subtree_direct(%s) failed: %d", kSettingsSubtree, ret);
+        }
+
+        registerAttributeAccessOverride(&sThermostatAttrAccess);
+
+        EmberAfStatus status = emberAfSetDynamicEndpoint(kDynamicEndpointIndex, kEndpointId, &thermostatEndpoint,
+                                                         Span<DataVersion>(sDataVersions),
+                                                         Span<const EmberAfDeviceType>(sDeviceTypes));
+        if (status != EMBER_ZCL_STATUS_SUCCESS) {
+                LOG_ERR("emberAfSetDynamicEndpoint() failed: %d", status);
+                return CHIP_ERROR_INTERNAL;
+        }
+
+        return CHIP_NO_ERROR;
+}
+
+/* In Heat mode the thermostat owns the lamp: its decision is re-applied on
+ * every sample, overriding any On/Off command received in between, and the
+ * EP2 On/Off attribute is kept in sync for the controllers */
+void HotLampThermostat::Update(int16_t temperature)
+{
+        const ActuatorDescriptor *lamp = Actuators::Find(kHotLampEndpointId);
+
+        PlatformMgr().LockChipStack();
+
+        if (sLocalTemperature.IsNull() || sLocalTemperature.Value() != temperature) {
+                sLocalTemperature.SetNonNull(temperature);
+                Report(Thermostat::Attributes::LocalTemperature::Id);
+        }
+
+        if (Regulating() && lamp) {
+                const bool wasHeating = sThermostat.Heating();
+                const bool heating = sThermostat.Update(temperature);
+
+                if (heating != wasHeating) {
+                        LOG_INF("Hot lamp thermostat: %d.%02d C, lamp %s", temperature / 100, abs(temperature % 100),
+                                heating ? "On" : "Off");
+                        Report(Thermostat::Attributes::ThermostatRunningState::Id);
+                }
+
+                /* The lamp stays Off while an interlock forces it, see interlocks.h */
+                Actuators::Apply(*lamp, heating);
+                AttributeBatcher::SetOnOff(kHotLampEndpointId, Actuators::IsOn(*lamp));
+        }
+
+        PlatformMgr().UnlockChipStack();
+}
+
+/* Never keep the lamp On without a temperature, the controller On/Off
+ * commands still apply in Off mode */
+void HotLampThermostat::SensorLost()
+{
+        const ActuatorDescriptor *lamp = Actuators::Find(kHotLampEndpointId);
+
+        PlatformMgr().LockChipStack();
+
+        if (!sLocalTemperature.IsNull()) {
+                sLocalTemperature.SetNull();
+                Report(Thermostat::Attributes::LocalTemperature::Id);
+        }
+
+        if (Regulating() && lamp) {
+                if (sThermostat.Heating()) {
+                        LOG_WRN("Hot lamp thermostat: no temperature, lamp Off");
+                        sThermostat.Reset();
+                        Report(Thermostat::Attributes::ThermostatRunningState::Id);
+                }
+
+                Actuators::Apply(*lamp, false);
+                AttributeBatcher::SetOnOff(kHotLampEndpointId, Actuators::IsOn(*lamp));
+        }
+
+        PlatformMgr().UnlockChipStack();
+}
@@ -0,0 +1,53 @@
+/* ****************************************************************************
+ *
+ *  HOT LAMP THERMOSTAT - hot_lamp_thermostat.cpp
+ *
+ * On-device hysteresis control of the hot lamp (relay 1, EP2) from the
+ * DHT22 Hot-Spot temperature, so that the basking spot keeps being
+ * regulated without a controller round-trip, or without the network at all.
+ *
+ * The fixed endpoints come from the ZAP file, so the standard Thermostat
+ * cluster (heating only) is served on a dynamic endpoint of its own:
+ *
+ *   0x0000 LocalTemperature: last Hot-Spot temperature, null until the
+ *                            first successful sample and while the
+ *                            DHT22 is failed
+ *   0x0003 AbsMinHeatSetpointLimit, 0x0015 MinHeatSetpointLimit: 15.00 C
+ *   0x0004 AbsMaxHeatSetpointLimit, 0x0016 MaxHeatSetpointLimit: 45.00 C
+ *   0x0012 OccupiedHeatingSetpoint: setpoint, 0.01 C, writable within
+ *                                   the heat setpoint limits
+ *   0x001B ControlSequenceOfOperation: always HeatingOnly
+ *   0x001C SystemMode: Heat to regulate the lamp locally, Off to leave it
+ *                      to the controller On/Off commands, writable
+ *   0x0029 ThermostatRunningState: Heat bit set while the lamp is On
+ *   0xFFF10000 Hysteresis: manufacturer specific, width of the band
+ *                          centered on the setpoint, 0.01 C, 0 to 250,
+ *                          writable
+ *
+ * The writable attributes are persisted in the settings subsystem.
+ *
+ * Init: load the persisted configuration and register the endpoint
+ * Update: run the control loop on a new Hot-Spot temperature, 0.01 C,
+ *         called by the AppTask for every successful DHT22 sample
+ * SensorLost: null LocalTemperature and, in Heat mode, switch the lamp Off
+ *             until the next successful sample, called by the AppTask when
+ *             the DHT22 is failed
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include <lib/core/CHIPError.h>
+#include <lib/core/DataModelTypes.h>
+
+class HotLampThermostat {
+public:
+        static constexpr chip::EndpointId kEndpointId = 13;
+        static constexpr chip::EndpointId kHotLampEndpointId = 2;
+
+        static CHIP_ERROR Init();
+        static void Update(int16_t temperature);
+        static void SensorLost();
+};
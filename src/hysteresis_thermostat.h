@@ -0,0 +1,47 @@
+/* ****************************************************************************
+ *
+ *  HYSTERESIS THERMOSTAT - hysteresis_thermostat.h
+ *
+ * On/Off heating control around a setpoint: the heater is switched On when
+ * the temperature falls below setpoint - deadband / 2 and Off when it rises
+ * above setpoint + deadband / 2, in between it keeps its previous state.
+ * All temperatures are in 0.01 degrees Celsius, like the Matter attributes.
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+class HysteresisThermostat {
+public:
+        HysteresisThermostat(int16_t setpoint, int16_t deadband) : mSetpoint(setpoint), mDeadband(deadband) {}
+
+        /* Return the new heater state for the measured temperature */
+        bool Update(int16_t temperature)
+        {
+                const int32_t half = mDeadband / 2;
+
+                if (temperature <= int32_t(mSetpoint) - half) {
+                        mHeating = true;
+                } else if (temperature >= int32_t(mSetpoint) + half) {
+                        mHeating = false;
+                }
+                return mHeating;
+        }
+
+        bool Heating() const { return mHeating; }
+        int16_t Setpoint() const { return mSetpoint; }
+        int16_t Deadband() const { return mDeadband; }
+
+        void SetSetpoint(int16_t setpoint) { mSetpoint = setpoint; }
+        void SetDeadband(int16_t deadband) { mDeadband = deadband < 0 ? 0 : deadband; }
+
+        /* Heater Off, until the next temperature below the deadband */
+        void Reset() { mHeating = false; }
+
+private:
+        int16_t mSetpoint;
+        int16_t mDeadband;
+        bool mHeating = false;
+};
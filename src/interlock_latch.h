@@ -0,0 +1,92 @@
+/* ****************************************************************************
+ *
+ *  INTERLOCK LATCH - interlock_latch.h
+ *
+ * Latched alarm of one safety interlock rule (see interlocks.h), fed with
+ * the outcome of every acquisition of the sensor of its channel:
+ *
+ *   Above: the reading reached the limit, or more
+ *   Below: the reading reached the limit, or less
+ *   StaleFor: no successful acquisition for limit ms, or more
+ *
+ * The rule trips after confirmations observations in a row beyond the
+ * limit, so that a single spike does not cut an actuator. A failed
+ * acquisition neither confirms nor clears an Above or Below condition, it
+ * is the StaleFor rules business. Once tripped the latch stays set until
+ * it is acknowledged, and it can only be acknowledged once the condition
+ * is gone.
+ *
+ * Update: feed an observation, true when it trips the latch
+ * Acknowledge: clear the latch, false while the condition is still present
+ * Latched: the alarm is latched
+ * Violating: the last observation was beyond the limit
+ * Trips: number of times the latch tripped
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class InterlockCondition : uint8_t { Above = 0, Below, StaleFor };
+
+struct InterlockObservation {
+        /* Set when the acquisition succeeded and Value holds its reading */
+        bool Valid;
+        /* Matter units of the channel */
+        int32_t Value;
+        /* Time since the last successful acquisition, 0 for a valid one */
+        uint32_t StaleMs;
+};
+
+class InterlockLatch {
+public:
+        constexpr bool Update(InterlockCondition condition, int32_t limit, uint8_t confirmations,
+                              const InterlockObservation &observation)
+        {
+                if (condition == InterlockCondition::StaleFor) {
+                        mViolating = observation.StaleMs >= static_cast<uint32_t>(limit);
+                } else if (observation.Valid) {
+                        mViolating = condition == InterlockCondition::Above ? observation.Value >= limit :
+                                                                              observation.Value <= limit;
+                } else {
+                        return false;
+                }
+
+                if (!mViolating) {
+                        mConfirmations = 0;
+                        return false;
+                }
+                if (mConfirmations < confirmations) {
+                        mConfirmations++;
+                }
+                if (mLatched || mConfirmations < confirmations) {
+                        return false;
+                }
+
+                mLatched = true;
+                mTrips++;
+                return true;
+        }
+
+        constexpr bool Acknowledge()
+        {
+                if (mViolating) {
+                        return false;
+                }
+                mLatched = false;
+                mConfirmations = 0;
+                return true;
+        }
+
+        constexpr bool Latched() const { return mLatched; }
+        constexpr bool Violating() const { return mViolating; }
+        constexpr uint32_t Trips() const { return mTrips; }
+
+private:
+        bool mLatched = false;
+        bool mViolating = false;
+        uint8_t mConfirmations = 0;
+        uint32_t mTrips = 0;
+};
@@ -0,0 +1,193 @@
+#include "interlocks.h"
+#include "actuators.h"
+#include "matter_units.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip;
+
+namespace
+{
+constexpr EndpointId kHotLampEndpointId = 2;
+constexpr EndpointId kWaterHeaterEndpointId = 4;
+constexpr int32_t kStaleMs = static_cast<int32_t>(CONFIG_APP_INTERLOCK_STALE_S) * 1000;
+
+constexpr InterlockRule kRules[] = {
+        { "water overheat", HistoryChannel::WaterTemperature, InterlockCondition::Above,
+          CONFIG_APP_INTERLOCK_WATER_MAX_TEMPERATURE, CONFIG_APP_INTERLOCK_CONFIRMATIONS, kWaterHeaterEndpointId },
+        { "water sensor lost", HistoryChannel::WaterTemperature, InterlockCondition::StaleFor, kStaleMs, 1,
+          kWaterHeaterEndpointId },
+        { "hot spot overheat", HistoryChannel::HotSpotTemperature, InterlockCondition::Above,
+          CONFIG_APP_INTERLOCK_HOT_SPOT_MAX_TEMPERATURE, CONFIG_APP_INTERLOCK_CONFIRMATIONS, kHotLampEndpointId },
+        { "hot spot sensor lost", HistoryChannel::HotSpotTemperature, InterlockCondition::StaleFor, kStaleMs, 1,
+          kHotLampEndpointId },
+};
+
+static_assert(CONFIG_APP_INTERLOCK_WATER_MAX_TEMPERATURE > CONFIG_APP_WATER_HEATER_SETPOINT,
+              "the water overheat limit must be above the water heater setpoint");
+static_assert(CONFIG_APP_INTERLOCK_HOT_SPOT_MAX_TEMPERATURE > CONFIG_APP_HOT_LAMP_SETPOINT,
+              "the hot spot overheat limit must be above the hot lamp setpoint");
+
+/* Observation offset beyond the limit of a rule, short of it if negative */
+constexpr InterlockObservation Beyond(const InterlockRule &rule, int32_t offset)
+{
+        switch (rule.Condition) {
+        case InterlockCondition::Above:
+                return { true, rule.Limit + offset, 0 };
+        case InterlockCondition::Below:
+                return { true, rule.Limit - offset, 0 };
+        default:
+                return { false, 0, static_cast<uint32_t>(rule.Limit + offset) };
+        }
+}
+
+/* A rule stays quiet short of its limit, trips after exactly Confirmations
+ * observations at its limit, and is only acknowledged once back short of it */
+constexpr bool Checks(const InterlockRule &rule)
+{
+        InterlockLatch latch;
+
+        if (rule.Confirmations == 0 || (rule.Condition == InterlockCondition::StaleFor && rule.Limit <= 0)) {
+                return false;
+        }
+        for (uint32_t i = 0; i < 2u * rule.Confirmations; i++) {
+                if (latch.Update(rule.Condition, rule.Limit, rule.Confirmations, Beyond(rule, -1))) {
+                        return false;
+                }
+        }
+        for (uint32_t i = 1; i < rule.Confirmations; i++) {
+                if (latch.Update(rule.Condition, rule.Limit, rule.Confirmations, Beyond(rule, 0))) {
+                        return false;
+                }
+        }
+        if (!latch.Update(rule.Condition, rule.Limit, rule.Confirmations, Beyond(rule, 0)) || latch.Acknowledge()) {
+                return false;
+        }
+        latch.Update(rule.Condition, rule.Limit, rule.Confirmations, Beyond(rule, -1));
+        return latch.Latched() && latch.Acknowledge() && !latch.Latched();
+}
+
+constexpr bool ChecksFrom(size_t index)
+{
+        return index == ARRAY_SIZE(kRules) || (Checks(kRules[index]) && ChecksFrom(index + 1));
+}
+static_assert(ChecksFrom(0), "every interlock rule must trip at its limit and latch");
+
+constexpr SensorId SensorOf(HistoryChannel channel)
+{
+        return channel == HistoryChannel::HotSpotTemperature || channel == HistoryChannel::HotSpotHumidity ?
+                       SensorId::HotSpot :
+                       (channel == HistoryChannel::WaterTemperature ? SensorId::WaterTemp : SensorId::ColdZone);
+}
+
+int32_t ValueOf(HistoryChannel channel, const SensorSample &sample)
+{
+        if (channel == HistoryChannel::HotSpotHumidity || channel == HistoryChannel::ColdZoneHumidity) {
+                return MatterUnits::ToMatterHumidity(sample.Humidity);
+        }
+        return MatterUnits::ToMatterTemperature(sample.Temperature);
+}
+
+/* Held while the latches are updated and their actuators forced or
+ * released, so that an acknowledge cannot release an actuator that another
+ * rule is forcing */
+K_MUTEX_DEFINE(sLock);
+InterlockLatch sLatches[ARRAY_SIZE(kRules)];
+} /* namespace */
+
+int Interlocks::Init()
+{
+        for (const InterlockRule &rule : kRules) {
+                if (!Actuators::Find(rule.Actuator)) {
+                        LOG_ERR("Interlock %s: no actuator on endpoint %u", rule.Name, rule.Actuator);
+                        return -EINVAL;
+                }
+                LOG_INF("Interlock %s: reaction within %u ms", rule.Name, WorstCaseReactionMs(rule));
+        }
+
+        return 0;
+}
+
+/* Only the first DS18B20 probe is the water temperature */
+void Interlocks::Evaluate(const SensorSample &sample, int64_t freshSinceMs)
+{
+        if (sample.Probe != 0) {
+                return;
+        }
+
+        InterlockObservation observation = {};
+        observation.Valid = sample.Result == 0;
+        observation.StaleMs = static_cast<uint32_t>(MIN(MAX(sample.Timestamp - freshSinceMs, 0), INT32_MAX));
+
+        k_mutex_lock(&sLock, K_FOREVER);
+        for (size_t i = 0; i < ARRAY_SIZE(kRules); i++) {
+                const InterlockRule &rule = kRules[i];
+
+                if (SensorOf(rule.Channel) != sample.Sensor) {
+                        continue;
+                }
+
+                observation.Value = observation.Valid ? ValueOf(rule.Channel, sample) : 0;
+                if (sLatches[i].Update(rule.Condition, rule.Limit, rule.Confirmations, observation)) {
+                        const ActuatorDescriptor *actuator = Actuators::Find(rule.Actuator);
+
+                        LOG_ERR("Interlock %s tripped, %s forced Off", rule.Name, actuator ? actuator->Name : "-");
+                        if (actuator) {
+                                Actuators::ForceOff(*actuator);
+                        }
+                }
+        }
+        k_mutex_unlock(&sLock);
+}
+
+size_t Interlocks::RuleCount()
+{
+        return ARRAY_SIZE(kRules);
+}
+
+bool Interlocks::GetStatus(size_t rule, Status &status)
+{
+        if (rule >= ARRAY_SIZE(kRules)) {
+                return false;
+        }
+
+        k_mutex_lock(&sLock, K_FOREVER);
+        status.Rule = &kRules[rule];
+        status.Latched = sLatches[rule].Latched();
+        status.Violating = sLatches[rule].Violating();
+        status.Trips = sLatches[rule].Trips();
+        k_mutex_unlock(&sLock);
+
+        return true;
+}
+
+int Interlocks::Acknowledge(size_t rule)
+{
+        if (rule >= ARRAY_SIZE(kRules)) {
+                return -EINVAL;
+        }
+
+        k_mutex_lock(&sLock, K_FOREVER);
+        if (!sLatches[rule].Acknowledge()) {
+                k_mutex_unlock(&sLock);
+                return -EBUSY;
+        }
+
+        /* The actuator stays forced while another of its rules is latched */
+        bool forced = false;
+        for (size_t i = 0; i < ARRAY_SIZE(kRules); i++) {
+                forced |= kRules[i].Actuator == kRules[rule].Actuator && sLatches[i].Latched();
+        }
+
+        const ActuatorDescriptor *actuator = Actuators::Find(kRules[rule].Actuator);
+        if (!forced && actuator && Actuators::IsForcedOff(*actuator)) {
+                LOG_INF("Interlock %s acknowledged, %s released", kRules[rule].Name, actuator->Name);
+                Actuators::Release(*actuator);
+        }
+        k_mutex_unlock(&sLock);
+
+        return 0;
+}
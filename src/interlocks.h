@@ -0,0 +1,97 @@
+/* ****************************************************************************
+ *
+ *  SAFETY INTERLOCKS - interlocks.cpp
+ *
+ * Declarative table of safety rules, each one a condition on a sensor
+ * channel or on its staleness (see interlock_latch.h) that forces an
+ * actuator Off and latches an alarm:
+ *
+ *   water overheat: water temperature at
+ *                   CONFIG_APP_INTERLOCK_WATER_MAX_TEMPERATURE or more, the
+ *                   water heater (EP4) is cut
+ *   water sensor lost: no water temperature for CONFIG_APP_INTERLOCK_STALE_S
+ *   hot spot overheat: Hot-Spot temperature at
+ *                      CONFIG_APP_INTERLOCK_HOT_SPOT_MAX_TEMPERATURE or
+ *                      more, the hot lamp (EP2) is cut
+ *   hot spot sensor lost: no Hot-Spot temperature for
+ *                         CONFIG_APP_INTERLOCK_STALE_S
+ *
+ * The temperature rules are confirmed by CONFIG_APP_INTERLOCK_CONFIRMATIONS
+ * readings in a row. Every rule of the table is checked at compile time in
+ * interlocks.cpp.
+ *
+ * The rules are evaluated by the sensor thread right after every
+ * acquisition, before the sample is handed to the AppTask, and a tripped
+ * rule switches its actuator Off through Actuators::ForceOff, so neither
+ * the AppTask event queue nor the Matter thread is on the way. The
+ * actuator stays Off, whatever the On/Off commands, the thermostat or the
+ * water heater PID, until the alarm is acknowledged.
+ *
+ * Worst-case reaction time, from the condition appearing to the relay
+ * opening (WorstCaseReactionMs): a stable sensor is sampled at least every
+ * CONFIG_APP_SENSOR_MAX_INTERVAL_MS, a failing one is retried at least as
+ * often, so a rule confirmed N times trips within N intervals, plus the
+ * limit itself for a StaleFor rule, plus kMaxAcquisitionMs for the
+ * acquisition cycle that reads it. The evaluation itself is a scan of the
+ * table and the relay is switched by one port write.
+ *
+ * Init: check that every rule drives an existing actuator
+ * Evaluate: feed a sample to the rules of its channels, from the sensor
+ *           thread, freshSinceMs being the time of the last successful
+ *           acquisition of the sensor, or of the start if none
+ * RuleCount/GetStatus: describe the rules and their alarms
+ * Acknowledge: clear a latched alarm and release its actuator, -EBUSY
+ *              while the condition is still present
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include "interlock_latch.h"
+#include "sensor_history.h"
+#include "sensor_task.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <lib/core/DataModelTypes.h>
+
+struct InterlockRule {
+        const char *Name;
+        HistoryChannel Channel;
+        InterlockCondition Condition;
+        /* Matter units of the channel, or ms for StaleFor */
+        int32_t Limit;
+        /* Observations in a row beyond the limit before tripping */
+        uint8_t Confirmations;
+        /* Actuator forced Off while the alarm is latched */
+        chip::EndpointId Actuator;
+};
+
+class Interlocks {
+public:
+        /* Longest acquisition cycle: a DS18B20 conversion (750 ms at 12
+         * bit) overlapped with the DHT transactions and their waits for an
+         * idle Matter thread, with some margin */
+        static constexpr uint32_t kMaxAcquisitionMs = 1000 + 2 * CONFIG_APP_SENSOR_MATTER_IDLE_WAIT_MS;
+
+        struct Status {
+                const InterlockRule *Rule;
+                bool Latched;
+                bool Violating;
+                uint32_t Trips;
+        };
+
+        static constexpr uint32_t WorstCaseReactionMs(const InterlockRule &rule)
+        {
+                return (rule.Condition == InterlockCondition::StaleFor ? static_cast<uint32_t>(rule.Limit) : 0) +
+                       rule.Confirmations * static_cast<uint32_t>(CONFIG_APP_SENSOR_MAX_INTERVAL_MS) +
+                       kMaxAcquisitionMs;
+        }
+
+        static int Init();
+        static void Evaluate(const SensorSample &sample, int64_t freshSinceMs);
+        static size_t RuleCount();
+        static bool GetStatus(size_t rule, Status &status);
+        static int Acknowledge(size_t rule);
+};
@@ -0,0 +1,87 @@
+/* ****************************************************************************
+ *
+ *  MATTER UNITS - matter_units.h
+ *
+ * Integer conversions from the Zephyr sensor_value (integer part in val1,
+ * millionths in val2, both with the sign of the value) to the Matter
+ * measurement units, rounded to the nearest unit, half away from zero, and
+ * saturated to the attribute valid range instead of wrapping around.
+ *
+ * ToMatterTemperature: 0.01 C, TemperatureMeasurement and Thermostat
+ * ToMatterHumidity: 0.01 %RH, RelativeHumidityMeasurement
+ * FromHundredths: back to a sensor_value, exact for any value in Matter units
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include <zephyr/drivers/sensor.h>
+
+namespace MatterUnits
+{
+/* Absolute zero, the lowest valid MeasuredValue */
+constexpr int16_t kMinTemperature = -27315;
+constexpr int16_t kMaxTemperature = INT16_MAX;
+constexpr uint16_t kMinHumidity = 0;
+constexpr uint16_t kMaxHumidity = 10000;
+
+constexpr int64_t ToHundredths(const struct sensor_value &value)
+{
+        const int64_t micro = static_cast<int64_t>(value.val1) * 1000000 + value.val2;
+        return micro >= 0 ? (micro + 5000) / 10000 : (micro - 5000) / 10000;
+}
+
+constexpr int16_t ToMatterTemperature(const struct sensor_value &value)
+{
+        const int64_t hundredths = ToHundredths(value);
+        return hundredths < kMinTemperature ? kMinTemperature :
+                                              (hundredths > kMaxTemperature ? kMaxTemperature :
+                                                                              static_cast<int16_t>(hundredths));
+}
+
+constexpr struct sensor_value FromHundredths(int32_t hundredths)
+{
+        return { hundredths / 100, (hundredths % 100) * 10000 };
+}
+
+constexpr uint16_t ToMatterHumidity(const struct sensor_value &value)
+{
+        const int64_t hundredths = ToHundredths(value);
+        return hundredths < kMinHumidity ? kMinHumidity :
+                                           (hundredths > kMaxHumidity ? kMaxHumidity :
+                                                                        static_cast<uint16_t>(hundredths));
+}
+
+static_assert(ToMatterTemperature({ 23, 456000 }) == 2346, "rounds to the nearest hundredth");
+static_assert(ToMatterTemperature({ -10, -5000 }) == -1001, "rounds half away from zero");
+static_assert(ToMatterTemperature({ 0, -4999 }) == 0, "rounds small negatives to zero");
+static_assert(ToMatterTemperature({ 400, 0 }) == kMaxTemperature, "saturates high");
+static_assert(ToMatterTemperature({ -300, 0 }) == kMinTemperature, "saturates at absolute zero");
+static_assert(ToMatterHumidity({ 55, 994999 }) == 5599, "rounds to the nearest hundredth");
+static_assert(ToMatterHumidity({ 100, 500000 }) == kMaxHumidity, "saturates at 100 %RH");
+static_assert(ToMatterHumidity({ -1, 0 }) == kMinHumidity, "saturates at 0 %RH");
+static_assert(ToMatterTemperature({ 0, 4999 }) == 0 && ToMatterTemperature({ 0, 5000 }) == 1,
+              "the half hundredth is the rounding boundary");
+static_assert(ToMatterTemperature({ 0, -5000 }) == -1, "a negative half hundredth rounds down");
+static_assert(ToMatterTemperature({ 21, 994999 }) == 2199 && ToMatterTemperature({ 21, 995000 }) == 2200,
+              "rounding carries into the integer part");
+static_assert(ToMatterTemperature({ -1, -994999 }) == -199 && ToMatterTemperature({ -1, -995000 }) == -200,
+              "rounding carries into a negative integer part");
+static_assert(ToMatterTemperature({ -5, -250000 }) == -525, "combines negative integer and fraction parts");
+static_assert(ToMatterTemperature({ -273, -154999 }) == kMinTemperature &&
+                      ToMatterTemperature({ -273, -155000 }) == kMinTemperature,
+              "absolute zero is kept, not wrapped, at the rounding boundary");
+static_assert(ToMatterTemperature({ 327, 674999 }) == kMaxTemperature &&
+                      ToMatterTemperature({ 327, 675000 }) == kMaxTemperature,
+              "INT16_MAX is kept, not wrapped, at the rounding boundary");
+static_assert(ToMatterHumidity({ 99, 995000 }) == kMaxHumidity && ToMatterHumidity({ 100, 5000 }) == kMaxHumidity,
+              "rounds up to 100 %RH and saturates just above");
+static_assert(ToMatterHumidity({ 0, -4999 }) == 0 && ToMatterHumidity({ 0, -5000 }) == kMinHumidity,
+              "a small negative humidity reads 0 %RH");
+static_assert(ToMatterTemperature(FromHundredths(-1001)) == -1001, "round-trips negative values");
+static_assert(ToMatterTemperature(FromHundredths(-1)) == -1 && ToMatterTemperature(FromHundredths(-27315)) == -27315,
+              "round-trips negative values below one degree and at absolute zero");
+static_assert(ToMatterHumidity(FromHundredths(5599)) == 5599, "round-trips positive values");
+} /* namespace MatterUnits */
@@ -0,0 +1,111 @@
+#include "measurement_publisher.h"
+#include "attribute_batcher.h"
+#include "publish_filter.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+using namespace ::chip;
+
+namespace
+{
+/* Filters are only used by the app task, the counters are read by the
+ * Matter thread and the shell */
+PublishFilter sFilters[MeasurementPublisher::kEndpointCount] = {
+        { CONFIG_APP_PUBLISH_TEMPERATURE_DELTA, CONFIG_APP_PUBLISH_MAX_SILENCE_MS }, /* EP7 Hot-Spot temperature */
+        { CONFIG_APP_PUBLISH_HUMIDITY_DELTA, CONFIG_APP_PUBLISH_MAX_SILENCE_MS }, /* EP8 Hot-Spot humidity */
+        { CONFIG_APP_PUBLISH_TEMPERATURE_DELTA, CONFIG_APP_PUBLISH_MAX_SILENCE_MS }, /* EP9 Cold-Zone temperature */
+        { CONFIG_APP_PUBLISH_HUMIDITY_DELTA, CONFIG_APP_PUBLISH_MAX_SILENCE_MS }, /* EP10 Cold-Zone humidity */
+        { CONFIG_APP_PUBLISH_TEMPERATURE_DELTA, CONFIG_APP_PUBLISH_MAX_SILENCE_MS }, /* EP11 Water temperature */
+};
+
+/* Set while the endpoint publishes null, app task only */
+bool sNull[MeasurementPublisher::kEndpointCount];
+
+atomic_t sPublished[MeasurementPublisher::kEndpointCount];
+atomic_t sSuppressed[MeasurementPublisher::kEndpointCount];
+
+bool EndpointIndex(EndpointId endpoint, size_t &index)
+{
+        index = static_cast<size_t>(endpoint - MeasurementPublisher::kFirstEndpoint);
+        return endpoint >= MeasurementPublisher::kFirstEndpoint && index < MeasurementPublisher::kEndpointCount;
+}
+
+/* Run the endpoint filter and count its decision */
+bool Accept(EndpointId endpoint, int32_t value)
+{
+        size_t index;
+
+        if (!EndpointIndex(endpoint, index)) {
+                return true;
+        }
+
+        if (!sFilters[index].Accept(value, k_uptime_get())) {
+                atomic_inc(&sSuppressed[index]);
+                return false;
+        }
+
+        sNull[index] = false;
+        atomic_inc(&sPublished[index]);
+        return true;
+}
+} /* namespace */
+
+void MeasurementPublisher::PublishTemperature(EndpointId endpoint, int16_t value)
+{
+        if (Accept(endpoint, value)) {
+                AttributeBatcher::SetTemperature(endpoint, value);
+        }
+}
+
+void MeasurementPublisher::PublishHumidity(EndpointId endpoint, uint16_t value)
+{
+        if (Accept(endpoint, value)) {
+                AttributeBatcher::SetHumidity(endpoint, value);
+        }
+}
+
+void MeasurementPublisher::PublishNull(EndpointId endpoint)
+{
+        size_t index;
+
+        if (!EndpointIndex(endpoint, index)) {
+                return;
+        }
+
+        if (sNull[index]) {
+                atomic_inc(&sSuppressed[index]);
+                return;
+        }
+
+        sNull[index] = true;
+        sFilters[index].Reset();
+        atomic_inc(&sPublished[index]);
+
+        /* The odd endpoints carry the temperatures */
+        if ((endpoint - kFirstEndpoint) % 2 == 0) {
+                AttributeBatcher::SetTemperatureNull(endpoint);
+        } else {
+                AttributeBatcher::SetHumidityNull(endpoint);
+        }
+}
+
+MeasurementPublisher::Counters MeasurementPublisher::GetCounters(EndpointId endpoint)
+{
+        size_t index;
+
+        if (!EndpointIndex(endpoint, index)) {
+                return {};
+        }
+
+        return { static_cast<uint32_t>(atomic_get(&sPublished[index])),
+                 static_cast<uint32_t>(atomic_get(&sSuppressed[index])) };
+}
+
+void MeasurementPublisher::ResetCounters()
+{
+        for (size_t i = 0; i < kEndpointCount; i++) {
+                atomic_clear(&sPublished[i]);
+                atomic_clear(&sSuppressed[i]);
+        }
+}
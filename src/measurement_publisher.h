@@ -0,0 +1,44 @@
+/* ****************************************************************************
+ *
+ *  MEASUREMENT PUBLISHER - measurement_publisher.cpp
+ *
+ * Every MeasuredValue Set bumps the cluster data version and may trigger
+ * subscription reports, even when the value did not change. The sensor
+ * measurements are published through a PublishFilter per endpoint (EP7 to
+ * EP11) instead, with the CONFIG_APP_PUBLISH_* delta and max-silence
+ * interval, and the published and suppressed updates are counted. The
+ * accepted values are written through the AttributeBatcher.
+ *
+ * PublishTemperature: filter and Set a TemperatureMeasurement, 0.01 C
+ * PublishHumidity: filter and Set a RelativeHumidityMeasurement, 0.01 %RH
+ * PublishNull: set the MeasuredValue of a failed sensor to null, once, the
+ *              next value is then published whatever the delta
+ * GetCounters: published and suppressed updates of an endpoint
+ * ResetCounters: clear the counters of all the endpoints
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <lib/core/DataModelTypes.h>
+
+class MeasurementPublisher {
+public:
+        static constexpr chip::EndpointId kFirstEndpoint = 7;
+        static constexpr size_t kEndpointCount = 5;
+
+        struct Counters {
+                uint32_t Published;
+                uint32_t Suppressed;
+        };
+
+        static void PublishTemperature(chip::EndpointId endpoint, int16_t value);
+        static void PublishHumidity(chip::EndpointId endpoint, uint16_t value);
+        static void PublishNull(chip::EndpointId endpoint);
+
+        static Counters GetCounters(chip::EndpointId endpoint);
+        static void ResetCounters();
+};
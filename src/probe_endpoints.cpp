@@ -0,0 +1,69 @@
+#include "probe_endpoints.h"
+#include "ds18b20_bus.h"
+#include "dynamic_endpoints.h"
+#include "sensor_task.h"
+
+#include <lib/support/ErrorStr.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip;
+
+namespace
+{
+/* DS18B20 measurement range, 0.01 C */
+constexpr int16_t kMinMeasuredValue = -5500;
+constexpr int16_t kMaxMeasuredValue = 12500;
+
+EndpointId sEndpoints[Ds18b20Bus::kMaxProbes];
+} /* namespace */
+
+CHIP_ERROR ProbeEndpoints::Init()
+{
+        const size_t count = SensorTask::Instance().ProbeCount();
+
+        sEndpoints[0] = kWaterEndpointId;
+        for (size_t probe = 1; probe < Ds18b20Bus::kMaxProbes; probe++) {
+                sEndpoints[probe] = kInvalidEndpointId;
+                if (probe >= count) {
+                        continue;
+                }
+
+                /* A probe without an endpoint is still sampled, only not published */
+                CHIP_ERROR err = DynamicEndpoints::AddMeasurement(DynamicEndpointKind::Temperature,
+                                                                  SensorTask::Instance().ProbeId(probe),
+                                                                  kMinMeasuredValue, kMaxMeasuredValue,
+                                                                  sEndpoints[probe]);
+                if (err != CHIP_NO_ERROR) {
+                        LOG_ERR("No endpoint for DS18B20 probe %u: %s", static_cast<unsigned>(probe), ErrorStr(err));
+                        sEndpoints[probe] = kInvalidEndpointId;
+                }
+        }
+
+        return CHIP_NO_ERROR;
+}
+
+EndpointId ProbeEndpoints::EndpointOf(size_t probe)
+{
+        return probe < Ds18b20Bus::kMaxProbes ? sEndpoints[probe] : kInvalidEndpointId;
+}
+
+void ProbeEndpoints::Publish(size_t probe, int16_t value)
+{
+        if (probe == 0 || EndpointOf(probe) == kInvalidEndpointId) {
+                return;
+        }
+
+        DynamicEndpoints::Publish(sEndpoints[probe], value);
+}
+
+void ProbeEndpoints::PublishNull(size_t probe)
+{
+        if (probe == 0 || EndpointOf(probe) == kInvalidEndpointId) {
+                return;
+        }
+
+        DynamicEndpoints::PublishNull(sEndpoints[probe]);
+}
@@ -0,0 +1,39 @@
+/* ****************************************************************************
+ *
+ *  DS18B20 PROBE ENDPOINTS - probe_endpoints.cpp
+ *
+ * Every DS18B20 probe found on the 1-Wire bus (see ds18b20_bus.h) is
+ * published on a Temperature Measurement endpoint of its own. The first
+ * probe is the water probe, on the fixed Water endpoint (EP11) of the ZAP
+ * file, published by the AppTask through the MeasurementPublisher like the
+ * other fixed measurement endpoints. The other probes (substrate, basking
+ * rock...) are DynamicEndpoints devices identified by their ROM ID, so
+ * each of them keeps its endpoint across reboots (see dynamic_endpoints.h),
+ * with the DS18B20 range as MinMeasuredValue and MaxMeasuredValue.
+ *
+ * Init: attach the probes after the first one to their dynamic endpoints
+ * EndpointOf: endpoint of a probe, kInvalidEndpointId if it has none
+ * Publish: filter and report a new temperature of a probe after the first
+ *          one, AppTask only
+ * PublishNull: null temperature of a failed probe after the first one,
+ *              AppTask only
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <lib/core/CHIPError.h>
+#include <lib/core/DataModelTypes.h>
+
+class ProbeEndpoints {
+public:
+        static constexpr chip::EndpointId kWaterEndpointId = 11;
+
+        static CHIP_ERROR Init();
+        static chip::EndpointId EndpointOf(size_t probe);
+        static void Publish(size_t probe, int16_t value);
+        static void PublishNull(size_t probe);
+};
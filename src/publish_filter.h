@@ -0,0 +1,44 @@
+/* ****************************************************************************
+ *
+ *  PUBLISH FILTER - publish_filter.h
+ *
+ * Decides whether a new measurement is worth publishing: it is when it moved
+ * by at least the absolute delta from the last published value, or when
+ * nothing was published for the max-silence interval, so that a steady
+ * value is still refreshed from time to time. The first value is always
+ * published, a delta of 0 publishes every value. After a Reset, the next
+ * value is published as the first one.
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+class PublishFilter {
+public:
+        PublishFilter(uint32_t delta, uint32_t maxSilenceMs) : mDelta(delta), mMaxSilenceMs(maxSilenceMs) {}
+
+        bool Accept(int32_t value, int64_t nowMs)
+        {
+                const uint32_t change = value > mLastValue ? value - mLastValue : mLastValue - value;
+
+                if (mPublished && change < mDelta && nowMs - mLastPublishMs < mMaxSilenceMs) {
+                        return false;
+                }
+
+                mPublished = true;
+                mLastValue = value;
+                mLastPublishMs = nowMs;
+                return true;
+        }
+
+        void Reset() { mPublished = false; }
+
+private:
+        uint32_t mDelta;
+        uint32_t mMaxSilenceMs;
+        bool mPublished = false;
+        int32_t mLastValue = 0;
+        int64_t mLastPublishMs = 0;
+};
@@ -0,0 +1,76 @@
+#include "relay_bank.h"
+
+int RelayBank::Add(const struct gpio_dt_spec &relay, int level)
+{
+        if (mPort && mPort != relay.port) {
+                return -EINVAL;
+        }
+
+        mPort = relay.port;
+        mMask |= BIT(relay.pin);
+        WRITE_BIT(mDesired, relay.pin, level);
+        WRITE_BIT(mOffLevels, relay.pin, level);
+        return 0;
+}
+
+int RelayBank::Stage(const struct gpio_dt_spec &relay, int level)
+{
+        if (relay.port != mPort || !(mMask & BIT(relay.pin))) {
+                return -EINVAL;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&mLock);
+        if (!(mForced & BIT(relay.pin))) {
+                WRITE_BIT(mDesired, relay.pin, level);
+        }
+        k_spin_unlock(&mLock, key);
+
+        return 0;
+}
+
+int RelayBank::Commit()
+{
+        if (!mPort) {
+                return 0;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&mLock);
+        const int ret = Write();
+        k_spin_unlock(&mLock, key);
+
+        return ret;
+}
+
+int RelayBank::Force(const struct gpio_dt_spec &relay)
+{
+        if (relay.port != mPort || !(mMask & BIT(relay.pin))) {
+                return -EINVAL;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&mLock);
+        mForced |= BIT(relay.pin);
+        mDesired = (mDesired & ~BIT(relay.pin)) | (mOffLevels & BIT(relay.pin));
+        const int ret = Write();
+        k_spin_unlock(&mLock, key);
+
+        return ret;
+}
+
+int RelayBank::Release(const struct gpio_dt_spec &relay)
+{
+        if (relay.port != mPort || !(mMask & BIT(relay.pin))) {
+                return -EINVAL;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&mLock);
+        mForced &= ~BIT(relay.pin);
+        k_spin_unlock(&mLock, key);
+
+        return 0;
+}
+
+/* With mLock held, the SoC GPIO port write does not sleep */
+int RelayBank::Write()
+{
+        return gpio_port_set_masked(mPort, mMask, mDesired);
+}
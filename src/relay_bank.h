@@ -0,0 +1,50 @@
+/* ****************************************************************************
+ *
+ *  RELAY BANK - relay_bank.cpp
+ *
+ * All the relays sit on the same GPIO port. RelayBank keeps the desired
+ * logical level of every relay pin as a bitmask and applies all of them
+ * with a single gpio_port_set_masked() call, so that a scene recall or a
+ * group command switches every affected relay in the same cycle.
+ *
+ * A relay can also be forced to its Off level, from any thread, for the
+ * safety interlocks (see interlocks.h): the port is written right away and
+ * the relay ignores the staged levels until it is released. The port is
+ * written with the lock held, so a Commit racing with a Force can never
+ * switch the relay back On.
+ *
+ * Add: register a relay pin with its Off level, which is also its initial
+ *      level, all the pins must share the same port
+ * Stage: change the desired level of a relay, without touching the port
+ * Commit: write the desired levels of all the relays at once
+ * Force: switch a relay Off at once and keep it Off until Release
+ * Release: let the staged levels drive a forced relay again, it stays Off
+ *          until staged On
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/spinlock.h>
+
+class RelayBank {
+public:
+        int Add(const struct gpio_dt_spec &relay, int level);
+        int Stage(const struct gpio_dt_spec &relay, int level);
+        int Commit();
+        int Force(const struct gpio_dt_spec &relay);
+        int Release(const struct gpio_dt_spec &relay);
+
+private:
+        int Write();
+
+        const struct device *mPort = nullptr;
+        gpio_port_pins_t mMask = 0;
+        gpio_port_value_t mDesired = 0;
+        gpio_port_value_t mOffLevels = 0;
+        gpio_port_pins_t mForced = 0;
+        struct k_spinlock mLock;
+};
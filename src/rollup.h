@@ -0,0 +1,50 @@
+/* ****************************************************************************
+ *
+ *  ROLLUP - rollup.h
+ *
+ * Running min/max/mean/count of int16 samples, updated in constant time
+ * per sample. Two rollups of adjacent periods merge into the rollup of the
+ * whole period, which is how a coarser resolution is rebuilt from finer
+ * ones.
+ *
+ * Add: account for one sample
+ * Merge: account for all the samples of another rollup
+ * Mean: mean of the samples, rounded to the nearest, 0 when empty
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+struct Rollup {
+        int16_t Min = INT16_MAX;
+        int16_t Max = INT16_MIN;
+        int64_t Sum = 0;
+        uint32_t Count = 0;
+
+        void Add(int16_t value)
+        {
+                Min = value < Min ? value : Min;
+                Max = value > Max ? value : Max;
+                Sum += value;
+                Count++;
+        }
+
+        void Merge(const Rollup &other)
+        {
+                Min = other.Min < Min ? other.Min : Min;
+                Max = other.Max > Max ? other.Max : Max;
+                Sum += other.Sum;
+                Count += other.Count;
+        }
+
+        int16_t Mean() const
+        {
+                if (Count == 0) {
+                        return 0;
+                }
+                const int64_t half = Count / 2;
+                return static_cast<int16_t>((Sum >= 0 ? Sum + half : Sum - half) / static_cast<int64_t>(Count));
+        }
+};
@@ -0,0 +1,95 @@
+/* ****************************************************************************
+ *
+ *  SENSOR HEALTH - sensor_health.h
+ *
+ * Fault tracking of a sensor, from the outcome of its acquisitions:
+ *
+ *   Ok: the last acquisition succeeded
+ *   Retrying: the last acquisitions failed, the last reading is still
+ *             fresh enough to be kept, the sensor is retried with an
+ *             exponential backoff
+ *   Failed: failThreshold acquisitions failed in a row, or the last
+ *           reading is older than staleMs, or there never was one: the
+ *           reading must not be used anymore
+ *
+ * A single successful acquisition brings the sensor back to Ok. The retry
+ * delay is the shortest interval after the first failure, and doubles
+ * with every other failure in a row, up to the longest interval.
+ *
+ * Success: record a successful acquisition at nowMs
+ * Failure: record a failed acquisition at nowMs
+ * State: current state
+ * RetryDelayMs: delay before the next acquisition of a failing sensor
+ * ConsecutiveFailures, Failures: failures in a row, and in total
+ * Faults: transitions from Ok or Retrying to Failed, a sensor missing since
+ *         the boot starts Failed
+ * LastSuccessMs: time of the last successful acquisition, negative if none
+ * ResetCounters: clear the Failures and Faults counters
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class SensorState : uint8_t { Ok = 0, Retrying, Failed };
+
+class SensorHealth {
+public:
+        constexpr SensorHealth(uint32_t failThreshold, uint32_t staleMs)
+                : mFailThreshold(failThreshold), mStaleMs(staleMs)
+        {
+        }
+
+        constexpr void Success(int64_t nowMs)
+        {
+                mState = SensorState::Ok;
+                mConsecutiveFailures = 0;
+                mLastSuccessMs = nowMs;
+        }
+
+        constexpr void Failure(int64_t nowMs)
+        {
+                const bool failed = mConsecutiveFailures + 1 >= mFailThreshold || mLastSuccessMs < 0 ||
+                                    nowMs - mLastSuccessMs > mStaleMs;
+
+                mConsecutiveFailures++;
+                mFailures++;
+                if (failed && mState != SensorState::Failed) {
+                        mFaults++;
+                }
+                mState = failed ? SensorState::Failed : SensorState::Retrying;
+        }
+
+        constexpr uint32_t RetryDelayMs(uint32_t minMs, uint32_t maxMs) const
+        {
+                uint32_t delay = minMs;
+
+                for (uint32_t i = 1; i < mConsecutiveFailures && delay < maxMs; i++) {
+                        delay = delay > maxMs / 2 ? maxMs : delay * 2;
+                }
+                return delay;
+        }
+
+        constexpr void ResetCounters()
+        {
+                mFailures = 0;
+                mFaults = 0;
+        }
+
+        constexpr SensorState State() const { return mState; }
+        constexpr uint32_t ConsecutiveFailures() const { return mConsecutiveFailures; }
+        constexpr uint32_t Failures() const { return mFailures; }
+        constexpr uint32_t Faults() const { return mFaults; }
+        constexpr int64_t LastSuccessMs() const { return mLastSuccessMs; }
+
+private:
+        uint32_t mFailThreshold;
+        uint32_t mStaleMs;
+        SensorState mState = SensorState::Failed;
+        uint32_t mConsecutiveFailures = 0;
+        uint32_t mFailures = 0;
+        uint32_t mFaults = 0;
+        int64_t mLastSuccessMs = -1;
+};
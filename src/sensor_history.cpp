@@ -0,0 +1,57 @@
+#include "sensor_history.h"
+
+#include <zephyr/kernel.h>
+
+namespace
+{
+constexpr uint32_t kPeriodMs = CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS;
+
+/* Appends and decoding steps are short, a spinlock keeps the readers of
+ * the Matter thread or the shell consistent with the AppTask writer */
+k_spinlock sLock;
+
+SensorHistory::Series sSeries[SensorHistory::kChannelCount] = {
+        SensorHistory::Series(kPeriodMs), SensorHistory::Series(kPeriodMs), SensorHistory::Series(kPeriodMs),
+        SensorHistory::Series(kPeriodMs), SensorHistory::Series(kPeriodMs),
+};
+static_assert(ARRAY_SIZE(sSeries) == SensorHistory::kChannelCount, "one series per history channel");
+
+SensorHistory::Series &SeriesOf(HistoryChannel channel)
+{
+        return sSeries[static_cast<size_t>(channel)];
+}
+} /* namespace */
+
+bool SensorHistory::Iterator::Next(Point &point)
+{
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        const bool found = mIterator.Next(point);
+        k_spin_unlock(&sLock, key);
+
+        return found;
+}
+
+void SensorHistory::Record(HistoryChannel channel, int64_t timestampMs, int16_t value)
+{
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        SeriesOf(channel).Append(timestampMs, value);
+        k_spin_unlock(&sLock, key);
+}
+
+SensorHistory::Iterator SensorHistory::Begin(HistoryChannel channel)
+{
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        const Iterator iterator(SeriesOf(channel).Begin());
+        k_spin_unlock(&sLock, key);
+
+        return iterator;
+}
+
+SensorHistory::Iterator SensorHistory::Seek(HistoryChannel channel, int64_t fromMs)
+{
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        const Iterator iterator(SeriesOf(channel).Seek(fromMs));
+        k_spin_unlock(&sLock, key);
+
+        return iterator;
+}
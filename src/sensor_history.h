@@ -0,0 +1,68 @@
+/* ****************************************************************************
+ *
+ *  SENSOR HISTORY - sensor_history.cpp
+ *
+ * In-RAM history of every measurement channel, in Matter units (0.01 C or
+ * 0.01 %RH), covering CONFIG_APP_SENSOR_HISTORY_S at the sensor sampling
+ * period. Each channel is a TimeSeries (see time_series.h) of 8 bit
+ * delta-encoded blocks with keyframes, all statically allocated and sized
+ * for CONFIG_APP_SENSOR_HISTORY_ESCAPE_PERCENT escaped samples.
+ *
+ * Record: append a successful measurement, called by the AppTask only
+ * Begin: iterator from the oldest stored sample of a channel
+ * Seek: iterator from the first sample taken at or after fromMs
+ * Iterator::Next: next sample, false at the end, safe to use from any
+ *                 thread while the AppTask is recording
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include "time_series.h"
+
+#include <cstddef>
+#include <cstdint>
+
+enum class HistoryChannel : uint8_t {
+        HotSpotTemperature = 0,
+        HotSpotHumidity,
+        ColdZoneTemperature,
+        ColdZoneHumidity,
+        WaterTemperature,
+        Count
+};
+
+class SensorHistory {
+public:
+        static constexpr size_t kChannelCount = static_cast<size_t>(HistoryChannel::Count);
+        static constexpr size_t kBlockBytes = 64;
+        /* Block capacity at the escape rate the history is sized for */
+        static constexpr size_t kBlockSamples =
+                TimeSeries<2, kBlockBytes>::BlockSamples(CONFIG_APP_SENSOR_HISTORY_ESCAPE_PERCENT);
+        static constexpr size_t kHistorySamples =
+                static_cast<size_t>(CONFIG_APP_SENSOR_HISTORY_S) * 1000 / CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS;
+        /* One extra block, so that recycling the oldest one never cuts the
+         * history below CONFIG_APP_SENSOR_HISTORY_S, as long as no more
+         * than CONFIG_APP_SENSOR_HISTORY_ESCAPE_PERCENT of the samples
+         * escape */
+        static constexpr size_t kBlocks = (kHistorySamples + kBlockSamples - 1) / kBlockSamples + 1;
+
+        using Series = TimeSeries<kBlocks, kBlockBytes>;
+        using Point = Series::Point;
+
+        class Iterator {
+        public:
+                bool Next(Point &point);
+
+        private:
+                friend class SensorHistory;
+
+                explicit Iterator(const Series::Iterator &iterator) : mIterator(iterator) {}
+
+                Series::Iterator mIterator;
+        };
+
+        static void Record(HistoryChannel channel, int64_t timestampMs, int16_t value);
+        static Iterator Begin(HistoryChannel channel);
+        static Iterator Seek(HistoryChannel channel, int64_t fromMs);
+};
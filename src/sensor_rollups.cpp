@@ -0,0 +1,211 @@
+#include "sensor_rollups.h"
+#ifdef CONFIG_APP_FLASH_LOG
+#include "flash_log.h"
+#endif
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+namespace
+{
+constexpr size_t kChannelCount = SensorHistory::kChannelCount;
+constexpr size_t kResolutionCount = SensorRollups::kResolutionCount;
+
+/* Updated by the AppTask, read by the shell and the Matter thread */
+k_spinlock sLock;
+SensorRollups::Summary sCurrent[kChannelCount][kResolutionCount];
+
+uint32_t ToTime(int64_t timestampMs)
+{
+#ifdef CONFIG_APP_FLASH_LOG
+        return FlashLog::ToLogTime(timestampMs);
+#else
+        return static_cast<uint32_t>(timestampMs / 1000);
+#endif
+}
+
+uint32_t PeriodStart(uint32_t time, RollupResolution resolution)
+{
+        return time - time % SensorRollups::PeriodS(resolution);
+}
+
+#ifdef CONFIG_APP_FLASH_LOG
+RollupRecord ToRecord(HistoryChannel channel, const SensorRollups::Summary &summary)
+{
+        RollupRecord record = {};
+
+        record.Time = summary.Start;
+        record.Source = static_cast<uint8_t>(channel);
+        record.Min = summary.Values.Min;
+        record.Max = summary.Values.Max;
+        record.Mean = summary.Values.Mean();
+        record.Count = summary.Values.Count;
+
+        return record;
+}
+
+/* The sum is rebuilt from the rounded mean, close enough to merge */
+Rollup FromRecord(const RollupRecord &record)
+{
+        Rollup rollup;
+
+        rollup.Min = record.Min;
+        rollup.Max = record.Max;
+        rollup.Sum = static_cast<int64_t>(record.Mean) * record.Count;
+        rollup.Count = record.Count;
+
+        return rollup;
+}
+
+/* Rollups of every channel over a time range, rebuilt from the log */
+using ChannelRollups = Rollup[kChannelCount];
+
+int RestoreFromSamples(uint32_t fromTime, uint32_t toTime, ChannelRollups &rollups)
+{
+        return FlashLog::Query(
+                fromTime, toTime,
+                [](const LogRecord &record, void *context) {
+                        if (record.Source < kChannelCount) {
+                                (*static_cast<ChannelRollups *>(context))[record.Source].Add(record.Value);
+                        }
+                        return true;
+                },
+                &rollups);
+}
+
+/* The periods of the rollups start in [fromTime, endTime) */
+int RestoreFromRollups(RollupResolution resolution, uint32_t fromTime, uint32_t endTime, ChannelRollups &rollups)
+{
+        if (endTime <= fromTime) {
+                return 0;
+        }
+
+        return FlashLog::QueryRollups(
+                resolution, fromTime, endTime - 1,
+                [](const RollupRecord &record, void *context) {
+                        if (record.Source < kChannelCount && record.Count > 0) {
+                                (*static_cast<ChannelRollups *>(context))[record.Source].Merge(FromRecord(record));
+                        }
+                        return true;
+                },
+                &rollups);
+}
+#endif
+
+/* Append a closed rollup to the flash log */
+void Persist(HistoryChannel channel, RollupResolution resolution, const SensorRollups::Summary &summary)
+{
+#ifdef CONFIG_APP_FLASH_LOG
+        FlashLog::RecordRollup(resolution, ToRecord(channel, summary));
+#endif
+}
+} /* namespace */
+
+int SensorRollups::Init()
+{
+#ifdef CONFIG_APP_FLASH_LOG
+        /* The log time resumes right after the last record, the periods in
+         * progress are those of the last records before the reboot. Each
+         * resolution is rebuilt from the closed rollups of the finer one,
+         * the minute from the raw samples. */
+        const uint32_t now = FlashLog::LogTime();
+        const uint32_t minuteStart = PeriodStart(now, RollupResolution::Minute);
+        const uint32_t hourStart = PeriodStart(now, RollupResolution::Hour);
+        const uint32_t dayStart = PeriodStart(now, RollupResolution::Day);
+        ChannelRollups minute;
+        ChannelRollups hour;
+        ChannelRollups day;
+
+        int ret = RestoreFromSamples(minuteStart, now, minute);
+        if (ret == 0) {
+                ret = RestoreFromRollups(RollupResolution::Minute, hourStart, minuteStart, hour);
+        }
+        if (ret == 0) {
+                ret = RestoreFromRollups(RollupResolution::Hour, dayStart, hourStart, day);
+        }
+        if (ret) {
+                LOG_ERR("Rollups restore failed: %d", ret);
+                return ret;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        for (size_t channel = 0; channel < kChannelCount; channel++) {
+                hour[channel].Merge(minute[channel]);
+                day[channel].Merge(hour[channel]);
+
+                sCurrent[channel][static_cast<size_t>(RollupResolution::Minute)] = { minuteStart, minute[channel] };
+                sCurrent[channel][static_cast<size_t>(RollupResolution::Hour)] = { hourStart, hour[channel] };
+                sCurrent[channel][static_cast<size_t>(RollupResolution::Day)] = { dayStart, day[channel] };
+        }
+        k_spin_unlock(&sLock, key);
+#endif
+
+        return 0;
+}
+
+void SensorRollups::Record(HistoryChannel channel, int64_t timestampMs, int16_t value)
+{
+        const uint32_t time = ToTime(timestampMs);
+        Summary closed[kResolutionCount];
+        bool isClosed[kResolutionCount] = {};
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        for (size_t resolution = 0; resolution < kResolutionCount; resolution++) {
+                Summary &current = sCurrent[static_cast<size_t>(channel)][resolution];
+                const uint32_t start = PeriodStart(time, static_cast<RollupResolution>(resolution));
+
+                if (current.Values.Count > 0 && current.Start != start) {
+                        closed[resolution] = current;
+                        isClosed[resolution] = true;
+                        current.Values = Rollup();
+                }
+                if (current.Values.Count == 0) {
+                        current.Start = start;
+                }
+                current.Values.Add(value);
+        }
+        k_spin_unlock(&sLock, key);
+
+        for (size_t resolution = 0; resolution < kResolutionCount; resolution++) {
+                if (isClosed[resolution]) {
+                        Persist(channel, static_cast<RollupResolution>(resolution), closed[resolution]);
+                }
+        }
+}
+
+SensorRollups::Summary SensorRollups::Current(HistoryChannel channel, RollupResolution resolution)
+{
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        const Summary summary = sCurrent[static_cast<size_t>(channel)][static_cast<size_t>(resolution)];
+        k_spin_unlock(&sLock, key);
+
+        return summary;
+}
+
+int SensorRollups::Query(HistoryChannel channel, RollupResolution resolution, uint32_t fromTime, uint32_t toTime,
+                         QueryCallback callback, void *context)
+{
+#ifdef CONFIG_APP_FLASH_LOG
+        struct ChannelQuery {
+                uint8_t Source;
+                QueryCallback Callback;
+                void *Context;
+        } query = { static_cast<uint8_t>(channel), callback, context };
+
+        return FlashLog::QueryRollups(
+                resolution, fromTime, toTime,
+                [](const RollupRecord &record, void *queryContext) {
+                        const ChannelQuery &channelQuery = *static_cast<const ChannelQuery *>(queryContext);
+
+                        if (record.Source != channelQuery.Source) {
+                                return true;
+                        }
+                        return channelQuery.Callback({ record.Time, FromRecord(record) }, channelQuery.Context);
+                },
+                &query);
+#else
+        return -ENOTSUP;
+#endif
+}
@@ -0,0 +1,61 @@
+/* ****************************************************************************
+ *
+ *  SENSOR ROLLUPS - sensor_rollups.cpp
+ *
+ * Min/max/mean/count of every measurement channel over 1 minute, 1 hour and
+ * 1 day periods, so that long-term trends never need the raw samples. Each
+ * sample updates the rollup in progress of the three resolutions in
+ * constant time (see rollup.h). A rollup is closed by the first sample of
+ * the next period, and the closed rollups are appended to their own ring of
+ * the flash log (see flash_log.h), so a 30 day query at the 1 day
+ * resolution only reads 30 records per channel.
+ *
+ * The periods are aligned on the log time (see FlashLog::LogTime), which
+ * keeps increasing across reboots but is not the wall clock. Without the
+ * flash log the rollups are only kept in RAM, on the uptime.
+ *
+ * Init: rebuild the rollups in progress from the flash log after a reboot
+ * Record: account for a successful measurement, called by the AppTask only
+ * Current: rollup in progress of a channel, from any thread
+ * Query: closed rollups of a channel and a resolution stored in the flash
+ *        log, oldest first
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include "rollup.h"
+#include "sensor_history.h"
+
+#include <cstddef>
+#include <cstdint>
+
+enum class RollupResolution : uint8_t { Minute = 0, Hour, Day, Count };
+
+class SensorRollups {
+public:
+        static constexpr size_t kResolutionCount = static_cast<size_t>(RollupResolution::Count);
+
+        struct Summary {
+                /* Log time of the start of the period, seconds */
+                uint32_t Start;
+                Rollup Values;
+        };
+
+        using QueryCallback = bool (*)(const Summary &summary, void *context);
+
+        static constexpr uint32_t PeriodS(RollupResolution resolution)
+        {
+                return resolution == RollupResolution::Minute ? 60 :
+                       resolution == RollupResolution::Hour   ? 3600 :
+                                                                86400;
+        }
+
+        static int Init();
+        static void Record(HistoryChannel channel, int64_t timestampMs, int16_t value);
+        static Summary Current(HistoryChannel channel, RollupResolution resolution);
+
+        /* Stops early when the callback returns false */
+        static int Query(HistoryChannel channel, RollupResolution resolution, uint32_t fromTime, uint32_t toTime,
+                         QueryCallback callback, void *context);
+};
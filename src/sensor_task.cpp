@@ -0,0 +1,610 @@
+#include "sensor_task.h"
+#include "adaptive_interval.h"
+#include "ds18b20_bus.h"
+#include "interlocks.h"
+#include "matter_units.h"
+#include "sensor_health.h"
+#include "spsc_ring.h"
+
+#include <cstdlib>
+
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <platform/CHIPDeviceLayer.h>
+
+using namespace ::chip::DeviceLayer;
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+namespace
+{
+/* Room for the samples of two acquisitions of every sensor and probe */
+constexpr size_t kSampleRingSize = 16;
+constexpr size_t kSensorCount = static_cast<size_t>(SensorId::Count);
+
+/* Fastest sampling supported by the devices, the DS18B20 one covers its
+ * 750 ms conversion at 12 bit */
+constexpr uint32_t kDht22MinIntervalMs = 2000;
+constexpr uint32_t kDht11MinIntervalMs = 1000;
+constexpr uint32_t kDs18b20MinIntervalMs = 1000;
+
+/* Datasheet supply current while measuring, at 3.3 V: DHT22 1.5 mA,
+ * DHT11 2.5 mA, DS18B20 1.5 mA */
+constexpr uint32_t kDht22ActivePowerUw = 4950;
+constexpr uint32_t kDht11ActivePowerUw = 8250;
+constexpr uint32_t kDs18b20ActivePowerUw = 4950;
+
+constexpr uint32_t kMatterIdlePollMs = 1;
+
+static_assert(kSampleRingSize >= 2 * (2 + Ds18b20Bus::kMaxProbes), "sample ring too small");
+static_assert(CONFIG_APP_SENSOR_HOT_SPOT_PHASE_MS < CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS &&
+                      CONFIG_APP_SENSOR_COLD_ZONE_PHASE_MS < CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS &&
+                      CONFIG_APP_SENSOR_WATER_TEMP_PHASE_MS < CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS,
+              "the sensor phases must be within the sampling period");
+static_assert(CONFIG_APP_SENSOR_STALE_MS > CONFIG_APP_SENSOR_MAX_INTERVAL_MS,
+              "a stable sensor must not go stale between two samples");
+
+K_THREAD_STACK_DEFINE(sSensorThreadStack, CONFIG_APP_SENSOR_THREAD_STACK_SIZE);
+k_thread sSensorThread;
+
+/* Finished samples, produced by the sensor thread and consumed by the app task */
+SpscRing<SensorSample, kSampleRingSize> sSampleRing;
+
+const struct device *const dht11 = DEVICE_DT_GET(DT_ALIAS(dht11));
+const struct device *const dht22 = DEVICE_DT_GET(DT_ALIAS(dht22));
+const struct device *const ds18b20 = DEVICE_DT_GET(DT_ALIAS(ds18b20));
+
+Ds18b20Bus sWaterTempProbes(DEVICE_DT_GET(DT_BUS(DT_ALIAS(ds18b20))), DT_PROP(DT_ALIAS(ds18b20), resolution));
+
+/* Matter units, to detect a change */
+struct Reading {
+        bool Valid;
+        int16_t Temperature;
+        uint16_t Humidity;
+};
+
+/* SensorHealth with the configured thresholds */
+struct ConfiguredHealth : SensorHealth {
+        ConfiguredHealth() : SensorHealth(CONFIG_APP_SENSOR_FAIL_THRESHOLD, CONFIG_APP_SENSOR_STALE_MS) {}
+};
+
+struct SensorSchedule {
+        AdaptiveInterval Interval;
+        uint32_t ActivePowerUw;
+        /* Offset of the acquisitions from the start of the sampling periods */
+        uint32_t PhaseMs;
+        /* k_uptime_get() of the next and of the last acquisition */
+        int64_t DueMs;
+        int64_t LastDueMs;
+        /* Last successful sample and health of every DS18B20 probe, or of
+         * the DHT */
+        Reading Last[Ds18b20Bus::kMaxProbes];
+        ConfiguredHealth Health[Ds18b20Bus::kMaxProbes];
+        uint32_t Samples;
+        /* Total time the sensor spent measuring */
+        uint32_t ActiveMs;
+        SensorTask::AcquisitionCounters Counters;
+};
+
+constexpr uint32_t MinIntervalMs(uint32_t deviceMinMs)
+{
+        return CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS > deviceMinMs ? CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS :
+                                                                    deviceMinMs;
+}
+
+/* Indexed by SensorId, updated by the sensor thread, read by the shell */
+SensorSchedule sSchedules[kSensorCount] = {
+        { AdaptiveInterval(MinIntervalMs(kDht22MinIntervalMs), CONFIG_APP_SENSOR_MAX_INTERVAL_MS),
+          kDht22ActivePowerUw, CONFIG_APP_SENSOR_HOT_SPOT_PHASE_MS },
+        { AdaptiveInterval(MinIntervalMs(kDht11MinIntervalMs), CONFIG_APP_SENSOR_MAX_INTERVAL_MS),
+          kDht11ActivePowerUw, CONFIG_APP_SENSOR_COLD_ZONE_PHASE_MS },
+        { AdaptiveInterval(MinIntervalMs(kDs18b20MinIntervalMs), CONFIG_APP_SENSOR_MAX_INTERVAL_MS),
+          kDs18b20ActivePowerUw, CONFIG_APP_SENSOR_WATER_TEMP_PHASE_MS },
+};
+k_spinlock sScheduleLock;
+int64_t sStartMs;
+SensorTask::ProbeTimings sProbeTimings;
+/* Set from the Convert-T to the last scratchpad read */
+atomic_t sProbeAcquisition;
+
+/* SensorBit() mask of the sensors to sample sooner, and the wake-up of the
+ * sensor thread, given so that a request never gets lost */
+atomic_t sExpedited;
+K_SEM_DEFINE(sWakeSem, 0, 1);
+
+/* Runtime switch of the Matter idle wait, to compare the DHT failure rates */
+atomic_t sMatterIdleWait = ATOMIC_INIT(CONFIG_APP_SENSOR_MATTER_IDLE_WAIT_MS > 0);
+
+const char *SensorName(SensorId sensor)
+{
+        switch (sensor) {
+        case SensorId::HotSpot:
+                return "DHT22";
+        case SensorId::ColdZone:
+                return "DHT11";
+        case SensorId::WaterTemp:
+                return "DS18B20";
+        default:
+                return "unknown";
+        }
+}
+
+bool HasChanged(const Reading &last, const SensorSample &sample)
+{
+        const int16_t temperature = MatterUnits::ToMatterTemperature(sample.Temperature);
+        const uint16_t humidity = MatterUnits::ToMatterHumidity(sample.Humidity);
+
+        return !last.Valid || abs(temperature - last.Temperature) >= CONFIG_APP_PUBLISH_TEMPERATURE_DELTA ||
+               (sample.Sensor != SensorId::WaterTemp &&
+                abs(humidity - last.Humidity) >= CONFIG_APP_PUBLISH_HUMIDITY_DELTA);
+}
+
+/* Count a sample, update the health of its sensor and tell when to sample
+ * it again: after the retry backoff when it failed, after the shortest
+ * interval when its reading changed, 0 to back off a stable sensor */
+uint32_t Track(SensorSample &sample)
+{
+        SensorSchedule &schedule = sSchedules[static_cast<size_t>(sample.Sensor)];
+        Reading &last = schedule.Last[sample.Probe];
+        SensorHealth &health = schedule.Health[sample.Probe];
+        uint32_t delayMs = 0;
+
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        if (sample.Result != 0) {
+                health.Failure(sample.Timestamp);
+                delayMs = health.RetryDelayMs(schedule.Interval.MinMs(), CONFIG_APP_SENSOR_MAX_INTERVAL_MS);
+        } else {
+                health.Success(sample.Timestamp);
+                delayMs = HasChanged(last, sample) ? schedule.Interval.MinMs() : 0;
+        }
+        sample.Health = health.State();
+
+        schedule.Counters.Attempts++;
+        if (sample.Result != 0) {
+                schedule.Counters.Failures++;
+        }
+        if (sample.Result == -EIO && sample.Sensor != SensorId::WaterTemp) {
+                schedule.Counters.ChecksumErrors++;
+        }
+        if (sample.Result == 0) {
+                last.Valid = true;
+                last.Temperature = MatterUnits::ToMatterTemperature(sample.Temperature);
+                last.Humidity = MatterUnits::ToMatterHumidity(sample.Humidity);
+        }
+        k_spin_unlock(&sScheduleLock, key);
+
+        return delayMs;
+}
+
+/* Time of the last successful acquisition of a sample sensor, or of the
+ * start if none, for the staleness interlocks */
+int64_t FreshSinceMs(const SensorSample &sample)
+{
+        const SensorSchedule &schedule = sSchedules[static_cast<size_t>(sample.Sensor)];
+
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        const int64_t lastSuccessMs = schedule.Health[sample.Probe].LastSuccessMs();
+        k_spin_unlock(&sScheduleLock, key);
+
+        return lastSuccessMs < 0 ? sStartMs : lastSuccessMs;
+}
+
+/* Earliest of two Track() delays, 0 only when both are */
+uint32_t Sooner(uint32_t delayMs, uint32_t otherMs)
+{
+        return delayMs == 0 ? otherMs : (otherMs == 0 ? delayMs : MIN(delayMs, otherMs));
+}
+
+/* A failed or changing sensor is sampled again after the Track() delay, and
+ * back from the shortest interval after that, a stable one backs off */
+void Reschedule(SensorId sensor, uint32_t delayMs, uint32_t activeMs)
+{
+        SensorSchedule &schedule = sSchedules[static_cast<size_t>(sensor)];
+
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        if (delayMs) {
+                schedule.Interval.Shorten();
+        } else {
+                schedule.Interval.BackOff();
+                delayMs = schedule.Interval.IntervalMs();
+        }
+        schedule.Samples++;
+        schedule.ActiveMs += activeMs;
+        schedule.LastDueMs = schedule.DueMs;
+        schedule.DueMs += delayMs;
+
+        /* Do not try to catch up with samples missed by a slow acquisition,
+         * resume on the phase of the sensor */
+        const int64_t now = k_uptime_get();
+        if (schedule.DueMs < now) {
+                schedule.DueMs += ROUND_UP(now - schedule.DueMs, CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS);
+        }
+        k_spin_unlock(&sScheduleLock, key);
+}
+
+void CountMatterWait(SensorId sensor, bool deferred, bool idle)
+{
+        SensorSchedule &schedule = sSchedules[static_cast<size_t>(sensor)];
+
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        schedule.Counters.Deferred += deferred;
+        schedule.Counters.Forced += !idle;
+        k_spin_unlock(&sScheduleLock, key);
+}
+
+/* The Matter thread only releases its stack lock while it waits for events,
+ * holding the lock keeps it waiting until the transaction is over */
+bool LockIdleMatterThread(SensorId sensor)
+{
+        if (!atomic_get(&sMatterIdleWait)) {
+                return false;
+        }
+
+        const int64_t deadline = k_uptime_get() + CONFIG_APP_SENSOR_MATTER_IDLE_WAIT_MS;
+        bool deferred = false;
+        bool idle;
+
+        while (!(idle = PlatformMgr().TryLockChipStack()) && k_uptime_get() < deadline) {
+                deferred = true;
+                k_sleep(K_MSEC(kMatterIdlePollMs));
+        }
+        CountMatterWait(sensor, deferred, idle);
+
+        return idle;
+}
+
+void ApplyExpedite()
+{
+        const uint8_t sensors = static_cast<uint8_t>(atomic_clear(&sExpedited));
+
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        for (size_t i = 0; i < kSensorCount; i++) {
+                SensorSchedule &schedule = sSchedules[i];
+
+                if (sensors & SensorBit(static_cast<SensorId>(i))) {
+                        schedule.Interval.Shorten();
+                        schedule.DueMs = MIN(schedule.DueMs, schedule.LastDueMs + schedule.Interval.MinMs());
+                }
+        }
+        k_spin_unlock(&sScheduleLock, key);
+}
+} /* namespace */
+
+int SensorTask::Init(SampleReadyCallback callback)
+{
+        mSampleReadyCallback = callback;
+
+        /* Initialize DHT11 */
+        if (!device_is_ready(dht11)) {
+                LOG_ERR("Device %s is not ready", dht11->name);
+                return -ENODEV;
+        }
+
+        /* Initialize DHT22 */
+        if (!device_is_ready(dht22)) {
+                LOG_ERR("Device %s is not ready", dht22->name);
+                return -ENODEV;
+        }
+
+        /* Initialize DS18B20 */
+        if (!device_is_ready(ds18b20)) {
+                LOG_ERR("Device %s is not ready", ds18b20->name);
+                return -ENODEV;
+        }
+
+        int ret = sWaterTempProbes.Init();
+        if (ret) {
+                LOG_ERR("sWaterTempProbes.Init() failed: %d", ret);
+                return ret;
+        }
+
+        /* All the probes convert at once */
+        sSchedules[static_cast<size_t>(SensorId::WaterTemp)].ActivePowerUw *= sWaterTempProbes.ProbeCount();
+
+        return 0;
+}
+
+void SensorTask::Start()
+{
+        sStartMs = k_uptime_get();
+        for (SensorSchedule &schedule : sSchedules) {
+                schedule.DueMs = sStartMs + schedule.PhaseMs;
+                schedule.LastDueMs = schedule.DueMs;
+        }
+
+        k_tid_t tid = k_thread_create(&sSensorThread, sSensorThreadStack, K_THREAD_STACK_SIZEOF(sSensorThreadStack),
+                                      ThreadMain, this, nullptr, nullptr, CONFIG_APP_SENSOR_THREAD_PRIORITY, 0,
+                                      K_NO_WAIT);
+        k_thread_name_set(tid, "sensors");
+}
+
+bool SensorTask::GetSample(SensorSample &sample)
+{
+        return sSampleRing.Pop(sample);
+}
+
+size_t SensorTask::ProbeCount()
+{
+        return sWaterTempProbes.ProbeCount();
+}
+
+uint64_t SensorTask::ProbeId(size_t probe)
+{
+        return sWaterTempProbes.ProbeId(probe);
+}
+
+int SensorTask::ForgetProbes()
+{
+        return sWaterTempProbes.ForgetProbes();
+}
+
+int SensorTask::RescanProbes()
+{
+        return sWaterTempProbes.Rescan();
+}
+
+SensorTask::ProbeTimings SensorTask::GetProbeTimings()
+{
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        ProbeTimings timings = sProbeTimings;
+        k_spin_unlock(&sScheduleLock, key);
+
+        timings.ConversionMs = sWaterTempProbes.ConversionTimeMs();
+        return timings;
+}
+
+bool SensorTask::ProbeAcquisitionInFlight()
+{
+        return atomic_get(&sProbeAcquisition);
+}
+
+void SensorTask::Expedite(uint8_t sensors)
+{
+        atomic_or(&sExpedited, sensors);
+        k_sem_give(&sWakeSem);
+}
+
+SensorTask::SamplingStats SensorTask::GetSamplingStats(SensorId sensor)
+{
+        const SensorSchedule &schedule = sSchedules[static_cast<size_t>(sensor)];
+        SamplingStats stats = {};
+        uint32_t activeMs;
+
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        stats.IntervalMs = schedule.Interval.IntervalMs();
+        stats.Samples = schedule.Samples;
+        activeMs = schedule.ActiveMs;
+        k_spin_unlock(&sScheduleLock, key);
+
+        stats.Name = SensorName(sensor);
+        stats.ElapsedMs = static_cast<uint32_t>(k_uptime_get() - sStartMs);
+
+        /* A fixed period samples at the start, then once per period */
+        const uint32_t fixedSamples = stats.ElapsedMs / CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS + 1;
+        stats.Avoided = fixedSamples > stats.Samples ? fixedSamples - stats.Samples : 0;
+        if (stats.Samples > 0) {
+                stats.EnergySavedUj = static_cast<uint32_t>(static_cast<uint64_t>(stats.Avoided) * activeMs *
+                                                            schedule.ActivePowerUw / stats.Samples / 1000);
+        }
+
+        return stats;
+}
+
+SensorTask::AcquisitionCounters SensorTask::GetAcquisitionCounters(SensorId sensor)
+{
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        const AcquisitionCounters counters = sSchedules[static_cast<size_t>(sensor)].Counters;
+        k_spin_unlock(&sScheduleLock, key);
+
+        return counters;
+}
+
+void SensorTask::ResetAcquisitionCounters()
+{
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        for (SensorSchedule &schedule : sSchedules) {
+                schedule.Counters = {};
+                for (SensorHealth &health : schedule.Health) {
+                        health.ResetCounters();
+                }
+        }
+        sProbeTimings = {};
+        k_spin_unlock(&sScheduleLock, key);
+}
+
+SensorTask::HealthStats SensorTask::GetHealth(SensorId sensor, size_t probe)
+{
+        HealthStats stats = {};
+
+        if (probe >= Ds18b20Bus::kMaxProbes) {
+                return stats;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+        const SensorHealth &health = sSchedules[static_cast<size_t>(sensor)].Health[probe];
+        stats.State = health.State();
+        stats.ConsecutiveFailures = health.ConsecutiveFailures();
+        stats.Failures = health.Failures();
+        stats.Faults = health.Faults();
+        stats.LastSuccessMs = health.LastSuccessMs();
+        k_spin_unlock(&sScheduleLock, key);
+
+        return stats;
+}
+
+void SensorTask::SetMatterIdleWait(bool enabled)
+{
+        atomic_set(&sMatterIdleWait, enabled && CONFIG_APP_SENSOR_MATTER_IDLE_WAIT_MS > 0);
+}
+
+bool SensorTask::MatterIdleWait()
+{
+        return atomic_get(&sMatterIdleWait);
+}
+
+void SensorTask::PushSample(const SensorSample &sample)
+{
+        if (sample.Result != 0) {
+                LOG_ERR("Sensor %s fetch failed: %d", SensorName(sample.Sensor), sample.Result);
+        }
+
+        if (!sSampleRing.Push(sample)) {
+                LOG_INF("Sensor sample ring full, dropping %s sample", SensorName(sample.Sensor));
+                return;
+        }
+
+        if (mSampleReadyCallback) {
+                mSampleReadyCallback();
+        }
+}
+
+void SensorTask::AcquireDht(SensorId sensor, const struct device *dev, bool endOfCycle)
+{
+        SensorSample sample = {};
+        sample.Sensor = sensor;
+        sample.EndOfCycle = endOfCycle;
+
+        const bool locked = LockIdleMatterThread(sensor);
+        const int64_t start = k_uptime_get();
+
+        sample.Result = sensor_sample_fetch(dev);
+        if (locked) {
+                PlatformMgr().UnlockChipStack();
+        }
+        if (sample.Result == 0) {
+                sample.Result = sensor_channel_get(dev, SENSOR_CHAN_AMBIENT_TEMP, &sample.Temperature);
+        }
+        if (sample.Result == 0) {
+                sample.Result = sensor_channel_get(dev, SENSOR_CHAN_HUMIDITY, &sample.Humidity);
+        }
+        sample.Timestamp = k_uptime_get();
+
+        /* The interlocks act before the sample is even queued to the AppTask */
+        const uint32_t delayMs = Track(sample);
+        Interlocks::Evaluate(sample, FreshSinceMs(sample));
+        Reschedule(sensor, delayMs, static_cast<uint32_t>(sample.Timestamp - start));
+        PushSample(sample);
+}
+
+/* All the probes converted at once, their scratchpads are read one after
+ * the other. An empty bus still yields a failed sample of the first probe. */
+void SensorTask::AcquireWaterProbes(int conversionResult, uint32_t convertCycles, int64_t conversionStart,
+                                    int64_t conversionEnd)
+{
+        const size_t probes = MAX(sWaterTempProbes.ProbeCount(), static_cast<size_t>(1));
+        uint32_t delayMs = 0;
+        uint32_t readCycles = 0;
+
+        const int64_t waitStart = k_uptime_get();
+        if (conversionResult == 0) {
+                k_sleep(K_TIMEOUT_ABS_MS(conversionEnd));
+        }
+
+        for (size_t probe = 0; probe < probes; probe++) {
+                SensorSample water = {};
+                water.Sensor = SensorId::WaterTemp;
+                water.Probe = static_cast<uint8_t>(probe);
+                water.EndOfCycle = probe == probes - 1;
+
+                water.Result = conversionResult;
+                if (water.Result == 0) {
+                        const uint32_t readStart = k_cycle_get_32();
+                        water.Result = sWaterTempProbes.ReadTemperature(probe, water.Temperature);
+                        readCycles = MAX(readCycles, k_cycle_get_32() - readStart);
+                }
+                water.Timestamp = k_uptime_get();
+
+                delayMs = Sooner(delayMs, Track(water));
+                Interlocks::Evaluate(water, FreshSinceMs(water));
+                PushSample(water);
+        }
+
+        const int64_t end = k_uptime_get();
+        if (conversionResult == 0 && sWaterTempProbes.ProbeCount() > 0) {
+                const uint32_t convertUs = k_cyc_to_us_ceil32(convertCycles);
+                const uint32_t waitMs = static_cast<uint32_t>(MAX(conversionEnd - waitStart, 0));
+                const uint32_t readUs = k_cyc_to_us_ceil32(readCycles);
+                const uint32_t latencyMs = static_cast<uint32_t>(end - conversionStart);
+
+                k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+                sProbeTimings.Acquisitions++;
+                sProbeTimings.ConvertUs = convertUs;
+                sProbeTimings.MaxConvertUs = MAX(sProbeTimings.MaxConvertUs, convertUs);
+                sProbeTimings.WaitMs = waitMs;
+                sProbeTimings.MaxWaitMs = MAX(sProbeTimings.MaxWaitMs, waitMs);
+                sProbeTimings.ReadUs = readUs;
+                sProbeTimings.MaxReadUs = MAX(sProbeTimings.MaxReadUs, readUs);
+                sProbeTimings.LatencyMs = latencyMs;
+                sProbeTimings.MaxLatencyMs = MAX(sProbeTimings.MaxLatencyMs, latencyMs);
+                k_spin_unlock(&sScheduleLock, key);
+        }
+
+        Reschedule(SensorId::WaterTemp, delayMs, static_cast<uint32_t>(end - conversionStart));
+        atomic_clear(&sProbeAcquisition);
+}
+
+/* The sensor thread sleeps until the next sensor is due, or an actuator
+ * switch expedites some sensors. With the default phases the sensors are
+ * never due together, when they are the DS18B20 conversion is started first
+ * so that the DHT transactions overlap with it instead of adding up. */
+void SensorTask::ThreadMain(void *arg, void *, void *)
+{
+        SensorTask *task = static_cast<SensorTask *>(arg);
+
+        while (true) {
+                ApplyExpedite();
+
+                const int64_t now = k_uptime_get();
+                uint8_t due = 0;
+                int64_t next = INT64_MAX;
+
+                k_spinlock_key_t key = k_spin_lock(&sScheduleLock);
+                for (size_t i = 0; i < kSensorCount; i++) {
+                        if (sSchedules[i].DueMs <= now) {
+                                due |= SensorBit(static_cast<SensorId>(i));
+                        }
+                }
+                k_spin_unlock(&sScheduleLock, key);
+
+                if (due) {
+                        const uint8_t waterBit = SensorBit(SensorId::WaterTemp);
+                        const bool waterDue = due & waterBit;
+                        int conversionResult = 0;
+                        uint32_t convertCycles = 0;
+
+                        const int64_t conversionStart = k_uptime_get();
+                        int64_t conversionEnd = conversionStart;
+                        if (waterDue) {
+                                atomic_set(&sProbeAcquisition, 1);
+                                const uint32_t convertStart = k_cycle_get_32();
+                                conversionResult = sWaterTempProbes.StartConversion();
+                                convertCycles = k_cycle_get_32() - convertStart;
+                                conversionEnd += sWaterTempProbes.ConversionTimeMs();
+                        }
+
+                        if (due & SensorBit(SensorId::HotSpot)) {
+                                task->AcquireDht(SensorId::HotSpot, dht22,
+                                                 !(due & (SensorBit(SensorId::ColdZone) | waterBit)));
+                        }
+                        if (due & SensorBit(SensorId::ColdZone)) {
+                                task->AcquireDht(SensorId::ColdZone, dht11, !waterDue);
+                        }
+
+                        if (waterDue) {
+                                task->AcquireWaterProbes(conversionResult, convertCycles, conversionStart,
+                                                         conversionEnd);
+                        }
+                }
+
+                key = k_spin_lock(&sScheduleLock);
+                for (const SensorSchedule &schedule : sSchedules) {
+                        next = MIN(next, schedule.DueMs);
+                }
+                k_spin_unlock(&sScheduleLock, key);
+
+                k_sem_take(&sWakeSem, K_TIMEOUT_ABS_MS(next));
+        }
+}
@@ -0,0 +1,186 @@
+/* ****************************************************************************
+ *
+ *  SENSORS ACQUISITION - sensor_task.cpp
+ *
+ * SensorTask owns the sensor devices and runs their acquisition on a
+ * dedicated thread, with its own stack and priority, so that the DHT
+ * bit-banging and the 1-Wire traffic never delay the AppTask event loop.
+ *
+ * Every sensor has its own sampling interval (see adaptive_interval.h),
+ * from CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS, or the fastest rate the device
+ * supports if slower, while its reading changes by at least the publish
+ * delta, up to CONFIG_APP_SENSOR_MAX_INTERVAL_MS while it is stable. Each
+ * sensor is sampled at its own phase of the period, so the transactions are
+ * spread instead of running in a burst. The thread sleeps until the next
+ * sensor is due and acquires all the sensors due at once: it starts the
+ * DS18B20 conversion of all the probes of the 1-Wire bus (see
+ * ds18b20_bus.h), reads the DHT22 and the DHT11 while they convert, then
+ * reads the result of every probe. A DHT transaction first waits
+ * for the Matter thread to be idle, and keeps it idle, since a preemption
+ * corrupts the bit timings. Each
+ * finished SensorSample is pushed into a lock-free SPSC ring and the
+ * consumer is notified through the SampleReadyCallback.
+ *
+ * The health of every sensor, and of every DS18B20 probe, is tracked from
+ * its acquisitions (see sensor_health.h), with the
+ * CONFIG_APP_SENSOR_FAIL_THRESHOLD and CONFIG_APP_SENSOR_STALE_MS limits. A
+ * failing sensor is retried with an exponential backoff instead of the
+ * shortest interval, and every sample carries the resulting state, so that
+ * the consumer knows when to stop using the last reading.
+ *
+ * Every sample feeds the safety interlocks (see interlocks.h) on this
+ * thread, before it is pushed into the ring.
+ *
+ * Init: check the sensor devices and configure the DS18B20
+ * Start: spawn the acquisition thread
+ * GetSample: pop the oldest finished sample, called by the consumer only
+ * Expedite: back to the shortest interval for some sensors, after an
+ *           actuator switch, from any thread
+ * GetSamplingStats: average sampling rate of a sensor, and the acquisitions
+ *                   and energy saved compared to the fixed shortest interval
+ * GetAcquisitionCounters: failures and Matter idle waits of a sensor
+ * ResetAcquisitionCounters: clear the acquisition and fault counters of all
+ *                           sensors, and the DS18B20 timings
+ * GetHealth: state and fault counters of a sensor, or of a DS18B20 probe
+ * SetMatterIdleWait: enable the Matter idle wait, if configured
+ * ProbeCount: number of DS18B20 probes on the bus, the first one is the
+ *             water probe
+ * ProbeId: 64 bit ROM ID of a DS18B20 probe
+ * GetProbeTimings: bus and wait times of the split DS18B20 acquisition, to
+ *                  compare with the driver blocking for the whole
+ *                  conversion
+ * ProbeAcquisitionInFlight: a DS18B20 acquisition is between its Convert-T
+ *                           and its last scratchpad read, for the actuator
+ *                           latency benchmark
+ * ForgetProbes: number the DS18B20 probes again in search order at the next
+ *               boot
+ * RescanProbes: search the 1-Wire bus now and cache the probes present, for
+ *               the next boot, return their count
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sensor_health.h"
+
+#include <zephyr/drivers/sensor.h>
+
+enum class SensorId : uint8_t { HotSpot = 0, ColdZone, WaterTemp, Count };
+
+constexpr uint8_t SensorBit(SensorId sensor)
+{
+        return static_cast<uint8_t>(1 << static_cast<uint8_t>(sensor));
+}
+
+struct SensorSample {
+        SensorId Sensor;
+        /* 0 on success, the failing driver error code otherwise */
+        int Result;
+        struct sensor_value Temperature;
+        /* Not used by the sensors without humidity channel */
+        struct sensor_value Humidity;
+        /* DS18B20 probe index, 0 for the other sensors */
+        uint8_t Probe;
+        /* k_uptime_get() at the end of the acquisition */
+        int64_t Timestamp;
+        /* Last sample of the sensors acquired together */
+        bool EndOfCycle;
+        /* Health of the sensor, or probe, after this sample */
+        SensorState Health;
+};
+
+class SensorTask {
+public:
+        using SampleReadyCallback = void (*)();
+
+        struct SamplingStats {
+                const char *Name;
+                uint32_t IntervalMs;
+                uint32_t Samples;
+                /* Since Start */
+                uint32_t ElapsedMs;
+                /* Acquisitions a fixed CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS would have added */
+                uint32_t Avoided;
+                /* Estimated from the datasheet supply current and the measured acquisition time */
+                uint32_t EnergySavedUj;
+        };
+
+        struct AcquisitionCounters {
+                uint32_t Attempts;
+                uint32_t Failures;
+                /* -EIO from a DHT: bad checksum or bit timing */
+                uint32_t ChecksumErrors;
+                /* DHT transactions delayed by a busy Matter thread */
+                uint32_t Deferred;
+                /* DHT transactions run with the Matter thread still busy */
+                uint32_t Forced;
+        };
+
+        /* Last and worst times of the DS18B20 acquisitions that converted */
+        struct ProbeTimings {
+                uint32_t Acquisitions;
+                uint32_t ConversionMs;
+                /* Skip-ROM Convert-T on the bus */
+                uint32_t ConvertUs;
+                uint32_t MaxConvertUs;
+                /* Sensor thread asleep until the end of the conversion, the
+                 * rest of the conversion went to the DHT transactions */
+                uint32_t WaitMs;
+                uint32_t MaxWaitMs;
+                /* Match-ROM scratchpad read of the slowest probe */
+                uint32_t ReadUs;
+                uint32_t MaxReadUs;
+                /* Conversion start to the sample of the last probe */
+                uint32_t LatencyMs;
+                uint32_t MaxLatencyMs;
+        };
+
+        struct HealthStats {
+                SensorState State;
+                uint32_t ConsecutiveFailures;
+                uint32_t Failures;
+                uint32_t Faults;
+                /* k_uptime_get() of the last successful acquisition, negative if none */
+                int64_t LastSuccessMs;
+        };
+
+        static SensorTask &Instance()
+        {
+                static SensorTask sSensorTask;
+                return sSensorTask;
+        };
+
+        int Init(SampleReadyCallback callback);
+        void Start();
+
+        bool GetSample(SensorSample &sample);
+
+        /* Mask of SensorBit() */
+        void Expedite(uint8_t sensors);
+        SamplingStats GetSamplingStats(SensorId sensor);
+        AcquisitionCounters GetAcquisitionCounters(SensorId sensor);
+        void ResetAcquisitionCounters();
+        HealthStats GetHealth(SensorId sensor, size_t probe = 0);
+        void SetMatterIdleWait(bool enabled);
+        bool MatterIdleWait();
+
+        size_t ProbeCount();
+        uint64_t ProbeId(size_t probe);
+        int ForgetProbes();
+        int RescanProbes();
+        ProbeTimings GetProbeTimings();
+        bool ProbeAcquisitionInFlight();
+
+private:
+        static void ThreadMain(void *, void *, void *);
+
+        void AcquireDht(SensorId sensor, const struct device *dev, bool endOfCycle);
+        void AcquireWaterProbes(int conversionResult, uint32_t convertCycles, int64_t conversionStart,
+                                int64_t conversionEnd);
+        void PushSample(const SensorSample &sample);
+
+        SampleReadyCallback mSampleReadyCallback = nullptr;
+};
@@ -0,0 +1,83 @@
+/* ****************************************************************************
+ *
+ *  SPIKE FILTER - spike_filter.h
+ *
+ * Streaming integer filter for the noisy DHT readings: the median of the
+ * last kWindow samples rejects isolated spikes (a flipped bit turns 25 C
+ * into 51 C for one sample), then the output is rate-limited to maxRatePerS
+ * units per second of sample time, so that a burst of bad samples cannot
+ * drag it far either. A real step goes through after (kWindow + 1) / 2
+ * samples, ramped by the rate limit. Until the window is full the median
+ * is taken over the samples received so far, the first sample goes through
+ * as is.
+ *
+ * Update: filter the sample taken at timestampMs, return the output
+ * Reset: forget the samples, the next one goes through as is
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+template <size_t kWindow> class SpikeFilter {
+        static_assert(kWindow % 2 == 1, "the median window must be odd");
+
+public:
+        constexpr explicit SpikeFilter(uint32_t maxRatePerS) : mMaxRatePerS(maxRatePerS) {}
+
+        constexpr int32_t Update(int32_t value, int64_t timestampMs)
+        {
+                mWindow[mNext] = value;
+                mNext = (mNext + 1) % kWindow;
+                mCount = mCount < kWindow ? mCount + 1 : kWindow;
+
+                const int64_t median = Median();
+                if (!mStarted) {
+                        mOutput = median;
+                        mStarted = true;
+                } else {
+                        const int64_t limit = static_cast<int64_t>(mMaxRatePerS) * (timestampMs - mLastMs) / 1000;
+                        mOutput = median > mOutput + limit ? mOutput + limit :
+                                                             (median < mOutput - limit ? mOutput - limit : median);
+                }
+                mLastMs = timestampMs;
+
+                return static_cast<int32_t>(mOutput);
+        }
+
+        constexpr void Reset()
+        {
+                mNext = 0;
+                mCount = 0;
+                mStarted = false;
+        }
+
+private:
+        /* Insertion sort, the window is a handful of samples */
+        constexpr int64_t Median() const
+        {
+                int32_t sorted[kWindow] = {};
+
+                for (size_t i = 0; i < mCount; i++) {
+                        size_t j = i;
+                        for (; j > 0 && sorted[j - 1] > mWindow[i]; j--) {
+                                sorted[j] = sorted[j - 1];
+                        }
+                        sorted[j] = mWindow[i];
+                }
+
+                /* Lower of the two middle samples while the window fills up */
+                return sorted[(mCount - 1) / 2];
+        }
+
+        uint32_t mMaxRatePerS;
+        int32_t mWindow[kWindow] = {};
+        size_t mNext = 0;
+        size_t mCount = 0;
+        int64_t mOutput = 0;
+        int64_t mLastMs = 0;
+        /* Not a window count test, a window of 1 is always full */
+        bool mStarted = false;
+};
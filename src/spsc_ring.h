@@ -0,0 +1,57 @@
+/* ****************************************************************************
+ *
+ *  SPSC RING - spsc_ring.h
+ *
+ * Fixed capacity, lock-free ring for exactly one producer thread and one
+ * consumer thread. The producer only writes mHead and the consumer only
+ * writes mTail, so the two sides never contend and neither of them has to
+ * take a lock or disable interrupts.
+ *
+ * Push: copy an item in, false when the ring is full
+ * Pop: copy the oldest item out, false when the ring is empty
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t N> class SpscRing {
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+        bool Push(const T &item)
+        {
+                const size_t head = mHead.load(std::memory_order_relaxed);
+                if (head - mTail.load(std::memory_order_acquire) == N) {
+                        return false;
+                }
+                mItems[head & (N - 1)] = item;
+                mHead.store(head + 1, std::memory_order_release);
+                return true;
+        }
+
+        bool Pop(T &item)
+        {
+                const size_t tail = mTail.load(std::memory_order_relaxed);
+                if (mHead.load(std::memory_order_acquire) == tail) {
+                        return false;
+                }
+                item = mItems[tail & (N - 1)];
+                mTail.store(tail + 1, std::memory_order_release);
+                return true;
+        }
+
+        size_t Size() const
+        {
+                return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+        }
+
+        static constexpr size_t Capacity() { return N; }
+
+private:
+        T mItems[N];
+        std::atomic<size_t> mHead{ 0 };
+        std::atomic<size_t> mTail{ 0 };
+};
@@ -0,0 +1,581 @@
+#include "terrarium_endpoint.h"
+#include "app_event_stats.h"
+#include "interlocks.h"
+#include "measurement_publisher.h"
+#include "sensor_task.h"
+#include "terrarium_snapshot.h"
+#ifdef CONFIG_APP_FLASH_LOG
+#include "flash_log.h"
+#endif
+
+#include <app-common/zap-generated/ids/Attributes.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <app/AttributeAccessInterface.h>
+#include <app/CommandHandlerInterface.h>
+#include <app/InteractionModelEngine.h>
+#include <app/data-model/Decode.h>
+#include <app/data-model/Encode.h>
+#include <app/data-model/Nullable.h>
+#include <app/util/attribute-storage.h>
+#include <lib/support/CodeUtils.h>
+#include <lib/support/Span.h>
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip;
+using namespace ::chip::app;
+using namespace ::chip::app::Clusters;
+
+namespace
+{
+constexpr uint16_t kDynamicEndpointIndex = 0;
+constexpr DeviceTypeId kTerrariumDeviceTypeId = 0xFFF10001;
+constexpr uint8_t kTerrariumDeviceTypeVersion = 1;
+constexpr uint16_t kClusterRevision = 1;
+constexpr uint16_t kListAttributeSize = 254;
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(descriptorAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::DeviceTypeList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::ServerList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::ClientList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(Descriptor::Attributes::PartsList::Id, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(diagnosticsAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(TerrariumClusters::Diagnostics::Attributes::EventCounters, ARRAY, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(TerrariumClusters::Diagnostics::Attributes::QueueHighWaterMarks, ARRAY,
+                                  kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(TerrariumClusters::Diagnostics::Attributes::DispatchTimeHistogram, ARRAY,
+                                  kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(TerrariumClusters::Diagnostics::Attributes::PublishCounters, ARRAY,
+                                  kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(TerrariumClusters::Diagnostics::Attributes::SensorHealth, ARRAY,
+                                  kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE(TerrariumClusters::Diagnostics::Attributes::InterlockAlarms, ARRAY,
+                                  kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(snapshotAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(TerrariumClusters::Snapshot::Attributes::Snapshot, STRUCT, kListAttributeSize, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+#ifdef CONFIG_APP_FLASH_LOG
+DECLARE_DYNAMIC_ATTRIBUTE_LIST_BEGIN(historyAttrs)
+DECLARE_DYNAMIC_ATTRIBUTE(TerrariumClusters::History::Attributes::LogTime, INT32U, 4, 0),
+        DECLARE_DYNAMIC_ATTRIBUTE_LIST_END();
+
+constexpr CommandId historyIncomingCommands[] = { TerrariumClusters::History::Commands::GetHistory,
+                                                  kInvalidCommandId };
+constexpr CommandId historyOutgoingCommands[] = { TerrariumClusters::History::Commands::GetHistoryResponse,
+                                                  kInvalidCommandId };
+#endif
+
+DECLARE_DYNAMIC_CLUSTER_LIST_BEGIN(terrariumClusters)
+DECLARE_DYNAMIC_CLUSTER(Descriptor::Id, descriptorAttrs, nullptr, nullptr),
+        DECLARE_DYNAMIC_CLUSTER(TerrariumClusters::Diagnostics::Id, diagnosticsAttrs, nullptr, nullptr),
+        DECLARE_DYNAMIC_CLUSTER(TerrariumClusters::Snapshot::Id, snapshotAttrs, nullptr, nullptr),
+#ifdef CONFIG_APP_FLASH_LOG
+        DECLARE_DYNAMIC_CLUSTER(TerrariumClusters::History::Id, historyAttrs, historyIncomingCommands,
+                                historyOutgoingCommands),
+#endif
+        DECLARE_DYNAMIC_CLUSTER_LIST_END;
+
+DECLARE_DYNAMIC_ENDPOINT(terrariumEndpoint, terrariumClusters);
+
+DataVersion sDataVersions[ArraySize(terrariumClusters)];
+const EmberAfDeviceType sDeviceTypes[] = { { kTerrariumDeviceTypeId, kTerrariumDeviceTypeVersion } };
+
+struct EventCountersEntry {
+        static constexpr bool kIsFabricScoped = false;
+
+        uint8_t Type;
+        AppEventStats::TypeCounters Counters;
+
+        CHIP_ERROR Encode(TLV::TLVWriter &writer, TLV::Tag tag) const
+        {
+                TLV::TLVType outer;
+                ReturnErrorOnFailure(writer.StartContainer(tag, TLV::kTLVType_Structure, outer));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(0), Type));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(1), Counters.Posted));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(2), Counters.Dropped));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(3), Counters.Coalesced));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(4), Counters.Dispatched));
+                return writer.EndContainer(outer);
+        }
+};
+
+struct PublishCountersEntry {
+        static constexpr bool kIsFabricScoped = false;
+
+        EndpointId Endpoint;
+        MeasurementPublisher::Counters Counters;
+
+        CHIP_ERROR Encode(TLV::TLVWriter &writer, TLV::Tag tag) const
+        {
+                TLV::TLVType outer;
+                ReturnErrorOnFailure(writer.StartContainer(tag, TLV::kTLVType_Structure, outer));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(0), Endpoint));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(1), Counters.Published));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(2), Counters.Suppressed));
+                return writer.EndContainer(outer);
+        }
+};
+
+struct SensorHealthEntry {
+        static constexpr bool kIsFabricScoped = false;
+
+        SensorId Sensor;
+        uint8_t Probe;
+        SensorTask::HealthStats Health;
+
+        CHIP_ERROR Encode(TLV::TLVWriter &writer, TLV::Tag tag) const
+        {
+                TLV::TLVType outer;
+                ReturnErrorOnFailure(writer.StartContainer(tag, TLV::kTLVType_Structure, outer));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(0), static_cast<uint8_t>(Sensor)));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(1), Probe));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(2), static_cast<uint8_t>(Health.State)));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(3), Health.ConsecutiveFailures));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(4), Health.Failures));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(5), Health.Faults));
+                if (Health.LastSuccessMs < 0) {
+                        ReturnErrorOnFailure(writer.PutNull(TLV::ContextTag(6)));
+                } else {
+                        ReturnErrorOnFailure(
+                                writer.Put(TLV::ContextTag(6), static_cast<uint64_t>(Health.LastSuccessMs)));
+                }
+                return writer.EndContainer(outer);
+        }
+};
+
+struct InterlockAlarmEntry {
+        static constexpr bool kIsFabricScoped = false;
+
+        uint8_t Rule;
+        Interlocks::Status Status;
+
+        CHIP_ERROR Encode(TLV::TLVWriter &writer, TLV::Tag tag) const
+        {
+                TLV::TLVType outer;
+                ReturnErrorOnFailure(writer.StartContainer(tag, TLV::kTLVType_Structure, outer));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(0), Rule));
+                ReturnErrorOnFailure(writer.PutBoolean(TLV::ContextTag(1), Status.Latched));
+                ReturnErrorOnFailure(writer.PutBoolean(TLV::ContextTag(2), Status.Violating));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(3), Status.Trips));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(4), Status.Rule->Actuator));
+                ReturnErrorOnFailure(
+                        writer.Put(TLV::ContextTag(5), Interlocks::WorstCaseReactionMs(*Status.Rule)));
+                return writer.EndContainer(outer);
+        }
+};
+
+class DiagnosticsAttrAccess : public AttributeAccessInterface {
+public:
+        DiagnosticsAttrAccess()
+                : AttributeAccessInterface(Optional<EndpointId>(TerrariumEndpoint::kEndpointId),
+                                           TerrariumClusters::Diagnostics::Id)
+        {
+        }
+
+        CHIP_ERROR Read(const ConcreteReadAttributePath &aPath, AttributeValueEncoder &aEncoder) override
+        {
+                switch (aPath.mAttributeId) {
+                case TerrariumClusters::Diagnostics::Attributes::EventCounters:
+                        return aEncoder.EncodeList([](const auto &encoder) -> CHIP_ERROR {
+                                for (size_t i = 0; i < AppEventStats::kTypeCount; i++) {
+                                        const AppEventType type = static_cast<AppEventType>(i);
+                                        EventCountersEntry entry{ static_cast<uint8_t>(i),
+                                                                  AppEventStats::Counters(type) };
+                                        ReturnErrorOnFailure(encoder.Encode(entry));
+                                }
+                                return CHIP_NO_ERROR;
+                        });
+                case TerrariumClusters::Diagnostics::Attributes::QueueHighWaterMarks:
+                        return aEncoder.EncodeList([](const auto &encoder) -> CHIP_ERROR {
+                                for (size_t i = 0; i < AppEventStats::kClassCount; i++) {
+                                        ReturnErrorOnFailure(encoder.Encode(
+                                                AppEventStats::HighWaterMark(static_cast<AppEventClass>(i))));
+                                }
+                                return CHIP_NO_ERROR;
+                        });
+                case TerrariumClusters::Diagnostics::Attributes::DispatchTimeHistogram:
+                        return aEncoder.EncodeList([](const auto &encoder) -> CHIP_ERROR {
+                                for (size_t i = 0; i < AppEventStats::kHistogramBuckets; i++) {
+                                        ReturnErrorOnFailure(encoder.Encode(AppEventStats::HistogramBucket(i)));
+                                }
+                                return CHIP_NO_ERROR;
+                        });
+                case TerrariumClusters::Diagnostics::Attributes::PublishCounters:
+                        return aEncoder.EncodeList([](const auto &encoder) -> CHIP_ERROR {
+                                for (size_t i = 0; i < MeasurementPublisher::kEndpointCount; i++) {
+                                        const EndpointId endpoint = MeasurementPublisher::kFirstEndpoint + i;
+                                        PublishCountersEntry entry{ endpoint,
+                                                                    MeasurementPublisher::GetCounters(endpoint) };
+                                        ReturnErrorOnFailure(encoder.Encode(entry));
+                                }
+                                return CHIP_NO_ERROR;
+                        });
+                case TerrariumClusters::Diagnostics::Attributes::SensorHealth:
+                        return aEncoder.EncodeList([](const auto &encoder) -> CHIP_ERROR {
+                                SensorTask &sensors = SensorTask::Instance();
+
+                                /* One entry per DHT sensor, one per DS18B20 probe, the water probe even
+                                 * when missing */
+                                for (size_t i = 0; i < static_cast<size_t>(SensorId::Count); i++) {
+                                        const SensorId sensor = static_cast<SensorId>(i);
+                                        const size_t probeCount = MAX(sensors.ProbeCount(), static_cast<size_t>(1));
+                                        const size_t probes = sensor == SensorId::WaterTemp ? probeCount : 1;
+
+                                        for (size_t probe = 0; probe < probes; probe++) {
+                                                SensorHealthEntry entry{ sensor, static_cast<uint8_t>(probe),
+                                                                         sensors.GetHealth(sensor, probe) };
+                                                ReturnErrorOnFailure(encoder.Encode(entry));
+                                        }
+                                }
+                                return CHIP_NO_ERROR;
+                        });
+                case TerrariumClusters::Diagnostics::Attributes::InterlockAlarms:
+                        return aEncoder.EncodeList([](const auto &encoder) -> CHIP_ERROR {
+                                InterlockAlarmEntry entry = {};
+
+                                for (size_t i = 0; Interlocks::GetStatus(i, entry.Status); i++) {
+                                        entry.Rule = static_cast<uint8_t>(i);
+                                        ReturnErrorOnFailure(encoder.Encode(entry));
+                                }
+                                return CHIP_NO_ERROR;
+                        });
+                case Globals::Attributes::ClusterRevision::Id:
+                        return aEncoder.Encode(kClusterRevision);
+                default:
+                        return CHIP_NO_ERROR;
+                }
+        }
+};
+
+DiagnosticsAttrAccess sDiagnosticsAttrAccess;
+
+struct SnapshotValue {
+        static constexpr bool kIsFabricScoped = false;
+
+        TerrariumSnapshot::Snapshot Snapshot;
+
+        CHIP_ERROR Encode(TLV::TLVWriter &writer, TLV::Tag tag) const
+        {
+                TLV::TLVType outer;
+                TLV::TLVType times;
+
+                ReturnErrorOnFailure(writer.StartContainer(tag, TLV::kTLVType_Structure, outer));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(0), Snapshot.Cycle));
+                for (size_t i = 0; i < SensorHistory::kChannelCount; i++) {
+                        const HistoryChannel channel = static_cast<HistoryChannel>(i);
+                        const TLV::Tag valueTag = TLV::ContextTag(static_cast<uint8_t>(1 + i));
+
+                        if (!(Snapshot.ValidValues & BIT(i))) {
+                                ReturnErrorOnFailure(writer.PutNull(valueTag));
+                        } else if (channel == HistoryChannel::HotSpotHumidity ||
+                                   channel == HistoryChannel::ColdZoneHumidity) {
+                                ReturnErrorOnFailure(writer.Put(valueTag, static_cast<uint16_t>(Snapshot.Values[i])));
+                        } else {
+                                ReturnErrorOnFailure(writer.Put(valueTag, Snapshot.Values[i]));
+                        }
+                }
+                ReturnErrorOnFailure(writer.StartContainer(TLV::ContextTag(6), TLV::kTLVType_Array, times));
+                for (int64_t timestamp : Snapshot.SampleTimesMs) {
+                        ReturnErrorOnFailure(writer.Put(TLV::AnonymousTag(), static_cast<uint64_t>(timestamp)));
+                }
+                ReturnErrorOnFailure(writer.EndContainer(times));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(7), Snapshot.ActuatorStates));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(8), Snapshot.SensorFaults));
+                return writer.EndContainer(outer);
+        }
+};
+
+class SnapshotAttrAccess : public AttributeAccessInterface {
+public:
+        SnapshotAttrAccess()
+                : AttributeAccessInterface(Optional<EndpointId>(TerrariumEndpoint::kEndpointId),
+                                           TerrariumClusters::Snapshot::Id)
+        {
+        }
+
+        CHIP_ERROR Read(const ConcreteReadAttributePath &aPath, AttributeValueEncoder &aEncoder) override
+        {
+                switch (aPath.mAttributeId) {
+                case TerrariumClusters::Snapshot::Attributes::Snapshot:
+                        return aEncoder.Encode(SnapshotValue{ TerrariumSnapshot::Get() });
+                case Globals::Attributes::ClusterRevision::Id:
+                        return aEncoder.Encode(kClusterRevision);
+                default:
+                        return CHIP_NO_ERROR;
+                }
+        }
+};
+
+SnapshotAttrAccess sSnapshotAttrAccess;
+
+#ifdef CONFIG_APP_FLASH_LOG
+using HistoryResolution = TerrariumClusters::History::Resolution;
+
+static_assert(static_cast<uint8_t>(HistoryResolution::Minute) - 1 == static_cast<uint8_t>(RollupResolution::Minute) &&
+                      static_cast<uint8_t>(HistoryResolution::Day) - 1 == static_cast<uint8_t>(RollupResolution::Day),
+              "the history resolutions follow the rollup resolutions");
+
+constexpr size_t kMaxRawPoints = 64;
+constexpr size_t kMaxRollupPoints = 32;
+/* Records read by one GetHistory, so that a channel missing from a long
+ * range does not hold the Matter thread for the whole log */
+constexpr uint32_t kMaxScannedRecords = 4096;
+
+struct HistoryPoint {
+        uint32_t Time;
+        int16_t Mean;
+        int16_t Min;
+        int16_t Max;
+        uint32_t Count;
+};
+
+struct GetHistoryRequest {
+        static constexpr CommandId GetCommandId() { return TerrariumClusters::History::Commands::GetHistory; }
+        static constexpr ClusterId GetClusterId() { return TerrariumClusters::History::Id; }
+
+        uint8_t Channel;
+        uint32_t From;
+        uint32_t To;
+        uint8_t Resolution;
+        Optional<uint32_t> Cursor;
+
+        CHIP_ERROR Decode(TLV::TLVReader &reader)
+        {
+                constexpr uint8_t kMandatoryFields = 0x0F;
+                uint8_t fields = 0;
+                TLV::TLVType outer;
+                CHIP_ERROR err;
+
+                ReturnErrorOnFailure(reader.EnterContainer(outer));
+                while ((err = reader.Next()) == CHIP_NO_ERROR) {
+                        if (!TLV::IsContextTag(reader.GetTag())) {
+                                continue;
+                        }
+                        switch (TLV::TagNumFromTag(reader.GetTag())) {
+                        case 0:
+                                ReturnErrorOnFailure(DataModel::Decode(reader, Channel));
+                                break;
+                        case 1:
+                                ReturnErrorOnFailure(DataModel::Decode(reader, From));
+                                break;
+                        case 2:
+                                ReturnErrorOnFailure(DataModel::Decode(reader, To));
+                                break;
+                        case 3:
+                                ReturnErrorOnFailure(DataModel::Decode(reader, Resolution));
+                                break;
+                        case 4:
+                                ReturnErrorOnFailure(DataModel::Decode(reader, Cursor.Emplace()));
+                                break;
+                        default:
+                                continue;
+                        }
+                        fields |= 1 << TLV::TagNumFromTag(reader.GetTag());
+                }
+                VerifyOrReturnError(err == CHIP_END_OF_TLV, err);
+                VerifyOrReturnError((fields & kMandatoryFields) == kMandatoryFields,
+                                    CHIP_ERROR_IM_MALFORMED_COMMAND_DATA_IB);
+
+                return reader.ExitContainer(outer);
+        }
+};
+
+struct GetHistoryResponse {
+        static constexpr CommandId GetCommandId()
+        {
+                return TerrariumClusters::History::Commands::GetHistoryResponse;
+        }
+        static constexpr ClusterId GetClusterId() { return TerrariumClusters::History::Id; }
+
+        uint8_t Channel;
+        HistoryResolution Resolution;
+        Span<const HistoryPoint> Points;
+        DataModel::Nullable<uint32_t> NextCursor;
+
+        CHIP_ERROR Encode(TLV::TLVWriter &writer, TLV::Tag tag) const
+        {
+                TLV::TLVType outer;
+                TLV::TLVType list;
+                TLV::TLVType point;
+
+                ReturnErrorOnFailure(writer.StartContainer(tag, TLV::kTLVType_Structure, outer));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(0), Channel));
+                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(1), static_cast<uint8_t>(Resolution)));
+                ReturnErrorOnFailure(writer.StartContainer(TLV::ContextTag(2), TLV::kTLVType_Array, list));
+                for (const HistoryPoint &entry : Points) {
+                        ReturnErrorOnFailure(
+                                writer.StartContainer(TLV::AnonymousTag(), TLV::kTLVType_Structure, point));
+                        ReturnErrorOnFailure(writer.Put(TLV::ContextTag(0), entry.Time));
+                        ReturnErrorOnFailure(writer.Put(TLV::ContextTag(1), entry.Mean));
+                        if (Resolution != HistoryResolution::Raw) {
+                                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(2), entry.Min));
+                                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(3), entry.Max));
+                                ReturnErrorOnFailure(writer.Put(TLV::ContextTag(4), entry.Count));
+                        }
+                        ReturnErrorOnFailure(writer.EndContainer(point));
+                }
+                ReturnErrorOnFailure(writer.EndContainer(list));
+                ReturnErrorOnFailure(DataModel::Encode(writer, TLV::ContextTag(3), NextCursor));
+                return writer.EndContainer(outer);
+        }
+};
+
+/* Gathers the points of one chunk, the log records of the other channels
+ * are skipped */
+struct HistoryCollector {
+        uint8_t Source;
+        size_t MaxPoints;
+        size_t Count;
+        uint32_t Scanned;
+        DataModel::Nullable<uint32_t> NextCursor;
+
+        /* GetHistory only runs on the Matter thread */
+        static HistoryPoint sPoints[kMaxRawPoints];
+
+        /* false once the chunk is full, the record is the first of the next
+         * one. A channel has at most one sample per second, the next chunk
+         * starts after the last point returned. */
+        bool Accept(uint32_t time, uint8_t source, bool full)
+        {
+                if (++Scanned > kMaxScannedRecords || (source == Source && full)) {
+                        const uint32_t next = Count > 0 ? sPoints[Count - 1].Time + 1 : time;
+                        NextCursor.SetNonNull(time > next ? time : next);
+                        return false;
+                }
+                return source == Source;
+        }
+
+        static bool OnRecord(const LogRecord &record, void *context)
+        {
+                HistoryCollector &collector = *static_cast<HistoryCollector *>(context);
+
+                if (!collector.Accept(record.Time, record.Source, collector.Count == collector.MaxPoints)) {
+                        return collector.NextCursor.IsNull();
+                }
+                sPoints[collector.Count++] = { record.Time, record.Value, record.Value, record.Value, 1 };
+                return true;
+        }
+
+        static bool OnRollup(const RollupRecord &record, void *context)
+        {
+                HistoryCollector &collector = *static_cast<HistoryCollector *>(context);
+
+                if (!collector.Accept(record.Time, record.Source, collector.Count == collector.MaxPoints)) {
+                        return collector.NextCursor.IsNull();
+                }
+                sPoints[collector.Count++] = { record.Time, record.Mean, record.Min, record.Max, record.Count };
+                return true;
+        }
+};
+
+HistoryPoint HistoryCollector::sPoints[kMaxRawPoints];
+
+void HandleGetHistory(CommandHandlerInterface::HandlerContext &context, const GetHistoryRequest &request)
+{
+        using Protocols::InteractionModel::Status;
+
+        const HistoryResolution resolution = static_cast<HistoryResolution>(request.Resolution);
+        const uint32_t from = request.Cursor.HasValue() && request.Cursor.Value() > request.From ?
+                                      request.Cursor.Value() :
+                                      request.From;
+
+        if (request.Channel >= SensorHistory::kChannelCount ||
+            request.Resolution > static_cast<uint8_t>(HistoryResolution::Day) || request.From > request.To) {
+                context.mCommandHandler.AddStatus(context.mRequestPath, Status::ConstraintError);
+                return;
+        }
+
+        HistoryCollector collector = {};
+        collector.Source = request.Channel;
+        collector.MaxPoints = resolution == HistoryResolution::Raw ? kMaxRawPoints : kMaxRollupPoints;
+
+        int ret = 0;
+        if (from <= request.To && resolution == HistoryResolution::Raw) {
+                ret = FlashLog::Query(from, request.To, HistoryCollector::OnRecord, &collector);
+        } else if (from <= request.To) {
+                const RollupResolution rollup = static_cast<RollupResolution>(request.Resolution - 1);
+                ret = FlashLog::QueryRollups(rollup, from, request.To, HistoryCollector::OnRollup, &collector);
+        }
+        if (ret) {
+                LOG_ERR("History query failed: %d", ret);
+                context.mCommandHandler.AddStatus(context.mRequestPath, Status::Failure);
+                return;
+        }
+
+        GetHistoryResponse response;
+        response.Channel = request.Channel;
+        response.Resolution = resolution;
+        response.Points = Span<const HistoryPoint>(HistoryCollector::sPoints, collector.Count);
+        response.NextCursor = collector.NextCursor;
+        context.mCommandHandler.AddResponse(context.mRequestPath, response);
+}
+
+class HistoryCommandHandler : public CommandHandlerInterface {
+public:
+        HistoryCommandHandler()
+                : CommandHandlerInterface(Optional<EndpointId>(TerrariumEndpoint::kEndpointId),
+                                          TerrariumClusters::History::Id)
+        {
+        }
+
+        void InvokeCommand(HandlerContext &context) override
+        {
+                HandleCommand<GetHistoryRequest>(context, [](HandlerContext &ctx, const GetHistoryRequest &request) {
+                        HandleGetHistory(ctx, request);
+                        ctx.SetCommandHandled();
+                });
+        }
+};
+
+class HistoryAttrAccess : public AttributeAccessInterface {
+public:
+        HistoryAttrAccess()
+                : AttributeAccessInterface(Optional<EndpointId>(TerrariumEndpoint::kEndpointId),
+                                           TerrariumClusters::History::Id)
+        {
+        }
+
+        CHIP_ERROR Read(const ConcreteReadAttributePath &aPath, AttributeValueEncoder &aEncoder) override
+        {
+                switch (aPath.mAttributeId) {
+                case TerrariumClusters::History::Attributes::LogTime:
+                        return aEncoder.Encode(FlashLog::LogTime());
+                case Globals::Attributes::ClusterRevision::Id:
+                        return aEncoder.Encode(kClusterRevision);
+                default:
+                        return CHIP_NO_ERROR;
+                }
+        }
+};
+
+HistoryCommandHandler sHistoryCommandHandler;
+HistoryAttrAccess sHistoryAttrAccess;
+#endif
+} /* namespace */
+
+CHIP_ERROR TerrariumEndpoint::Init()
+{
+        registerAttributeAccessOverride(&sDiagnosticsAttrAccess);
+        registerAttributeAccessOverride(&sSnapshotAttrAccess);
+#ifdef CONFIG_APP_FLASH_LOG
+        registerAttributeAccessOverride(&sHistoryAttrAccess);
+        ReturnErrorOnFailure(InteractionModelEngine::GetInstance()->RegisterCommandHandler(&sHistoryCommandHandler));
+#endif
+
+        EmberAfStatus status = emberAfSetDynamicEndpoint(kDynamicEndpointIndex, kEndpointId, &terrariumEndpoint,
+                                                         Span<DataVersion>(sDataVersions),
+                                                         Span<const EmberAfDeviceType>(sDeviceTypes));
+        if (status != EMBER_ZCL_STATUS_SUCCESS) {
+                LOG_ERR("emberAfSetDynamicEndpoint() failed: %d", status);
+                return CHIP_ERROR_INTERNAL;
+        }
+
+        return CHIP_NO_ERROR;
+}
@@ -0,0 +1,110 @@
+/* ****************************************************************************
+ *
+ *  TERRARIUM SERVICE ENDPOINT - terrarium_endpoint.cpp
+ *
+ * The fixed endpoints come from the ZAP file and only carry standard
+ * clusters. The device specific information is served by manufacturer
+ * specific clusters (test vendor prefix 0xFFF1) on a dynamic endpoint,
+ * registered at boot after the fixed ones:
+ *
+ * Terrarium Diagnostics (0xFFF1FC00):
+ *   0x0000 EventCounters: list of { 0: event type, 1: posted, 2: dropped,
+ *                          3: coalesced, 4: dispatched }
+ *   0x0001 QueueHighWaterMarks: list of uint32, one per AppEventClass
+ *   0x0002 DispatchTimeHistogram: list of uint32, see app_event_stats.h
+ *   0x0003 PublishCounters: list of { 0: endpoint, 1: published,
+ *                            2: suppressed }, see measurement_publisher.h
+ *   0x0004 SensorHealth: list of { 0: SensorId, 1: probe, 2: SensorState,
+ *                         3: failures in a row, 4: failures, 5: faults,
+ *                         6: k_uptime_get() of the last successful
+ *                         acquisition, null if none }, see sensor_health.h
+ *   0x0005 InterlockAlarms: list of { 0: rule, 1: latched, 2: condition
+ *                            present, 3: trips, 4: forced actuator
+ *                            endpoint, 5: worst-case reaction ms }, see
+ *                            interlocks.h
+ *
+ * Terrarium History (0xFFF1FC01), with the flash log only (see flash_log.h):
+ *   0x0000 LogTime: current log time in seconds, the time base of the
+ *                   history, to map it onto the wall clock
+ *   Command 0x00 GetHistory { 0: channel (HistoryChannel), 1: from,
+ *                2: to (log times, inclusive), 3: resolution (0: raw
+ *                samples, 1: minute, 2: hour, 3: day rollups),
+ *                4: cursor (optional) }
+ *   Command 0x01 GetHistoryResponse { 0: channel, 1: resolution,
+ *                2: points, 3: next cursor (nullable) }
+ *       A raw point is { 0: time, 1: value }, a rollup point is
+ *       { 0: period start, 1: mean, 2: min, 3: max, 4: count }, values in
+ *       Matter units. A response holds at most 64 raw or 32 rollup
+ *       points, a non-null next cursor means the range goes on: send the
+ *       same GetHistory again with this cursor to get the next chunk.
+ *
+ * Terrarium Snapshot (0xFFF1FC02), see terrarium_snapshot.h:
+ *   0x0000 Snapshot: { 0: cycle, 1: Hot-Spot temperature, 2: Hot-Spot
+ *                    humidity, 3: Cold-Zone temperature, 4: Cold-Zone
+ *                    humidity, 5: water temperature (nullable, Matter
+ *                    units), 6: sample times (list of systime-ms, one per
+ *                    sensor: Hot-Spot, Cold-Zone, water), 7: actuator
+ *                    states (bitmap8, bit 0 is endpoint 2), 8: sensor
+ *                    faults (bitmap8, bit per sensor, set when its last
+ *                    acquisition failed) }
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <lib/core/CHIPError.h>
+#include <lib/core/DataModelTypes.h>
+
+namespace TerrariumClusters
+{
+namespace Diagnostics
+{
+        constexpr chip::ClusterId Id = 0xFFF1FC00;
+
+        namespace Attributes
+        {
+                constexpr chip::AttributeId EventCounters = 0x0000;
+                constexpr chip::AttributeId QueueHighWaterMarks = 0x0001;
+                constexpr chip::AttributeId DispatchTimeHistogram = 0x0002;
+                constexpr chip::AttributeId PublishCounters = 0x0003;
+                constexpr chip::AttributeId SensorHealth = 0x0004;
+                constexpr chip::AttributeId InterlockAlarms = 0x0005;
+        } /* namespace Attributes */
+} /* namespace Diagnostics */
+
+namespace History
+{
+        constexpr chip::ClusterId Id = 0xFFF1FC01;
+
+        namespace Attributes
+        {
+                constexpr chip::AttributeId LogTime = 0x0000;
+        } /* namespace Attributes */
+
+        namespace Commands
+        {
+                constexpr chip::CommandId GetHistory = 0x00;
+                constexpr chip::CommandId GetHistoryResponse = 0x01;
+        } /* namespace Commands */
+
+        enum class Resolution : uint8_t { Raw = 0, Minute, Hour, Day };
+} /* namespace History */
+
+namespace Snapshot
+{
+        constexpr chip::ClusterId Id = 0xFFF1FC02;
+
+        namespace Attributes
+        {
+                constexpr chip::AttributeId Snapshot = 0x0000;
+        } /* namespace Attributes */
+} /* namespace Snapshot */
+} /* namespace TerrariumClusters */
+
+class TerrariumEndpoint {
+public:
+        /* First endpoint after the FIXED_ENDPOINT_COUNT fixed ones */
+        static constexpr chip::EndpointId kEndpointId = 12;
+
+        static CHIP_ERROR Init();
+};
@@ -0,0 +1,73 @@
+#include "terrarium_snapshot.h"
+#include "actuators.h"
+#include "attribute_batcher.h"
+
+#include <zephyr/kernel.h>
+
+namespace
+{
+static_assert(SensorHistory::kChannelCount <= 8 && TerrariumSnapshot::kSensorCount <= 8 &&
+                      Actuators::kMaxActuators <= 8,
+              "the snapshot bitmaps are 8 bit wide");
+
+/* Only used by the AppTask */
+TerrariumSnapshot::Snapshot sStaging;
+
+/* Copied in and out under the spinlock, never torn */
+k_spinlock sLock;
+TerrariumSnapshot::Snapshot sPublished;
+
+void Publish()
+{
+        sStaging.Cycle++;
+        sStaging.ActuatorStates = 0;
+        for (size_t i = 0; i < Actuators::Count(); i++) {
+                const ActuatorDescriptor *actuator = Actuators::Find(Actuators::kFirstActuatorEndpoint + i);
+                if (actuator && Actuators::IsOn(*actuator)) {
+                        sStaging.ActuatorStates |= BIT(i);
+                }
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        sPublished = sStaging;
+        k_spin_unlock(&sLock, key);
+
+        AttributeBatcher::ReportSnapshot();
+}
+} /* namespace */
+
+void TerrariumSnapshot::SetMeasurement(HistoryChannel channel, int16_t value)
+{
+        const size_t index = static_cast<size_t>(channel);
+
+        sStaging.Values[index] = value;
+        sStaging.ValidValues |= BIT(index);
+}
+
+void TerrariumSnapshot::ClearMeasurement(HistoryChannel channel)
+{
+        WRITE_BIT(sStaging.ValidValues, static_cast<size_t>(channel), 0);
+}
+
+void TerrariumSnapshot::SampleDone(const SensorSample &sample)
+{
+        const size_t index = static_cast<size_t>(sample.Sensor);
+
+        if (sample.Probe == 0) {
+                sStaging.SampleTimesMs[index] = sample.Timestamp;
+                WRITE_BIT(sStaging.SensorFaults, index, sample.Result != 0);
+        }
+
+        if (sample.EndOfCycle) {
+                Publish();
+        }
+}
+
+TerrariumSnapshot::Snapshot TerrariumSnapshot::Get()
+{
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        const Snapshot snapshot = sPublished;
+        k_spin_unlock(&sLock, key);
+
+        return snapshot;
+}
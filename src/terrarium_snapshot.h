@@ -0,0 +1,57 @@
+/* ****************************************************************************
+ *
+ *  TERRARIUM SNAPSHOT - terrarium_snapshot.cpp
+ *
+ * Consistent picture of the whole terrarium, served as a single struct
+ * attribute (see terrarium_endpoint.h), so that a controller gets every
+ * measurement, actuator state and sensor fault in one read or one
+ * subscription instead of ten attribute reads that may straddle a sample.
+ *
+ * The AppTask fills a staging copy while it handles the samples of the
+ * sensors acquired together, and publishes it in one go when the last of
+ * them (SensorSample::EndOfCycle) is handled. The
+ * attribute report goes through the AttributeBatcher, in the same batch as
+ * the measured values of the cycle.
+ *
+ * SetMeasurement: stage a successful measurement, AppTask only
+ * ClearMeasurement: stage a null measurement, for a failed sensor, AppTask
+ *                   only
+ * SampleDone: stage the outcome of a sensor acquisition, and publish the
+ *             snapshot at the end of the cycle, AppTask only. Only the
+ *             first DS18B20 probe, the water probe, is part of the snapshot
+ * Get: last published snapshot, from any thread
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include "sensor_history.h"
+#include "sensor_task.h"
+
+#include <cstddef>
+#include <cstdint>
+
+class TerrariumSnapshot {
+public:
+        static constexpr size_t kSensorCount = static_cast<size_t>(SensorId::Count);
+
+        struct Snapshot {
+                /* Number of published snapshots */
+                uint32_t Cycle;
+                /* Matter units, per HistoryChannel */
+                int16_t Values[SensorHistory::kChannelCount];
+                /* Bit per HistoryChannel with a value, cleared while its sensor is failed */
+                uint8_t ValidValues;
+                /* k_uptime_get() of the last acquisition, per SensorId */
+                int64_t SampleTimesMs[kSensorCount];
+                /* Bit per actuator, from kFirstActuatorEndpoint, set when On */
+                uint8_t ActuatorStates;
+                /* Bit per SensorId, set when its last acquisition failed */
+                uint8_t SensorFaults;
+        };
+
+        static void SetMeasurement(HistoryChannel channel, int16_t value);
+        static void ClearMeasurement(HistoryChannel channel);
+        static void SampleDone(const SensorSample &sample);
+        static Snapshot Get();
+};
@@ -0,0 +1,216 @@
+/* ****************************************************************************
+ *
+ *  TIME SERIES - time_series.h
+ *
+ * Fixed-capacity history of a periodically sampled int16 channel, in a ring
+ * of kBlocks blocks of kBlockBytes bytes. The first sample of a block is a
+ * keyframe holding the absolute value, the next ones only take one byte,
+ * the 8 bit delta to the previous sample, so a block can be decoded on its
+ * own and the oldest block can be recycled without touching the others. A
+ * delta out of the 8 bit range escapes to an inline keyframe, a marker byte
+ * followed by the absolute value, so no sample is ever clamped. The sample
+ * timestamps are implied by the block start and the sampling period, a
+ * missed sample is stored as a gap marker byte and a longer interruption
+ * starts a new block.
+ *
+ * A block holds up to kBlockBytes + 1 samples, less when the channel moves
+ * faster than the 8 bit deltas and escapes, down to kBlockBytes / 3 + 1
+ * when every sample escapes.
+ *
+ * The class is not thread safe, see sensor_history.h for the locking.
+ *
+ * Append: add the sample taken at timestampMs
+ * Begin: iterator from the oldest sample still stored
+ * Seek: iterator from the first sample taken at or after fromMs
+ * Iterator::Next: decode the next sample, false at the end of the history,
+ *                 the gaps are skipped
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+template <size_t kBlocks, size_t kBlockBytes = 64> class TimeSeries {
+        static_assert(kBlocks >= 2, "TimeSeries needs at least two blocks");
+        static_assert(kBlockBytes >= 3 && kBlockBytes < UINT16_MAX, "invalid TimeSeries block size");
+
+        /* Codes of the delta bytes, the other values are the deltas */
+        static constexpr uint8_t kGapCode = 0x80;
+        static constexpr uint8_t kKeyframeCode = 0x81;
+        static constexpr int32_t kMinDelta = -126;
+        static constexpr int32_t kMaxDelta = 127;
+        static constexpr size_t kKeyframeBytes = 3;
+
+public:
+        static constexpr size_t kMaxBlockSamples = kBlockBytes + 1;
+
+        /* Samples a block holds when escapePercent % of its deltas escape */
+        static constexpr size_t BlockSamples(size_t escapePercent)
+        {
+                return 1 + kBlockBytes * 100 / (100 + (kKeyframeBytes - 1) * escapePercent);
+        }
+
+        struct Point {
+                int64_t TimestampMs;
+                int16_t Value;
+        };
+
+        class Iterator {
+        public:
+                constexpr bool Next(Point &point)
+                {
+                        while (true) {
+                                /* Restart from the oldest block if ours has been recycled */
+                                if (mSeq < mSeries->OldestSeq()) {
+                                        mSeq = mSeries->OldestSeq();
+                                        mIndex = 0;
+                                        mOffset = 0;
+                                }
+                                if (mSeq >= mSeries->mNextSeq) {
+                                        return false;
+                                }
+
+                                const Block &block = mSeries->BlockAt(mSeq);
+                                if (mIndex >= block.Count) {
+                                        if (mSeq + 1 == mSeries->mNextSeq) {
+                                                return false;
+                                        }
+                                        mSeq++;
+                                        mIndex = 0;
+                                        mOffset = 0;
+                                        continue;
+                                }
+
+                                const int64_t timestamp = block.StartMs + int64_t(mIndex) * mSeries->mPeriodMs;
+                                bool gap = false;
+
+                                if (mIndex == 0) {
+                                        mValue = block.Key;
+                                } else {
+                                        const uint8_t code = block.Bytes[mOffset++];
+                                        if (code == kGapCode) {
+                                                gap = true;
+                                        } else if (code == kKeyframeCode) {
+                                                mValue = static_cast<int16_t>(block.Bytes[mOffset] |
+                                                                              block.Bytes[mOffset + 1] << 8);
+                                                mOffset += 2;
+                                        } else {
+                                                mValue = static_cast<int16_t>(mValue + static_cast<int8_t>(code));
+                                        }
+                                }
+                                mIndex++;
+
+                                if (gap || timestamp < mFromMs) {
+                                        continue;
+                                }
+
+                                point = { timestamp, mValue };
+                                return true;
+                        }
+                }
+
+        private:
+                friend class TimeSeries;
+
+                constexpr Iterator(const TimeSeries &series, uint32_t seq, int64_t fromMs)
+                        : mSeries(&series), mSeq(seq), mFromMs(fromMs)
+                {
+                }
+
+                const TimeSeries *mSeries;
+                uint32_t mSeq;
+                size_t mIndex = 0;
+                size_t mOffset = 0;
+                int64_t mFromMs;
+                int16_t mValue = 0;
+        };
+
+        explicit constexpr TimeSeries(uint32_t periodMs) : mPeriodMs(periodMs) {}
+
+        constexpr void Append(int64_t timestampMs, int16_t value)
+        {
+                if (mNextSeq != 0) {
+                        Block &block = BlockAt(mNextSeq - 1);
+                        int64_t slot = (timestampMs - block.StartMs + mPeriodMs / 2) / mPeriodMs;
+
+                        /* An early sample still takes the next slot */
+                        if (slot < block.Count) {
+                                slot = block.Count;
+                        }
+
+                        const int32_t delta = int32_t(value) - block.Last;
+                        const bool small = delta >= kMinDelta && delta <= kMaxDelta;
+                        const int64_t needed = (slot - block.Count) + (small ? 1 : kKeyframeBytes);
+
+                        if (needed <= static_cast<int64_t>(kBlockBytes - block.Used)) {
+                                while (block.Count < slot) {
+                                        block.Bytes[block.Used++] = kGapCode;
+                                        block.Count++;
+                                }
+
+                                if (small) {
+                                        block.Bytes[block.Used++] = static_cast<uint8_t>(delta);
+                                } else {
+                                        const uint16_t raw = static_cast<uint16_t>(value);
+                                        block.Bytes[block.Used++] = kKeyframeCode;
+                                        block.Bytes[block.Used++] = static_cast<uint8_t>(raw);
+                                        block.Bytes[block.Used++] = static_cast<uint8_t>(raw >> 8);
+                                }
+                                block.Count++;
+                                block.Last = value;
+                                return;
+                        }
+                }
+
+                Block &block = BlockAt(mNextSeq);
+                block.StartMs = timestampMs;
+                block.Key = value;
+                block.Last = value;
+                block.Count = 1;
+                block.Used = 0;
+                mNextSeq++;
+        }
+
+        constexpr Iterator Begin() const { return Iterator(*this, OldestSeq(), INT64_MIN); }
+
+        constexpr Iterator Seek(int64_t fromMs) const
+        {
+                /* Binary search of the last block starting at or before fromMs */
+                uint32_t low = OldestSeq();
+                uint32_t high = mNextSeq;
+
+                while (high - low > 1) {
+                        const uint32_t middle = low + (high - low) / 2;
+                        if (BlockAt(middle).StartMs <= fromMs) {
+                                low = middle;
+                        } else {
+                                high = middle;
+                        }
+                }
+
+                return Iterator(*this, low, fromMs);
+        }
+
+private:
+        struct Block {
+                int64_t StartMs;
+                /* Samples, the keyframe and the gaps included, and delta bytes */
+                uint16_t Count;
+                uint16_t Used;
+                int16_t Key;
+                /* Value of the last sample, the base of the next delta */
+                int16_t Last;
+                uint8_t Bytes[kBlockBytes];
+        };
+
+        constexpr uint32_t OldestSeq() const { return mNextSeq > kBlocks ? mNextSeq - kBlocks : 0; }
+        constexpr Block &BlockAt(uint32_t seq) { return mBlocks[seq % kBlocks]; }
+        constexpr const Block &BlockAt(uint32_t seq) const { return mBlocks[seq % kBlocks]; }
+
+        uint32_t mPeriodMs;
+        /* Sequence number of the next block, the blocks ever started */
+        uint32_t mNextSeq = 0;
+        Block mBlocks[kBlocks] = {};
+};
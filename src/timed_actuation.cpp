@@ -0,0 +1,442 @@
+#include "timed_actuation.h"
+#include "actuators.h"
+#include "app_event_queue.h"
+#include "app_task.h"
+#include "attribute_batcher.h"
+#include "timer_wheel.h"
+
+#include <app-common/zap-generated/cluster-objects.h>
+#include <app-common/zap-generated/ids/Attributes.h>
+#include <app-common/zap-generated/ids/Clusters.h>
+#include <app/AttributeAccessInterface.h>
+#include <app/CommandHandlerInterface.h>
+#include <app/InteractionModelEngine.h>
+#include <app/reporting/reporting.h>
+#include <app/util/attribute-storage.h>
+#include <lib/support/CodeUtils.h>
+#include <platform/CHIPDeviceLayer.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip;
+using namespace ::chip::app;
+using namespace ::chip::app::Clusters;
+using namespace ::chip::DeviceLayer;
+using Protocols::InteractionModel::Status;
+
+namespace
+{
+using OnWithTimedOffRequest = OnOff::Commands::OnWithTimedOff::DecodableType;
+
+/* 64^3 ticks of 1/10 s, about 7 h */
+using Wheel = TimerWheel<3, Actuators::kMaxActuators>;
+
+/* The wheel may lag the uptime by up to one level 0 turn, plus the latency
+ * of the timer event, on top of the longest OnTime */
+static_assert(Wheel::kMaxDelayTicks >= TimedActuation::kNoCountdown + 2 * 64,
+              "the timer wheel must cover the whole OnTime range");
+
+enum class CountdownPhase : uint8_t { Idle = 0, On, OffWait };
+
+struct Countdown {
+        CountdownPhase Phase;
+        /* Attribute values while they are not counting down */
+        uint16_t OnTime;
+        uint16_t OffWaitTime;
+};
+
+/* The wheel and the countdowns are only changed by the app task, the lock
+ * keeps their reads from the Matter thread consistent */
+k_spinlock sLock;
+Wheel sWheel;
+Countdown sCountdowns[Actuators::kMaxActuators];
+/* Uptime of the wheel tick 0 */
+int64_t sBaseMs;
+k_timer sWheelTimer;
+
+/* Ticks elapsed since the wheel was last advanced */
+uint32_t Lag()
+{
+        return static_cast<uint32_t>((k_uptime_get() - sBaseMs) / TimedActuation::kTickMs) - sWheel.Now();
+}
+
+uint16_t Remaining(size_t index)
+{
+        const uint32_t remaining = sWheel.Remaining(index);
+        const uint32_t lag = Lag();
+
+        return static_cast<uint16_t>(remaining > lag ? MIN(remaining - lag, TimedActuation::kNoCountdown - 1) : 0);
+}
+
+constexpr bool Counts(uint16_t time)
+{
+        return time != 0 && time != TimedActuation::kNoCountdown;
+}
+
+/* The attributes are reported from the Matter thread */
+void ReportTimes(intptr_t endpoint)
+{
+        MatterReportingAttributeChangeCallback(static_cast<EndpointId>(endpoint), OnOff::Id,
+                                               OnOff::Attributes::OnTime::Id);
+        MatterReportingAttributeChangeCallback(static_cast<EndpointId>(endpoint), OnOff::Id,
+                                               OnOff::Attributes::OffWaitTime::Id);
+}
+
+/* Called with sLock held */
+void Arm(const ActuatorDescriptor &actuator, CountdownPhase phase, uint16_t ticks)
+{
+        const size_t index = Actuators::IndexOf(actuator);
+
+        /* An idle wheel is not advanced, it restarts from the current time */
+        if (!sWheel.TicksToNext()) {
+                sBaseMs = k_uptime_get() - static_cast<int64_t>(sWheel.Now()) * TimedActuation::kTickMs;
+        }
+        sWheel.Schedule(index, ticks + Lag());
+        sCountdowns[index].Phase = phase;
+}
+
+/* Called with sLock held */
+void Disarm(const ActuatorDescriptor &actuator)
+{
+        const size_t index = Actuators::IndexOf(actuator);
+
+        sWheel.Cancel(index);
+        sCountdowns[index].Phase = CountdownPhase::Idle;
+}
+
+/* Start the OnTime countdown of an actuator that is On, called with sLock
+ * held */
+void StartOnTime(const ActuatorDescriptor &actuator)
+{
+        Countdown &countdown = sCountdowns[Actuators::IndexOf(actuator)];
+
+        if (actuator.MonostableTimeoutMs) {
+                const uint16_t timeout = static_cast<uint16_t>(
+                        DIV_ROUND_UP(actuator.MonostableTimeoutMs, TimedActuation::kTickMs));
+                countdown.OnTime = Counts(countdown.OnTime) ? MIN(countdown.OnTime, timeout) : timeout;
+        }
+
+        if (Counts(countdown.OnTime)) {
+                Arm(actuator, CountdownPhase::On, countdown.OnTime);
+        } else {
+                Disarm(actuator);
+        }
+}
+
+/* Wake up for the next expiry or cascade of the wheel, if any */
+void StartWheelTimer()
+{
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        const uint32_t ticks = sWheel.TicksToNext();
+        const int64_t deadline = sBaseMs + static_cast<int64_t>(sWheel.Now() + ticks) * TimedActuation::kTickMs;
+        k_spin_unlock(&sLock, key);
+
+        if (ticks) {
+                k_timer_start(&sWheelTimer, K_MSEC(MAX(deadline - k_uptime_get(), 0)), K_NO_WAIT);
+        } else {
+                k_timer_stop(&sWheelTimer);
+        }
+}
+
+/* Once the countdowns of an actuator changed, with sLock released */
+void Changed(const ActuatorDescriptor &actuator)
+{
+        PlatformMgr().ScheduleWork(ReportTimes, actuator.Endpoint);
+        StartWheelTimer();
+}
+
+/* Actuators switched Off when their OnTime expires, or back to Idle at the
+ * end of their OffWait. The expired ones are only collected while the lock
+ * is held, they are switched once it is released */
+struct Expiry {
+        static_assert(Actuators::kMaxActuators <= 32, "the expired actuators are collected in a 32 bit mask");
+
+        uint32_t Expired;
+
+        void operator()(size_t index) { Expired |= BIT(index); }
+};
+
+void Expire(const ActuatorDescriptor &actuator)
+{
+        Countdown &countdown = sCountdowns[Actuators::IndexOf(actuator)];
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        const CountdownPhase phase = countdown.Phase;
+        countdown.Phase = CountdownPhase::Idle;
+        countdown.OnTime = 0;
+        countdown.OffWaitTime = 0;
+        k_spin_unlock(&sLock, key);
+
+        if (phase == CountdownPhase::On) {
+                LOG_INF("%s OnTime expired, switched Off", actuator.Name);
+                Actuators::Stage(actuator, false);
+                AttributeBatcher::SetOnOff(actuator.Endpoint, false);
+        }
+        PlatformMgr().ScheduleWork(ReportTimes, actuator.Endpoint);
+}
+
+void WheelEventHandler(const AppEvent &)
+{
+        Expiry expiry = { 0 };
+
+        /* An idle wheel is rebased rather than advanced, see Arm */
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        if (sWheel.TicksToNext()) {
+                sWheel.Advance(Lag(), expiry);
+        }
+        k_spin_unlock(&sLock, key);
+
+        if (expiry.Expired) {
+                for (size_t i = 0; i < Actuators::Count(); i++) {
+                        if (expiry.Expired & BIT(i)) {
+                                Expire(*Actuators::Find(Actuators::kFirstActuatorEndpoint + i));
+                        }
+                }
+                /* The actuators expired by the same wakeup switch together */
+                Actuators::Commit();
+        }
+
+        StartWheelTimer();
+}
+
+/* The wheel is advanced from the app task, not from the timer ISR. Only
+ * WheelEventHandler restarts the timer, so a wakeup that cannot be queued
+ * is retried one tick later rather than lost */
+void WheelTimerHandler(k_timer *)
+{
+        AppEvent event;
+        event.Type = AppEventType::TimedActuationWheel;
+        event.TimerEvent.Context = nullptr;
+        event.Handler = WheelEventHandler;
+        if (!AppEventQueue::Post(event)) {
+                k_timer_start(&sWheelTimer, K_MSEC(TimedActuation::kTickMs), K_NO_WAIT);
+        }
+}
+
+void OnWithTimedOff(const ActuatorDescriptor &actuator, bool acceptOnlyWhenOn, uint16_t onTime,
+                    uint16_t offWaitTime)
+{
+        const bool on = Actuators::IsOn(actuator);
+        Countdown &countdown = sCountdowns[Actuators::IndexOf(actuator)];
+
+        if (acceptOnlyWhenOn && !on) {
+                return;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        if (!on && countdown.Phase == CountdownPhase::OffWait) {
+                /* The guard can only be shortened while it runs */
+                countdown.OffWaitTime = MIN(Remaining(Actuators::IndexOf(actuator)), offWaitTime);
+                if (countdown.OffWaitTime) {
+                        Arm(actuator, CountdownPhase::OffWait, countdown.OffWaitTime);
+                } else {
+                        Disarm(actuator);
+                }
+                k_spin_unlock(&sLock, key);
+                Changed(actuator);
+                return;
+        }
+
+        const uint16_t current =
+                countdown.Phase == CountdownPhase::On ? Remaining(Actuators::IndexOf(actuator)) : countdown.OnTime;
+        countdown.OnTime = MAX(current, onTime);
+        countdown.OffWaitTime = offWaitTime;
+        if (on) {
+                StartOnTime(actuator);
+        }
+        k_spin_unlock(&sLock, key);
+
+        /* Staging the actuator On starts its OnTime, see Staged */
+        if (!on) {
+                Actuators::Apply(actuator, true);
+                AttributeBatcher::SetOnOff(actuator.Endpoint, Actuators::IsOn(actuator));
+        }
+        Changed(actuator);
+}
+
+void WriteOnTime(const ActuatorDescriptor &actuator, uint16_t onTime)
+{
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        sCountdowns[Actuators::IndexOf(actuator)].OnTime = onTime;
+        if (Actuators::IsOn(actuator)) {
+                StartOnTime(actuator);
+        }
+        k_spin_unlock(&sLock, key);
+
+        Changed(actuator);
+}
+
+void WriteOffWaitTime(const ActuatorDescriptor &actuator, uint16_t offWaitTime)
+{
+        Countdown &countdown = sCountdowns[Actuators::IndexOf(actuator)];
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        countdown.OffWaitTime = offWaitTime;
+        if (countdown.Phase == CountdownPhase::OffWait) {
+                if (offWaitTime) {
+                        Arm(actuator, CountdownPhase::OffWait, offWaitTime);
+                } else {
+                        Disarm(actuator);
+                }
+        }
+        k_spin_unlock(&sLock, key);
+
+        Changed(actuator);
+}
+
+void PostRequest(EndpointId endpoint, TimedActuationRequest request, bool acceptOnlyWhenOn, uint16_t onTime,
+                 uint16_t offWaitTime)
+{
+        AppEvent event;
+        event.Type = AppEventType::TimedActuation;
+        event.TimedActuationEvent.Endpoint = endpoint;
+        event.TimedActuationEvent.Request = static_cast<uint8_t>(request);
+        event.TimedActuationEvent.AcceptOnlyWhenOn = acceptOnlyWhenOn;
+        event.TimedActuationEvent.OnTime = onTime;
+        event.TimedActuationEvent.OffWaitTime = offWaitTime;
+        event.Handler = TimedActuation::RequestHandler;
+        AppTask::PostEvent(event);
+}
+
+/* OnWithTimedOff on the actuator endpoints, the other OnOff commands and
+ * endpoints are left to the OnOff cluster server */
+class OnOffCommandHandler : public CommandHandlerInterface {
+public:
+        OnOffCommandHandler() : CommandHandlerInterface(Optional<EndpointId>::Missing(), OnOff::Id) {}
+
+        void InvokeCommand(HandlerContext &context) override
+        {
+                if (context.mRequestPath.mCommandId != OnOff::Commands::OnWithTimedOff::Id ||
+                    !Actuators::Find(context.mRequestPath.mEndpointId)) {
+                        return;
+                }
+
+                HandleCommand<OnWithTimedOffRequest>(
+                        context, [](HandlerContext &ctx, const OnWithTimedOffRequest &request) {
+                                PostRequest(ctx.mRequestPath.mEndpointId, TimedActuationRequest::OnWithTimedOff,
+                                            request.onOffControl.Has(OnOff::OnOffControl::kAcceptOnlyWhenOn),
+                                            request.onTime, request.offWaitTime);
+                                ctx.mCommandHandler.AddStatus(ctx.mRequestPath, Status::Success);
+                                ctx.SetCommandHandled();
+                        });
+        }
+};
+
+/* OnTime and OffWaitTime of the actuator endpoints, the other attributes
+ * and endpoints fall back to the attribute storage */
+class OnOffAttrAccess : public AttributeAccessInterface {
+public:
+        OnOffAttrAccess() : AttributeAccessInterface(Optional<EndpointId>::Missing(), OnOff::Id) {}
+
+        CHIP_ERROR Read(const ConcreteReadAttributePath &aPath, AttributeValueEncoder &aEncoder) override
+        {
+                const ActuatorDescriptor *actuator = Actuators::Find(aPath.mEndpointId);
+
+                if (!actuator) {
+                        return CHIP_NO_ERROR;
+                }
+
+                switch (aPath.mAttributeId) {
+                case OnOff::Attributes::OnTime::Id:
+                        return aEncoder.Encode(TimedActuation::GetTimes(*actuator).OnTime);
+                case OnOff::Attributes::OffWaitTime::Id:
+                        return aEncoder.Encode(TimedActuation::GetTimes(*actuator).OffWaitTime);
+                default:
+                        return CHIP_NO_ERROR;
+                }
+        }
+
+        CHIP_ERROR Write(const ConcreteDataAttributePath &aPath, AttributeValueDecoder &aDecoder) override
+        {
+                uint16_t value;
+
+                if (!Actuators::Find(aPath.mEndpointId)) {
+                        return CHIP_NO_ERROR;
+                }
+
+                switch (aPath.mAttributeId) {
+                case OnOff::Attributes::OnTime::Id:
+                        ReturnErrorOnFailure(aDecoder.Decode(value));
+                        PostRequest(aPath.mEndpointId, TimedActuationRequest::WriteOnTime, false, value, 0);
+                        return CHIP_NO_ERROR;
+                case OnOff::Attributes::OffWaitTime::Id:
+                        ReturnErrorOnFailure(aDecoder.Decode(value));
+                        PostRequest(aPath.mEndpointId, TimedActuationRequest::WriteOffWaitTime, false, 0, value);
+                        return CHIP_NO_ERROR;
+                default:
+                        return CHIP_NO_ERROR;
+                }
+        }
+};
+
+OnOffCommandHandler sOnOffCommandHandler;
+OnOffAttrAccess sOnOffAttrAccess;
+} /* namespace */
+
+CHIP_ERROR TimedActuation::Init()
+{
+        k_timer_init(&sWheelTimer, WheelTimerHandler, nullptr);
+        sBaseMs = k_uptime_get();
+
+        registerAttributeAccessOverride(&sOnOffAttrAccess);
+        return InteractionModelEngine::GetInstance()->RegisterCommandHandler(&sOnOffCommandHandler);
+}
+
+void TimedActuation::Staged(const ActuatorDescriptor &actuator, bool on)
+{
+        Countdown &countdown = sCountdowns[Actuators::IndexOf(actuator)];
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        if (on) {
+                StartOnTime(actuator);
+        } else {
+                countdown.OnTime = 0;
+                if (countdown.OffWaitTime) {
+                        Arm(actuator, CountdownPhase::OffWait, countdown.OffWaitTime);
+                } else {
+                        Disarm(actuator);
+                }
+        }
+        k_spin_unlock(&sLock, key);
+
+        Changed(actuator);
+}
+
+void TimedActuation::RequestHandler(const AppEvent &event)
+{
+        const ActuatorDescriptor *actuator = Actuators::Find(event.TimedActuationEvent.Endpoint);
+
+        if (!actuator) {
+                return;
+        }
+
+        switch (static_cast<TimedActuationRequest>(event.TimedActuationEvent.Request)) {
+        case TimedActuationRequest::OnWithTimedOff:
+                OnWithTimedOff(*actuator, event.TimedActuationEvent.AcceptOnlyWhenOn, event.TimedActuationEvent.OnTime,
+                               event.TimedActuationEvent.OffWaitTime);
+                break;
+        case TimedActuationRequest::WriteOnTime:
+                WriteOnTime(*actuator, event.TimedActuationEvent.OnTime);
+                break;
+        case TimedActuationRequest::WriteOffWaitTime:
+                WriteOffWaitTime(*actuator, event.TimedActuationEvent.OffWaitTime);
+                break;
+        }
+}
+
+TimedActuation::Times TimedActuation::GetTimes(const ActuatorDescriptor &actuator)
+{
+        const size_t index = Actuators::IndexOf(actuator);
+        Times times;
+
+        k_spinlock_key_t key = k_spin_lock(&sLock);
+        const Countdown &countdown = sCountdowns[index];
+        times.OnTime = countdown.Phase == CountdownPhase::On ? Remaining(index) : countdown.OnTime;
+        times.OffWaitTime = countdown.Phase == CountdownPhase::OffWait ? Remaining(index) : countdown.OffWaitTime;
+        k_spin_unlock(&sLock, key);
+
+        return times;
+}
@@ -0,0 +1,62 @@
+/* ****************************************************************************
+ *
+ *  TIMED ACTUATION - timed_actuation.cpp
+ *
+ * OnOff cluster timing (OnTime, OffWaitTime and the OnWithTimedOff command)
+ * for every actuator endpoint, see actuators.h. The countdowns of all the
+ * actuators share a single TimerWheel (see timer_wheel.h) ticking in
+ * 1/10 s, the unit of the OnOff attributes, driven by one k_timer that is
+ * only started up to the next expiry. The timer ISR only posts an event,
+ * the wheel is advanced and the expired actuators are switched Off on the
+ * app task, like every other actuator change.
+ *
+ *   On: OnTime counts down while the actuator is On, and switches it Off
+ *       when it reaches 0. 0 and 0xFFFF mean no countdown
+ *   OffWait: once switched Off, OffWaitTime counts down, and
+ *            OnWithTimedOff commands may only shorten it meanwhile
+ *
+ * OnWithTimedOff: discarded while Off if AcceptOnlyWhenOn is set, only
+ *                 lowers OffWaitTime during an OffWait, otherwise raises
+ *                 OnTime to the command one, sets OffWaitTime and switches
+ *                 the actuator On
+ * Monostable actuators (MonostableTimeoutMs) get their timeout as OnTime
+ * whenever switched On, a longer OnTime is cut down to it.
+ *
+ * Init: register the OnOff command handler and attribute access, after the
+ *       Matter server
+ * Staged: called by Actuators::Stage when an actuator changes state, to
+ *         start or stop its countdowns, from the app task
+ * RequestHandler: apply an OnWithTimedOff command or an OnTime/OffWaitTime
+ *                 write posted by the Matter thread, on the app task
+ * GetTimes: current OnTime and OffWaitTime of an actuator, from any thread
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+
+#include <lib/core/CHIPError.h>
+
+struct ActuatorDescriptor;
+struct AppEvent;
+
+enum class TimedActuationRequest : uint8_t { OnWithTimedOff = 0, WriteOnTime, WriteOffWaitTime };
+
+class TimedActuation {
+public:
+        /* 1/10 s, the OnOff cluster time unit */
+        static constexpr uint32_t kTickMs = 100;
+        /* OnTime of an actuator On without countdown */
+        static constexpr uint16_t kNoCountdown = 0xFFFF;
+
+        struct Times {
+                uint16_t OnTime;
+                uint16_t OffWaitTime;
+        };
+
+        static CHIP_ERROR Init();
+        static void Staged(const ActuatorDescriptor &actuator, bool on);
+        static void RequestHandler(const AppEvent &event);
+        static Times GetTimes(const ActuatorDescriptor &actuator);
+};
@@ -0,0 +1,163 @@
+/* ****************************************************************************
+ *
+ *  TIMER WHEEL - timer_wheel.h
+ *
+ * Hierarchical timer wheel for a fixed set of kTimers timers, identified by
+ * their index, so that any number of timeouts share a single kernel timer.
+ * Each of the kLevels levels has 64 slots, a slot of level L spanning 64^L
+ * ticks: a timer due within 64 ticks sits in the level 0 slot of its
+ * expiry tick, a later one in the slot of a higher level, and is cascaded
+ * down every time the lower level wraps around. Scheduling and cancelling
+ * are O(1) doubly linked list operations, and the expiry of a tick only
+ * touches the timers due at that tick or cascaded at it.
+ *
+ * The wheel has no notion of time itself, the owner advances it by whole
+ * ticks and only needs to wake up after TicksToNext ticks.
+ *
+ * Schedule: (re)arm a timer to expire after delay ticks, at least 1 and at
+ *           most kMaxDelayTicks
+ * Cancel: disarm a timer, if armed
+ * Armed/Remaining: whether a timer is armed, and the ticks before it expires
+ * Now: ticks advanced since the wheel was created
+ * Advance: move the time forward by some ticks, calling expire(id) for
+ *          every timer due on the way, in expiry order. The callback may
+ *          schedule timers again
+ * TicksToNext: ticks before the next expiry or cascade, 0 when idle
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+template <size_t kLevels, size_t kTimers> class TimerWheel {
+        static_assert(kLevels >= 1 && kLevels <= 5, "the expiry ticks must fit in 32 bits");
+        static_assert(kTimers >= 1 && kTimers < UINT8_MAX, "the timers are linked by 8 bit indexes");
+
+        static constexpr size_t kSlotBits = 6;
+        static constexpr size_t kSlots = 1 << kSlotBits;
+        static constexpr uint32_t kSlotMask = kSlots - 1;
+
+public:
+        static constexpr uint32_t kMaxDelayTicks = (1ul << (kSlotBits * kLevels)) - 1;
+
+        constexpr void Schedule(size_t id, uint32_t delayTicks)
+        {
+                Cancel(id);
+                delayTicks = delayTicks < 1 ? 1 : (delayTicks > kMaxDelayTicks ? kMaxDelayTicks : delayTicks);
+                mExpiry[id] = mNow + delayTicks;
+                Insert(id);
+        }
+
+        constexpr void Cancel(size_t id)
+        {
+                if (mArmed[id]) {
+                        Unlink(id);
+                }
+        }
+
+        constexpr bool Armed(size_t id) const { return mArmed[id]; }
+        constexpr uint32_t Remaining(size_t id) const { return mArmed[id] ? mExpiry[id] - mNow : 0; }
+        constexpr uint32_t Now() const { return mNow; }
+
+        template <typename Expire> constexpr void Advance(uint32_t ticks, Expire &expire)
+        {
+                for (uint32_t i = 0; i < ticks; i++) {
+                        mNow++;
+                        Cascade();
+
+                        /* Popped one at a time, the callback may reschedule */
+                        uint8_t *head = &mHeads[0][mNow & kSlotMask];
+                        while (*head) {
+                                const size_t id = *head - 1;
+                                Unlink(id);
+                                expire(id);
+                        }
+                }
+        }
+
+        constexpr uint32_t TicksToNext() const
+        {
+                if (!mCount) {
+                        return 0;
+                }
+
+                for (uint32_t ticks = 1; ticks < kSlots; ticks++) {
+                        const uint32_t tick = mNow + ticks;
+                        if (mHeads[0][tick & kSlotMask] || (tick & kSlotMask) == 0) {
+                                return ticks;
+                        }
+                }
+                return kSlots;
+        }
+
+private:
+        static constexpr uint32_t Span(size_t level) { return 1ul << (kSlotBits * level); }
+
+        constexpr void Insert(size_t id)
+        {
+                const uint32_t delta = mExpiry[id] - mNow;
+                size_t level = 0;
+
+                while (level + 1 < kLevels && delta >= Span(level + 1)) {
+                        level++;
+                }
+
+                uint8_t &head = mHeads[level][(mExpiry[id] >> (kSlotBits * level)) & kSlotMask];
+                mLevel[id] = static_cast<uint8_t>(level);
+                mPrev[id] = 0;
+                mNext[id] = head;
+                if (head) {
+                        mPrev[head - 1] = static_cast<uint8_t>(id + 1);
+                }
+                head = static_cast<uint8_t>(id + 1);
+                mArmed[id] = true;
+                mCount++;
+        }
+
+        constexpr void Unlink(size_t id)
+        {
+                const size_t level = mLevel[id];
+
+                if (mPrev[id]) {
+                        mNext[mPrev[id] - 1] = mNext[id];
+                } else {
+                        mHeads[level][(mExpiry[id] >> (kSlotBits * level)) & kSlotMask] = mNext[id];
+                }
+                if (mNext[id]) {
+                        mPrev[mNext[id] - 1] = mPrev[id];
+                }
+                mArmed[id] = false;
+                mCount--;
+        }
+
+        /* When level L wraps, the current slot of level L + 1 moves down,
+         * the highest level first so that its timers cascade all the way */
+        constexpr void Cascade()
+        {
+                size_t top = 0;
+
+                while (top + 1 < kLevels && (mNow & (Span(top + 1) - 1)) == 0) {
+                        top++;
+                }
+                for (size_t level = top; level >= 1; level--) {
+                        uint8_t &head = mHeads[level][(mNow >> (kSlotBits * level)) & kSlotMask];
+                        while (head) {
+                                const size_t id = head - 1;
+                                Unlink(id);
+                                Insert(id);
+                        }
+                }
+        }
+
+        uint32_t mNow = 0;
+        size_t mCount = 0;
+        /* Timer index + 1 of the list heads and links, 0 for none */
+        uint8_t mHeads[kLevels][kSlots] = {};
+        uint8_t mNext[kTimers] = {};
+        uint8_t mPrev[kTimers] = {};
+        uint8_t mLevel[kTimers] = {};
+        uint32_t mExpiry[kTimers] = {};
+        bool mArmed[kTimers] = {};
+};
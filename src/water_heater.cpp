@@ -0,0 +1,223 @@
+#include "water_heater.h"
+#include "actuators.h"
+#include "app_event_queue.h"
+#include "attribute_batcher.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_CHIP_APP_LOG_LEVEL);
+
+using namespace ::chip;
+
+namespace
+{
+constexpr EndpointId kWaterHeaterEndpointId = 4;
+constexpr uint32_t kMinWindowMs = 10000;
+/* Delay before posting again a window event that could not be queued */
+constexpr uint32_t kPostRetryMs = 100;
+
+constexpr char kSettingsSubtree[] = "heater/water";
+constexpr char kConfigKey[] = "heater/water/config";
+
+k_spinlock sConfigLock;
+WaterHeater::Config sConfig = {
+        true,
+        CONFIG_APP_WATER_HEATER_SETPOINT,
+        CONFIG_APP_WATER_HEATER_WINDOW_MS,
+        { FixedPointPid::FromMilli(CONFIG_APP_WATER_HEATER_KP_MILLI),
+          FixedPointPid::FromMilli(CONFIG_APP_WATER_HEATER_KI_MILLI),
+          FixedPointPid::FromMilli(CONFIG_APP_WATER_HEATER_KD_MILLI) },
+};
+
+/* The PID and the window state are only used by the app task */
+FixedPointPid sPid(sConfig.Gains, 0, WaterHeater::kMaxDuty);
+int64_t sLastTimestamp;
+uint16_t sDuty;
+k_timer sWindowTimer;
+bool sRunning;
+/* Set while the On part of the current window is running */
+bool sOffPending;
+uint32_t sOffTimeMs;
+
+void SwitchHeater(bool on)
+{
+        const ActuatorDescriptor *heater = Actuators::Find(kWaterHeaterEndpointId);
+
+        if (!heater) {
+                return;
+        }
+
+        /* The heater stays Off while an interlock forces it, see interlocks.h */
+        Actuators::Apply(*heater, on);
+        AttributeBatcher::SetOnOff(kWaterHeaterEndpointId, Actuators::IsOn(*heater));
+}
+
+/* Start a new time-proportional window with the latest duty cycle */
+void StartWindow(uint32_t windowMs)
+{
+        const uint32_t onTimeMs = static_cast<uint64_t>(windowMs) * sDuty / WaterHeater::kMaxDuty;
+
+        SwitchHeater(onTimeMs > 0);
+
+        sOffPending = onTimeMs > 0 && onTimeMs < windowMs;
+        if (sOffPending) {
+                sOffTimeMs = windowMs - onTimeMs;
+                k_timer_start(&sWindowTimer, K_MSEC(onTimeMs), K_NO_WAIT);
+        } else {
+                k_timer_start(&sWindowTimer, K_MSEC(windowMs), K_NO_WAIT);
+        }
+}
+
+/* Posted by the window timer and by the enable/disable changes */
+void WindowEventHandler(const AppEvent &)
+{
+        const WaterHeater::Config config = WaterHeater::GetConfig();
+
+        if (!config.Enabled) {
+                /* Hand the heater back to the On/Off commands, switched Off */
+                if (sRunning) {
+                        sRunning = false;
+                        sOffPending = false;
+                        k_timer_stop(&sWindowTimer);
+                        SwitchHeater(false);
+                }
+                return;
+        }
+
+        if (!sRunning) {
+                sRunning = true;
+                sPid.Reset();
+                StartWindow(config.WindowMs);
+                return;
+        }
+
+        /* Ignore an expiry queued before the timer was restarted */
+        if (k_timer_remaining_get(&sWindowTimer) != 0) {
+                return;
+        }
+
+        if (sOffPending) {
+                sOffPending = false;
+                SwitchHeater(false);
+                k_timer_start(&sWindowTimer, K_MSEC(sOffTimeMs), K_NO_WAIT);
+        } else {
+                StartWindow(config.WindowMs);
+        }
+}
+
+/* The relay is switched from the app task, not from the timer ISR. The
+ * windows only go on through this event, so one that cannot be queued is
+ * retried by the window timer rather than lost, the handler reads the
+ * configuration and the timer state anyway */
+void PostWindowEvent()
+{
+        AppEvent event;
+        event.Type = AppEventType::WaterHeaterWindow;
+        event.TimerEvent.Context = nullptr;
+        event.Handler = WindowEventHandler;
+        if (!AppEventQueue::Post(event)) {
+                LOG_WRN("Water heater window event dropped, retrying");
+                k_timer_start(&sWindowTimer, K_MSEC(kPostRetryMs), K_NO_WAIT);
+        }
+}
+
+void WindowTimerHandler(k_timer *)
+{
+        PostWindowEvent();
+}
+
+int LoadSetting(const char *key, size_t length, settings_read_cb read_cb, void *cb_arg, void *)
+{
+        WaterHeater::Config config;
+
+        if (settings_name_steq(key, "config", nullptr) && length == sizeof(config) &&
+            read_cb(cb_arg, &config, sizeof(config)) == sizeof(config) && config.WindowMs >= kMinWindowMs) {
+                sConfig = config;
+        }
+
+        return 0;
+}
+} /* namespace */
+
+int WaterHeater::Init()
+{
+        const int ret = settings_load_subtree_direct(kSettingsSubtree, LoadSetting, nullptr);
+        if (ret) {
+                LOG_ERR("settings_load_subtree_direct(%s) failed: %d", kSettingsSubtree, ret);
+        }
+
+        sPid.SetGains(sConfig.Gains);
+        k_timer_init(&sWindowTimer, WindowTimerHandler, nullptr);
+        PostWindowEvent();
+
+        return 0;
+}
+
+void WaterHeater::Update(int16_t temperature, int64_t timestamp)
+{
+        const Config config = GetConfig();
+        const uint32_t dtMs = sLastTimestamp ? static_cast<uint32_t>(timestamp - sLastTimestamp) : 0;
+
+        sLastTimestamp = timestamp;
+        if (!sRunning) {
+                return;
+        }
+
+        sPid.SetGains(config.Gains);
+        sDuty = static_cast<uint16_t>(sPid.Update(config.Setpoint, temperature, dtMs));
+}
+
+void WaterHeater::SensorLost()
+{
+        sDuty = 0;
+        sLastTimestamp = 0;
+
+        /* Do not wait for the end of the window to cut the heater, even at
+         * full duty where no Off part is pending, the next window starts
+         * with the 0 duty cycle */
+        if (sRunning) {
+                sOffPending = false;
+                SwitchHeater(false);
+                k_timer_start(&sWindowTimer, K_MSEC(GetConfig().WindowMs), K_NO_WAIT);
+        }
+}
+
+WaterHeater::Config WaterHeater::GetConfig()
+{
+        k_spinlock_key_t key = k_spin_lock(&sConfigLock);
+        const Config config = sConfig;
+        k_spin_unlock(&sConfigLock, key);
+
+        return config;
+}
+
+int WaterHeater::SetConfig(const Config &config)
+{
+        if (config.WindowMs < kMinWindowMs) {
+                return -EINVAL;
+        }
+
+        k_spinlock_key_t key = k_spin_lock(&sConfigLock);
+        const bool enabledChanged = config.Enabled != sConfig.Enabled;
+        sConfig = config;
+        k_spin_unlock(&sConfigLock, key);
+
+        /* Start or stop the windows from the app task */
+        if (enabledChanged) {
+                PostWindowEvent();
+        }
+
+        const int ret = settings_save_one(kConfigKey, &config, sizeof(config));
+        if (ret) {
+                LOG_ERR("settings_save_one(%s) failed: %d", kConfigKey, ret);
+        }
+
+        return ret;
+}
+
+uint16_t WaterHeater::Duty()
+{
+        return sDuty;
+}
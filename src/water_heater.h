@@ -0,0 +1,51 @@
+/* ****************************************************************************
+ *
+ *  WATER HEATER CONTROL - water_heater.cpp
+ *
+ * On-device PID regulation of the water heater (relay 3, EP4) from the
+ * DS18B20 water temperature. A bang-bang heater overshoots a lot on the
+ * slow water loop, so the PID output is a duty cycle, in per mille, which
+ * is applied by time-proportional switching: the relay is On for
+ * duty * window of every window and Off for the rest of it.
+ *
+ * While enabled the controller owns the heater relay, the EP4 On/Off
+ * attribute follows it. The configuration is persisted in the settings
+ * subsystem, with the Kconfig defaults until it is first changed.
+ *
+ * Init: load the persisted configuration and start the first window
+ * Update: run the PID on a new water temperature, 0.01 C, the new duty
+ *         cycle is applied from the next window
+ * SensorLost: cut the heater at once and force the duty cycle to 0 until
+ *             the next valid temperature
+ * GetConfig/SetConfig: read or change and persist the configuration, may be
+ *                      called from any thread
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include "fixed_point_pid.h"
+
+#include <cstdint>
+
+class WaterHeater {
+public:
+        static constexpr uint16_t kMaxDuty = 1000;
+
+        struct Config {
+                bool Enabled;
+                /* 0.01 C */
+                int16_t Setpoint;
+                uint32_t WindowMs;
+                /* Per mille of duty cycle per 0.01 C of error */
+                FixedPointPid::Gains Gains;
+        };
+
+        static int Init();
+        static void Update(int16_t temperature, int64_t timestamp);
+        static void SensorLost();
+
+        static Config GetConfig();
+        static int SetConfig(const Config &config);
+        static uint16_t Duty();
+};
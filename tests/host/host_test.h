@@ -0,0 +1,60 @@
+/* ****************************************************************************
+ *
+ *  HOST TEST - host_test.h
+ *
+ * Minimal checks for the host tests of the pure logic headers of src/, so
+ * that they build with a bare host compiler and run under ctest. A failed
+ * check is reported with its location and the test goes on, the exit
+ * status tells ctest whether any check failed.
+ *
+ * CHECK: report a false condition
+ * CHECK_EQUAL: report two different integer values, both printed
+ * HostTestResult: exit status of the test
+ *
+ * ***************************************************************************/
+
+#pragma once
+
+#include <cstdio>
+
+namespace HostTest
+{
+inline unsigned &Failures()
+{
+        static unsigned sFailures;
+        return sFailures;
+}
+
+inline bool Check(bool condition, const char *expression, const char *file, int line)
+{
+        if (!condition) {
+                std::printf("%s:%d: CHECK(%s) failed\n", file, line, expression);
+                Failures()++;
+        }
+        return condition;
+}
+
+inline bool CheckEqual(long long actual, long long expected, const char *expression, const char *file, int line)
+{
+        if (actual != expected) {
+                std::printf("%s:%d: CHECK_EQUAL(%s) failed: %lld != %lld\n", file, line, expression, actual,
+                            expected);
+                Failures()++;
+        }
+        return actual == expected;
+}
+} /* namespace HostTest */
+
+#define CHECK(condition) HostTest::Check((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(actual, expected)                                                                              \
+        HostTest::CheckEqual(static_cast<long long>(actual), static_cast<long long>(expected),                   \
+                             #actual ", " #expected, __FILE__, __LINE__)
+
+inline int HostTestResult()
+{
+        if (HostTest::Failures() != 0) {
+                std::printf("%u check(s) failed\n", HostTest::Failures());
+                return 1;
+        }
+        return 0;
+}
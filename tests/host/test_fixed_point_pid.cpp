@@ -0,0 +1,173 @@
+#include "fixed_point_pid.h"
+#include "host_test.h"
+
+#include <cstdio>
+
+namespace
+{
+/* Defaults of CONFIG_APP_WATER_HEATER_* */
+constexpr int32_t kSetpoint = 2600;
+constexpr uint32_t kSampleS = 10;
+constexpr int32_t kWindowS = 60;
+constexpr FixedPointPid::Gains kGains = { FixedPointPid::FromMilli(5000), FixedPointPid::FromMilli(20), 0 };
+constexpr int32_t kFullDuty = 1000;
+/* Within 0.3 C of the setpoint */
+constexpr int32_t kSettledBand = 30;
+
+/* Water heater on a first-order plant: 30 min time constant, +15 C at full
+ * power, 20 C ambient, driven by the PID every 10 s through a 60 s
+ * time-proportional window as in water_heater.cpp. Simulated by 1 s steps,
+ * the temperature in 0.00001 C */
+class WaterHeaterPlant {
+public:
+        static constexpr int64_t kAmbient = 2000 * 1000;
+        static constexpr int64_t kHeaterRise = 1500 * 1000;
+        static constexpr int64_t kTauS = 1800;
+
+        struct Response {
+                /* 0.01 C */
+                int32_t MaxTemperature;
+                int32_t MinTemperature;
+                /* Seconds from the start of the run until the temperature
+                 * stays within kSettledBand, -1 if it never does */
+                int32_t SettledAt;
+                /* Samples at full duty */
+                uint32_t Saturated;
+        };
+
+        WaterHeaterPlant() : mPid(kGains, 0, kFullDuty) {}
+
+        int32_t Temperature() const { return static_cast<int32_t>(mTemperature / 1000); }
+        /* Cold water poured in, 0.01 C */
+        void Cool(int32_t drop) { mTemperature -= static_cast<int64_t>(drop) * 1000; }
+        /* A failed heater or an open relay, the PID still runs */
+        void SetHeaterWorking(bool working) { mHeaterWorking = working; }
+
+        Response Run(uint32_t seconds)
+        {
+                Response response = { Temperature(), Temperature(), -1, 0 };
+
+                for (uint32_t s = 0; s < seconds; s++, mTime++) {
+                        if (mTime % kSampleS == 0) {
+                                mDuty = mPid.Update(kSetpoint, Temperature(), mTime ? kSampleS * 1000 : 0);
+                                response.Saturated += mDuty == kFullDuty;
+                        }
+                        if (mTime % kWindowS == 0) {
+                                mOnTimeS = mDuty * kWindowS / kFullDuty;
+                        }
+
+                        const bool heating = mHeaterWorking && static_cast<int32_t>(mTime % kWindowS) < mOnTimeS;
+                        const int64_t target = kAmbient + (heating ? kHeaterRise : 0);
+                        mTemperature += (target - mTemperature) / kTauS;
+
+                        const int32_t current = Temperature();
+                        response.MaxTemperature = current > response.MaxTemperature ? current :
+                                                                                      response.MaxTemperature;
+                        response.MinTemperature = current < response.MinTemperature ? current :
+                                                                                      response.MinTemperature;
+                        if (current < kSetpoint - kSettledBand || current > kSetpoint + kSettledBand) {
+                                response.SettledAt = -1;
+                        } else if (response.SettledAt < 0) {
+                                response.SettledAt = static_cast<int32_t>(s);
+                        }
+                }
+                return response;
+        }
+
+private:
+        FixedPointPid mPid;
+        int64_t mTemperature = kAmbient;
+        uint32_t mTime = 0;
+        int32_t mDuty = 0;
+        int32_t mOnTimeS = 0;
+        bool mHeaterWorking = true;
+};
+
+void Print(const char *name, const WaterHeaterPlant::Response &response)
+{
+        std::printf("%s: max %d, min %d, settled at %d s, %u saturated samples\n", name, response.MaxTemperature,
+                    response.MinTemperature, response.SettledAt, response.Saturated);
+}
+
+/* From 20 C to the 26 C setpoint: full duty during the warm-up, at most
+ * 0.5 C of overshoot, settled within 30 min */
+void TestWarmUp()
+{
+        WaterHeaterPlant plant;
+        const WaterHeaterPlant::Response response = plant.Run(2 * 3600);
+
+        Print("warm-up", response);
+        CHECK(response.Saturated >= 30);
+        CHECK(response.MaxTemperature <= kSetpoint + 50);
+        CHECK(response.SettledAt >= 0 && response.SettledAt <= 30 * 60);
+}
+
+/* A 3 C water change once settled: back within 0.3 C in 30 min, without
+ * overshooting by more than 0.5 C */
+void TestWaterChange()
+{
+        WaterHeaterPlant plant;
+
+        plant.Run(2 * 3600);
+        plant.Cool(300);
+        const WaterHeaterPlant::Response response = plant.Run(2 * 3600);
+
+        Print("water change", response);
+        CHECK(response.MaxTemperature <= kSetpoint + 50);
+        CHECK(response.SettledAt >= 0 && response.SettledAt <= 30 * 60);
+}
+
+/* The heater stays cold for an hour while the PID asks for full duty: the
+ * anti-windup keeps the overshoot after the repair as small as from a cold
+ * start */
+void TestHeaterOutage()
+{
+        WaterHeaterPlant plant;
+
+        plant.Run(2 * 3600);
+        plant.SetHeaterWorking(false);
+        const WaterHeaterPlant::Response outage = plant.Run(3600);
+        plant.SetHeaterWorking(true);
+        const WaterHeaterPlant::Response repaired = plant.Run(2 * 3600);
+
+        Print("heater outage", outage);
+        Print("heater repaired", repaired);
+        CHECK(outage.MinTemperature < kSetpoint - 200);
+        CHECK(repaired.MaxTemperature <= kSetpoint + 50);
+        CHECK(repaired.SettledAt >= 0 && repaired.SettledAt <= 30 * 60);
+}
+
+/* The derivative acts on the measurement: a setpoint step does not kick
+ * the output, a measurement change does */
+void TestNoDerivativeKick()
+{
+        FixedPointPid pid({ 0, 0, FixedPointPid::FromMilli(1000) }, -kFullDuty, kFullDuty);
+
+        CHECK_EQUAL(pid.Update(2600, 2500, 0), 0);
+        CHECK_EQUAL(pid.Update(2800, 2500, 10000), 0);
+        /* -1 per 0.01 C per second, over 10 s */
+        CHECK_EQUAL(pid.Update(2800, 2600, 10000), -10);
+
+        pid.Reset();
+        CHECK_EQUAL(pid.Update(2800, 2900, 10000), 0);
+}
+
+void TestFixedPoint()
+{
+        CHECK_EQUAL(FixedPointPid::FromMilli(1000), 1 << FixedPointPid::kFractionBits);
+        CHECK_EQUAL(FixedPointPid::ToMilli(FixedPointPid::FromMilli(5000)), 5000);
+        /* Truncated towards zero, a gain never grows through the round trip */
+        CHECK_EQUAL(FixedPointPid::ToMilli(FixedPointPid::FromMilli(20)), 19);
+}
+} /* namespace */
+
+int main()
+{
+        TestWarmUp();
+        TestWaterChange();
+        TestHeaterOutage();
+        TestNoDerivativeKick();
+        TestFixedPoint();
+
+        return HostTestResult();
+}
@@ -0,0 +1,106 @@
+#include "host_test.h"
+#include "interlock_latch.h"
+
+namespace
+{
+InterlockObservation Reading(int32_t value)
+{
+        return { true, value, 0 };
+}
+
+InterlockObservation Failure(uint32_t staleMs)
+{
+        return { false, 0, staleMs };
+}
+
+/* Latched after each observation of a rule */
+template <size_t kLength>
+void CheckTrace(InterlockCondition condition, int32_t limit, uint8_t confirmations,
+                const InterlockObservation (&observations)[kLength], const bool (&latched)[kLength], uint32_t trips)
+{
+        InterlockLatch latch;
+
+        for (size_t i = 0; i < kLength; i++) {
+                latch.Update(condition, limit, confirmations, observations[i]);
+                CHECK_EQUAL(latch.Latched(), latched[i]);
+        }
+        CHECK_EQUAL(latch.Trips(), trips);
+}
+
+/* Above 4000 confirmed twice: a spike, a failure between two readings at
+ * the limit, then back below */
+void TestAboveConfirmed()
+{
+        CheckTrace(InterlockCondition::Above, 4000, 2,
+                   { Reading(3900), Reading(4500), Reading(3900), Reading(4000), Failure(5000), Reading(4100),
+                     Reading(3999) },
+                   { false, false, false, false, false, true, true }, 1);
+}
+
+/* Below 1800 confirmed three times, with failures between the readings:
+ * a reading above the limit restarts the count, the failures neither
+ * count nor restart it */
+void TestBelowWithFailures()
+{
+        CheckTrace(InterlockCondition::Below, 1800, 3,
+                   { Reading(1800), Failure(5000), Reading(1801), Reading(1800), Failure(5000), Failure(10000),
+                     Reading(1750), Failure(5000), Reading(1799), Failure(5000) },
+                   { false, false, false, false, false, false, false, false, true, true }, 1);
+}
+
+/* A failure after the trip keeps the condition, only a reading clears it */
+void TestFailureKeepsCondition()
+{
+        InterlockLatch latch;
+
+        CHECK(latch.Update(InterlockCondition::Below, 1800, 1, Reading(1700)));
+        CHECK(!latch.Update(InterlockCondition::Below, 1800, 1, Failure(5000)));
+        CHECK(latch.Violating());
+        CHECK(!latch.Acknowledge());
+
+        latch.Update(InterlockCondition::Below, 1800, 1, Reading(1801));
+        CHECK(latch.Acknowledge());
+        CHECK(!latch.Latched());
+}
+
+/* An alarm is only acknowledged once cleared, and trips again after */
+void TestAcknowledge()
+{
+        InterlockLatch latch;
+
+        latch.Update(InterlockCondition::Below, 1000, 1, Reading(900));
+        latch.Update(InterlockCondition::Below, 1000, 1, Reading(1000));
+        CHECK(!latch.Acknowledge());
+        CHECK(latch.Latched());
+
+        latch.Update(InterlockCondition::Below, 1000, 1, Reading(1001));
+        CHECK(latch.Acknowledge());
+        CHECK(!latch.Latched());
+
+        CHECK(latch.Update(InterlockCondition::Below, 1000, 1, Reading(950)));
+        CHECK_EQUAL(latch.Trips(), 2);
+}
+
+/* A rule trips on a sensor failing for too long */
+void TestStale()
+{
+        InterlockLatch fresh;
+        InterlockLatch stale;
+
+        fresh.Update(InterlockCondition::StaleFor, 60000, 1, Reading(2500));
+        CHECK(!fresh.Update(InterlockCondition::StaleFor, 60000, 1, Failure(59999)));
+        stale.Update(InterlockCondition::StaleFor, 60000, 1, Reading(2500));
+        CHECK(stale.Update(InterlockCondition::StaleFor, 60000, 1, Failure(60000)));
+}
+} /* namespace */
+
+int main()
+{
+        TestAboveConfirmed();
+        TestBelowWithFailures();
+        TestFailureKeepsCondition();
+        TestAcknowledge();
+        TestStale();
+
+        return HostTestResult();
+}
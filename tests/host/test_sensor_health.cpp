@@ -0,0 +1,104 @@
+#include "host_test.h"
+#include "sensor_health.h"
+
+namespace
+{
+/* Acquisition outcomes every 5 s, 3 failures in a row or 30 s without a
+ * reading fail the sensor */
+constexpr int64_t kPeriodMs = 5000;
+constexpr uint32_t kFailThreshold = 3;
+constexpr uint32_t kStaleMs = 30000;
+constexpr uint32_t kMinIntervalMs = 5000;
+constexpr uint32_t kMaxIntervalMs = 60000;
+
+constexpr SensorState O = SensorState::Ok;
+constexpr SensorState R = SensorState::Retrying;
+constexpr SensorState F = SensorState::Failed;
+
+SensorHealth Failing(uint32_t failures)
+{
+        SensorHealth health(kFailThreshold, kStaleMs);
+
+        health.Success(0);
+        for (uint32_t i = 0; i < failures; i++) {
+                health.Failure(0);
+        }
+        return health;
+}
+
+/* Unplugged at boot, plugged, two glitches, unplugged again. Missing since
+ * the boot is not a fault, the sensor starts Failed */
+void TestUnpluggedAndGlitches()
+{
+        const bool outcomes[] = { false, false, true, false, true, false, false, false, false, true };
+        const SensorState states[] = { F, F, O, R, O, R, R, F, F, O };
+        SensorHealth health(kFailThreshold, kStaleMs);
+
+        CHECK(health.State() == F);
+        for (size_t i = 0; i < sizeof(outcomes); i++) {
+                const int64_t nowMs = static_cast<int64_t>(i) * kPeriodMs;
+
+                if (outcomes[i]) {
+                        health.Success(nowMs);
+                } else {
+                        health.Failure(nowMs);
+                }
+                CHECK_EQUAL(health.State(), states[i]);
+        }
+
+        CHECK_EQUAL(health.Faults(), 1);
+        CHECK_EQUAL(health.Failures(), 7);
+        CHECK_EQUAL(health.ConsecutiveFailures(), 0);
+        CHECK_EQUAL(health.LastSuccessMs(), 9 * kPeriodMs);
+}
+
+void TestStaleReading()
+{
+        SensorHealth fresh(kFailThreshold, kStaleMs);
+        SensorHealth stale(kFailThreshold, kStaleMs);
+
+        fresh.Success(0);
+        fresh.Failure(kStaleMs);
+        stale.Success(0);
+        stale.Failure(kStaleMs + 1);
+
+        CHECK_EQUAL(fresh.State(), R);
+        CHECK_EQUAL(stale.State(), F);
+        CHECK_EQUAL(stale.Faults(), 1);
+}
+
+void TestBackoff()
+{
+        CHECK_EQUAL(Failing(1).RetryDelayMs(kMinIntervalMs, kMaxIntervalMs), 5000);
+        CHECK_EQUAL(Failing(2).RetryDelayMs(kMinIntervalMs, kMaxIntervalMs), 10000);
+        CHECK_EQUAL(Failing(4).RetryDelayMs(kMinIntervalMs, kMaxIntervalMs), 40000);
+        CHECK_EQUAL(Failing(9).RetryDelayMs(kMinIntervalMs, kMaxIntervalMs), 60000);
+        /* Saturated, the doubling never wraps around */
+        CHECK_EQUAL(Failing(1000).RetryDelayMs(kMinIntervalMs, kMaxIntervalMs), 60000);
+}
+
+/* Only the counters are cleared, the state and the failures in a row stay */
+void TestResetCounters()
+{
+        SensorHealth health = Failing(4);
+
+        health.ResetCounters();
+        CHECK_EQUAL(health.Failures(), 0);
+        CHECK_EQUAL(health.Faults(), 0);
+        CHECK_EQUAL(health.State(), F);
+        CHECK_EQUAL(health.ConsecutiveFailures(), 4);
+
+        health.Failure(0);
+        CHECK_EQUAL(health.Faults(), 0);
+}
+} /* namespace */
+
+int main()
+{
+        TestUnpluggedAndGlitches();
+        TestStaleReading();
+        TestBackoff();
+        TestResetCounters();
+
+        return HostTestResult();
+}
@@ -0,0 +1,187 @@
+#include "host_test.h"
+#include "spike_filter.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+constexpr int64_t kPeriodMs = 5000;
+/* Defaults of CONFIG_APP_DHT_FILTER_WINDOW and CONFIG_APP_DHT_MAX_*_RATE */
+constexpr size_t kWindow = 5;
+constexpr uint32_t kTemperatureRate = 20;
+constexpr uint32_t kHumidityRate = 100;
+
+template <size_t kFilterWindow, size_t kLength>
+void CheckTrace(uint32_t maxRatePerS, const int64_t (&timestampsMs)[kLength], const int32_t (&samples)[kLength],
+                const int32_t (&expected)[kLength], size_t resetAt = SIZE_MAX)
+{
+        SpikeFilter<kFilterWindow> filter(maxRatePerS);
+
+        for (size_t i = 0; i < kLength; i++) {
+                if (i == resetAt) {
+                        filter.Reset();
+                }
+                CHECK_EQUAL(filter.Update(samples[i], timestampsMs[i]), expected[i]);
+        }
+}
+
+template <size_t kFilterWindow, size_t kLength>
+void CheckTrace(uint32_t maxRatePerS, const int32_t (&samples)[kLength], const int32_t (&expected)[kLength])
+{
+        int64_t timestampsMs[kLength];
+
+        for (size_t i = 0; i < kLength; i++) {
+                timestampsMs[i] = static_cast<int64_t>(i) * kPeriodMs;
+        }
+        CheckTrace<kFilterWindow>(maxRatePerS, timestampsMs, samples, expected);
+}
+
+/* DHT22 temperature, 0.01 C, with a flipped bit and a dropout to 0 */
+void TestSingleSpikes()
+{
+        CheckTrace<kWindow>(kTemperatureRate, { 2512, 2514, 2513, 5073, 2515, 2516, 2517, 0, 2518, 2519 },
+                            { 2512, 2512, 2513, 2513, 2514, 2515, 2516, 2516, 2516, 2517 });
+}
+
+/* DHT11 humidity, 0.01 %RH, with two consecutive bad frames, then a
+ * misting step ramped by the 1 %RH/s limit */
+void TestBurstAndStep()
+{
+        CheckTrace<kWindow>(kHumidityRate,
+                            { 5500, 5500, 9900, 9900, 5600, 5600, 5600, 8100, 8100, 8100, 8100, 8100, 8100 },
+                            { 5500, 5500, 5500, 5500, 5600, 5600, 5600, 5600, 5600, 6100, 6600, 7100, 7600 });
+}
+
+/* Without a rate limit, the lower middle sample while the window fills up,
+ * then the true median once the ring wraps around */
+void TestWindowFill()
+{
+        CheckTrace<kWindow>(UINT32_MAX, { 0, 5000, 10000, 15000, 20000, 25000, 30000 },
+                            { 2000, 3000, 1000, 4000, 5000, 6000, 7000 },
+                            { 2000, 2000, 2000, 2000, 3000, 4000, 5000 });
+}
+
+/* A Reset empties the window: the next sample goes through as is, however
+ * far and however tight the limit, and the window fills up again */
+void TestReset()
+{
+        CheckTrace<kWindow>(kTemperatureRate, { 0, 5000, 10000, 15000, 20000, 25000 },
+                            { 2500, 2510, 2520, 3000, 3500, 3400 }, { 2500, 2500, 2510, 3000, 3000, 3100 }, 3);
+}
+
+/* The limit scales with the sample time: 100 per 5 s sample at 20/s, 1200
+ * after a 60 s outage, nothing for a repeated timestamp. A window of 1 only
+ * keeps the rate limit */
+void TestRateLimit()
+{
+        CheckTrace<1>(kTemperatureRate, { 0, 5000, 10000, 70000, 75000, 75000 },
+                      { 2000, 4000, 4000, 4000, 1000, 1000 }, { 2000, 2100, 2200, 3400, 3300, 3300 });
+}
+
+/* Deterministic generator of the simulated sensor faults */
+class Lcg {
+public:
+        explicit Lcg(uint32_t seed) : mState(seed) {}
+
+        /* Uniform in [0, range) */
+        uint32_t Next(uint32_t range)
+        {
+                mState = mState * 1664525u + 1013904223u;
+                return (mState >> 8) % range;
+        }
+
+private:
+        uint32_t mState;
+};
+
+/* A day of Hot-Spot samples every 5 s: the lamp heats the spot from 24 C
+ * towards 33 C for 45 min, then lets it cool for 45 min. The DHT22 reads
+ * it at 0.1 C, +-0.1 C of noise, with the faults of the traces above: 2%
+ * of the frames with a flipped bit, 0.5% dropouts to 0, and 0.2% bursts of
+ * two bad frames.
+ *
+ * The output never moves faster than the rate limit. While at most half
+ * of the window is faulty, it stays within two samples of median delay at
+ * the fastest lamp slope, plus the sensor noise and resolution. A faulty
+ * majority gets through the median, but only drags the output one rate
+ * limited step per sample, and it comes back as fast. */
+void TestSimulatedDay()
+{
+        constexpr uint32_t kSamples = 24 * 3600 * 1000 / kPeriodMs;
+        constexpr uint32_t kHalfCycle = 45 * 60 * 1000 / kPeriodMs;
+        constexpr int32_t kAmbient = 2400;
+        constexpr int32_t kLampOn = 3300;
+        /* First order approach to the target, in samples */
+        constexpr int32_t kTimeConstant = 128;
+        constexpr int32_t kMaxSlope = (kLampOn - kAmbient + kTimeConstant - 1) / kTimeConstant;
+        constexpr int32_t kTolerance = 2 * kMaxSlope + 10 + 5;
+        constexpr int32_t kMaxStep = kTemperatureRate * kPeriodMs / 1000;
+
+        SpikeFilter<kWindow> filter(kTemperatureRate);
+        Lcg faults(0x5eed);
+        bool faulty[kWindow] = {};
+        int32_t truth = kAmbient;
+        int32_t previous = 0;
+        int32_t allowance = 0;
+        uint32_t burst = 0;
+        uint32_t injected = 0;
+        uint32_t majorities = 0;
+
+        for (uint32_t i = 0; i < kSamples; i++) {
+                const int32_t target = (i / kHalfCycle) % 2 == 0 ? kLampOn : kAmbient;
+                truth += (target - truth) / kTimeConstant;
+
+                int32_t reading = (truth + 5) / 10 * 10 + (static_cast<int32_t>(faults.Next(3)) - 1) * 10;
+                const uint32_t draw = faults.Next(1000);
+                bool fault = true;
+                if (burst > 0 || draw < 2) {
+                        burst = burst > 0 ? burst - 1 : 1;
+                        reading = 8500;
+                } else if (draw < 22) {
+                        reading ^= 1 << (10 + faults.Next(4));
+                } else if (draw < 27) {
+                        reading = 0;
+                } else {
+                        fault = false;
+                }
+                injected += fault;
+
+                faulty[i % kWindow] = fault;
+                size_t windowFaults = 0;
+                for (bool sample : faulty) {
+                        windowFaults += sample;
+                }
+                if (windowFaults > kWindow / 2) {
+                        majorities++;
+                        allowance += kMaxStep;
+                } else {
+                        allowance = std::max(allowance - kMaxStep, 0);
+                }
+
+                const int32_t output = filter.Update(reading, static_cast<int64_t>(i) * kPeriodMs);
+                if (i > 0) {
+                        CHECK(std::abs(output - previous) <= kMaxStep);
+                }
+                if (!CHECK(std::abs(output - truth) <= kTolerance + allowance)) {
+                        std::printf("sample %u: truth %d, reading %d, output %d\n", i, truth, reading, output);
+                }
+                previous = output;
+        }
+
+        std::printf("%u samples, %u faults, %u faulty majorities\n", kSamples, injected, majorities);
+        CHECK(injected > kSamples / 50);
+}
+} /* namespace */
+
+int main()
+{
+        TestSingleSpikes();
+        TestBurstAndStep();
+        TestWindowFill();
+        TestReset();
+        TestRateLimit();
+        TestSimulatedDay();
+
+        return HostTestResult();
+}
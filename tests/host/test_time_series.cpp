@@ -0,0 +1,175 @@
+/* Kconfig defaults, for the sizing of the sensor history */
+#define CONFIG_APP_SENSOR_HISTORY_S 86400
+#define CONFIG_APP_SENSOR_HISTORY_ESCAPE_PERCENT 5
+#define CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS 5000
+
+#include "host_test.h"
+#include "sensor_history.h"
+#include "time_series.h"
+
+#include <vector>
+
+namespace
+{
+using Series = TimeSeries<2, 8>;
+
+/* 1 s period. Block 0: keyframe, a delta, an escape (+490), a gap and an
+ * escape (-127, just out of range), filling the 8 bytes. Block 1 starts on
+ * the next sample, and block 2 recycles block 0 */
+Series Recorded(size_t samples)
+{
+        Series series(1000);
+        const int64_t timestamps[] = { 0, 1000, 2000, 4000, 5000, 6000, 7000, 8000 };
+        const int16_t values[] = { 2000, 2010, 2500, 2373, 2374, -32768, -32767, -32766 };
+
+        for (size_t i = 0; i < samples && i < 8; i++) {
+                series.Append(timestamps[i], values[i]);
+        }
+        for (size_t i = 8; i < samples; i++) {
+                series.Append(int64_t(i + 1) * 1000, static_cast<int16_t>(-32766 + (i - 7) * 100));
+        }
+        return series;
+}
+
+template <size_t kCount>
+void CheckDecodes(const Series &series, int64_t fromMs, const int64_t (&timestamps)[kCount],
+                  const int16_t (&values)[kCount])
+{
+        Series::Iterator iterator = series.Seek(fromMs);
+        Series::Point point = { 0, 0 };
+
+        for (size_t i = 0; i < kCount; i++) {
+                if (!CHECK(iterator.Next(point))) {
+                        return;
+                }
+                CHECK_EQUAL(point.TimestampMs, timestamps[i]);
+                CHECK_EQUAL(point.Value, values[i]);
+        }
+        CHECK(!iterator.Next(point));
+}
+
+void TestEscapesAndGaps()
+{
+        CheckDecodes(Recorded(8), INT64_MIN, { 0, 1000, 2000, 4000, 5000, 6000, 7000, 8000 },
+                     { 2000, 2010, 2500, 2373, 2374, -32768, -32767, -32766 });
+}
+
+void TestSeek()
+{
+        CheckDecodes(Recorded(8), 4500, { 5000, 6000, 7000, 8000 }, { 2374, -32768, -32767, -32766 });
+}
+
+/* Block 1 takes 7 samples, the 12th one starts block 2 over block 0 */
+void TestRecycling()
+{
+        CheckDecodes(Recorded(17), INT64_MIN,
+                     { 5000, 6000, 7000, 8000, 9000, 10000, 11000, 12000, 13000, 14000, 15000, 16000, 17000 },
+                     { 2374, -32768, -32767, -32766, -32666, -32566, -32466, -32366, -32266, -32166, -32066,
+                       -31966, -31866 });
+}
+
+/* Deterministic generator of the simulated channels */
+class Lcg {
+public:
+        explicit Lcg(uint32_t seed) : mState(seed) {}
+
+        /* Uniform in [0, range) */
+        uint32_t Next(uint32_t range)
+        {
+                mState = mState * 1664525u + 1013904223u;
+                return (mState >> 8) % range;
+        }
+
+private:
+        uint32_t mState;
+};
+
+/* Two days of one channel in the sensor history sizing, so that its oldest
+ * blocks get recycled: a slow walk with escapePercent of the samples
+ * jumping out of the 8 bit deltas, and a missed sample now and then.
+ * Returns the history kept, in ms, and checks that every sample still
+ * stored decodes exactly */
+int64_t RecordDays(uint32_t escapePercent)
+{
+        constexpr int64_t kPeriodMs = CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS;
+        constexpr int64_t kDurationMs = 2 * 24 * 3600 * 1000;
+
+        SensorHistory::Series series(kPeriodMs);
+        std::vector<SensorHistory::Point> recorded;
+        Lcg random(0xda7a + escapePercent);
+        int16_t value = 2500;
+
+        for (int64_t timestamp = 0; timestamp < kDurationMs; timestamp += kPeriodMs) {
+                if (random.Next(1000) == 0) {
+                        continue;
+                }
+                if (random.Next(100) < escapePercent) {
+                        value = static_cast<int16_t>(value + (random.Next(2) ? 500 : -500));
+                } else {
+                        value = static_cast<int16_t>(value + static_cast<int32_t>(random.Next(21)) - 10);
+                }
+                series.Append(timestamp, value);
+                recorded.push_back({ timestamp, value });
+        }
+
+        SensorHistory::Series::Iterator iterator = series.Begin();
+        SensorHistory::Point point = { 0, 0 };
+        if (!CHECK(iterator.Next(point))) {
+                return 0;
+        }
+
+        size_t i = 0;
+        while (i < recorded.size() && recorded[i].TimestampMs < point.TimestampMs) {
+                i++;
+        }
+        const int64_t oldestMs = point.TimestampMs;
+        do {
+                if (!CHECK(i < recorded.size())) {
+                        break;
+                }
+                CHECK_EQUAL(point.TimestampMs, recorded[i].TimestampMs);
+                CHECK_EQUAL(point.Value, recorded[i].Value);
+                i++;
+        } while (iterator.Next(point));
+        CHECK_EQUAL(i, recorded.size());
+
+        /* Seek lands on the first stored sample at or after its time */
+        const int64_t fromMs = recorded.back().TimestampMs - 3600 * 1000 + 1;
+        SensorHistory::Series::Iterator seek = series.Seek(fromMs);
+        if (CHECK(seek.Next(point))) {
+                CHECK(point.TimestampMs >= fromMs && point.TimestampMs < fromMs + 2 * kPeriodMs);
+        }
+
+        return recorded.back().TimestampMs - oldestMs;
+}
+
+/* The default sizing keeps the whole CONFIG_APP_SENSOR_HISTORY_S up to the
+ * escape rate it is sized for, a faster channel keeps a shorter history */
+void TestHistorySizing()
+{
+        constexpr int64_t kHistoryMs = int64_t(CONFIG_APP_SENSOR_HISTORY_S) * 1000;
+
+        CHECK_EQUAL(SensorHistory::kBlockSamples, 59);
+
+        const int64_t quiet = RecordDays(0);
+        const int64_t sized = RecordDays(CONFIG_APP_SENSOR_HISTORY_ESCAPE_PERCENT);
+        const int64_t busy = RecordDays(50);
+
+        std::printf("history kept: %lld s quiet, %lld s at %u%% escapes, %lld s at 50%%\n",
+                    static_cast<long long>(quiet / 1000), static_cast<long long>(sized / 1000),
+                    CONFIG_APP_SENSOR_HISTORY_ESCAPE_PERCENT, static_cast<long long>(busy / 1000));
+        CHECK(quiet >= kHistoryMs - CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS);
+        CHECK(sized >= kHistoryMs - CONFIG_APP_SENSOR_SAMPLING_PERIOD_MS);
+        CHECK(busy < kHistoryMs);
+}
+} /* namespace */
+
+int main()
+{
+        TestEscapesAndGaps();
+        TestSeek();
+        TestRecycling();
+        TestHistorySizing();
+
+        return HostTestResult();
+}
@@ -0,0 +1,199 @@
+#include "host_test.h"
+#include "timer_wheel.h"
+
+namespace
+{
+using Wheel = TimerWheel<3, 4>;
+
+/* Records the tick of every expiry, timer 3 re-arming itself once */
+struct Recorder {
+        Wheel *Timers;
+        uint32_t Now;
+        size_t Order[5];
+        uint32_t Ticks[5];
+        size_t Count;
+
+        void operator()(size_t id)
+        {
+                if (Count < 5) {
+                        Order[Count] = id;
+                        Ticks[Count] = Now;
+                }
+                if (++Count == 3 && id == 3) {
+                        Timers->Schedule(3, 100);
+                }
+        }
+};
+
+void ScheduleTimers(Wheel &wheel)
+{
+        wheel.Schedule(0, 5);
+        wheel.Schedule(1, 70);
+        wheel.Schedule(2, 5000);
+        wheel.Schedule(3, 4000);
+}
+
+/* Timers armed at 0 for 5, 70, 5000 (twice) and 4000 ticks, the wheel
+ * advanced one tick at a time */
+void TestExpiryOrder()
+{
+        const size_t order[] = { 0, 1, 3, 3, 2 };
+        const uint32_t ticks[] = { 5, 70, 4000, 4100, 5000 };
+        Wheel wheel;
+        Recorder recorder = { &wheel, 0, {}, {}, 0 };
+
+        ScheduleTimers(wheel);
+        wheel.Schedule(2, 5000);
+
+        while (wheel.TicksToNext()) {
+                recorder.Now++;
+                wheel.Advance(1, recorder);
+        }
+
+        CHECK_EQUAL(recorder.Count, 5);
+        for (size_t i = 0; i < 5; i++) {
+                CHECK_EQUAL(recorder.Order[i], order[i]);
+                CHECK_EQUAL(recorder.Ticks[i], ticks[i]);
+        }
+}
+
+/* Same timers, the wheel only woken up after TicksToNext: one wakeup per
+ * level 0 wrap, plus the expiries off a wrap */
+void TestWakeups()
+{
+        Wheel wheel;
+        Recorder recorder = { &wheel, 0, {}, {}, 0 };
+        uint32_t wakeups = 0;
+
+        ScheduleTimers(wheel);
+
+        while (uint32_t ticks = wheel.TicksToNext()) {
+                recorder.Now += ticks;
+                wheel.Advance(ticks, recorder);
+                wakeups++;
+        }
+
+        CHECK_EQUAL(recorder.Ticks[4], 5000);
+        CHECK_EQUAL(wakeups, 5000 / 64 + 5);
+}
+
+void TestCancelAndClamp()
+{
+        Wheel wheel;
+        Recorder recorder = { &wheel, 0, {}, {}, 0 };
+
+        wheel.Schedule(0, 0);
+        wheel.Schedule(1, UINT32_MAX);
+        wheel.Schedule(2, 10);
+        CHECK_EQUAL(wheel.Remaining(0), 1);
+        CHECK_EQUAL(wheel.Remaining(1), Wheel::kMaxDelayTicks);
+
+        wheel.Cancel(2);
+        wheel.Cancel(2);
+        CHECK(!wheel.Armed(2));
+        CHECK_EQUAL(wheel.Remaining(2), 0);
+
+        wheel.Advance(Wheel::kMaxDelayTicks, recorder);
+        CHECK_EQUAL(recorder.Count, 2);
+        CHECK_EQUAL(wheel.TicksToNext(), 0);
+}
+
+/* Deterministic generator of the random operations */
+class Lcg {
+public:
+        explicit Lcg(uint32_t seed) : mState(seed) {}
+
+        /* Uniform in [0, range) */
+        uint32_t Next(uint32_t range)
+        {
+                mState = mState * 1664525u + 1013904223u;
+                return (mState >> 8) % range;
+        }
+
+private:
+        uint32_t mState;
+};
+
+/* Random schedules, cancels and re-arms from the callback against plain
+ * expiry ticks: every timer expires exactly at its tick, and TicksToNext
+ * never sleeps past an expiry */
+void TestAgainstReference()
+{
+        constexpr size_t kTimers = 16;
+        constexpr uint32_t kTicks = 300000;
+        using BigWheel = TimerWheel<3, kTimers>;
+
+        struct Reference {
+                BigWheel *Timers;
+                Lcg *Random;
+                uint32_t Expiry[kTimers];
+                bool Armed[kTimers];
+                uint32_t Now;
+                uint32_t Expired;
+
+                void Schedule(size_t id, uint32_t delay)
+                {
+                        Timers->Schedule(id, delay);
+                        Expiry[id] = Now + delay;
+                        Armed[id] = true;
+                }
+
+                void operator()(size_t id)
+                {
+                        CHECK(Armed[id]);
+                        CHECK_EQUAL(Expiry[id], Now);
+                        Armed[id] = false;
+                        Expired++;
+                        if (Random->Next(4) == 0) {
+                                Schedule(id, 1 + Random->Next(BigWheel::kMaxDelayTicks / 64));
+                        }
+                }
+        };
+
+        BigWheel wheel;
+        Lcg random(0x7153);
+        Reference reference = { &wheel, &random, {}, {}, 0, 0 };
+
+        for (uint32_t tick = 0; tick < kTicks; tick++) {
+                if (random.Next(8) == 0) {
+                        const size_t id = random.Next(kTimers);
+                        /* Mostly short timeouts, some on every level */
+                        const uint32_t delay = 1 + random.Next(random.Next(4) == 0 ? BigWheel::kMaxDelayTicks : 100);
+                        reference.Schedule(id, delay);
+                }
+                if (random.Next(32) == 0) {
+                        const size_t id = random.Next(kTimers);
+                        wheel.Cancel(id);
+                        reference.Armed[id] = false;
+                }
+
+                uint32_t next = 0;
+                for (size_t id = 0; id < kTimers; id++) {
+                        CHECK_EQUAL(wheel.Armed(id), reference.Armed[id]);
+                        if (reference.Armed[id]) {
+                                const uint32_t remaining = reference.Expiry[id] - reference.Now;
+                                CHECK_EQUAL(wheel.Remaining(id), remaining);
+                                next = next == 0 || remaining < next ? remaining : next;
+                        }
+                }
+                const uint32_t sleep = wheel.TicksToNext();
+                CHECK((next == 0) == (sleep == 0));
+                CHECK(sleep <= next);
+
+                reference.Now++;
+                wheel.Advance(1, reference);
+        }
+
+        CHECK(reference.Expired > kTicks / 100);
+}
+} /* namespace */
+
+int main()
+{
+        TestExpiryOrder();
+        TestWakeups();
+        TestCancelAndClamp();
+        TestAgainstReference();
+
+        return HostTestResult();
+}